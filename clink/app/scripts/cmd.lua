@@ -63,10 +63,14 @@ end
 
 --------------------------------------------------------------------------------
 local amp_classifier = clink.classifier(1)
+amp_classifier.onlychanged = true
 function amp_classifier:classify(commands)
-    if commands and commands[1] then
-        local line_state = commands[1].line_state
-        local classifications = commands[1].classifications
+    -- Color through the last command:  a command is only reused while
+    -- unchanged if it doesn't color past its own end.
+    local last = commands and commands[#commands]
+    if last then
+        local line_state = last.line_state
+        local classifications = last.classifications
         local line = line_state:getline()
         local quote = false
         local i = 1
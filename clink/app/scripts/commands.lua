@@ -87,7 +87,9 @@ end
 function clink._diagnostics()
     clink._diag_coroutines()
     clink._diag_refilter()
+    clink._diag_generator_cache()
     clink._diag_events()
+    clink._diag_gc()
     if clink._diag_custom then
         clink._diag_custom()
     end
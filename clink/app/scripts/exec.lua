@@ -33,18 +33,6 @@ settings.add("exec.space_prefix", true, "Whitespace prefix matches files",
 [[If the line begins with whitespace then Clink bypasses executable matching
 and will do normal files matching instead.  (See exec.enable)]])
 
---------------------------------------------------------------------------------
-local function get_environment_paths()
-    local paths = (os.getenv("path") or ""):explode(";")
-
-    -- Append slashes.
-    for i = 1, #paths, 1 do
-        paths[i] = paths[i].."\\"
-    end
-
-    return paths
-end
-
 --------------------------------------------------------------------------------
 local function exec_find_dirs(pattern, case_map)
     local ret = {}
@@ -94,7 +82,7 @@ function exec_generator:generate(line_state, match_builder)
     local match_dirs = settings.get("exec.dirs")
     local match_cwd = settings.get("exec.cwd")
 
-    local paths = nil
+    local match_path = false
     local text, expanded = rl.expandtilde(line_state:getword(1))
     local text_dir = (path.getdirectory(text) or ""):gsub("/", "\\")
     if #text_dir == 0 then
@@ -104,9 +92,9 @@ function exec_generator:generate(line_state, match_builder)
             match_builder:addmatches(aliases, "alias")
         end
 
-        -- Add environment's PATH variable as paths to search.
+        -- Add executables from the environment's PATH variable.
         if settings.get("exec.path") then
-            paths = get_environment_paths()
+            match_path = true
         end
     else
         -- 'text' is an absolute or relative path so override settings and
@@ -115,10 +103,6 @@ function exec_generator:generate(line_state, match_builder)
         match_cwd = true
     end
 
-    if not paths then
-        paths = {}
-    end
-
     local add_files = function(pattern, rooted)
         local any_added = false
         local root = nil
@@ -128,7 +112,7 @@ function exec_generator:generate(line_state, match_builder)
                 root = rl.collapsetilde(root)
             end
         end
-        for _, f in ipairs(os.globfiles(pattern, true)) do
+        for f in os.globiter(pattern, { extrainfo=true }) do
             local file = (root and path.join(root, f.name)) or f.name
             any_added = match_builder:addmatch({ match = file, type = f.type }) or any_added
         end
@@ -141,16 +125,20 @@ function exec_generator:generate(line_state, match_builder)
         added = add_files(text.."*", true) or added
     end
 
-    -- Search 'paths' for files ending in 'suffices' and look for matches.
+    -- The native executable index holds the executables in PATH (filtered by
+    -- PATHEXT), so completing them is a lookup rather than a glob per
+    -- directory per extension.  They're fed straight to the builder without
+    -- making a Lua table for each one.
     local added = false
-    local suffices = (os.getenv("pathext") or ""):explode(";")
-    for _, suffix in ipairs(suffices) do
-        for _, dir in ipairs(paths) do
-            added = add_files(dir.."*"..suffix) or added
-        end
+    if match_path then
+        local count = os.addpathexecutables_internal(match_builder)
+        added = (count > 0)
+    end
 
-        -- Should we also consider the path referenced by 'text'?
-        if match_cwd then
+    -- Should we also consider the path referenced by 'text'?
+    if match_cwd then
+        local suffices = (os.getenv("pathext") or ""):explode(";")
+        for _, suffix in ipairs(suffices) do
             -- Pass true because these need to include the base path.
             added = add_files(text.."*"..suffix, true) or added
         end
@@ -162,7 +150,7 @@ function exec_generator:generate(line_state, match_builder)
         if expanded then
             root = rl.collapsetilde(root)
         end
-        for _, d in ipairs(os.globdirs(text.."*", true)) do
+        for d in os.globiter(text.."*", { dirsonly=true, extrainfo=true }) do
             local dir = path.join(root, d.name)
             match_builder:addmatch({ match = dir, type = d.type })
         end
@@ -182,55 +182,22 @@ local function refilterprompt_after_coroutines()
 end
 
 --------------------------------------------------------------------------------
---- -name:  clink.promptcoroutine
---- -ver:   1.2.10
---- -arg:   func:function
---- -ret:   [return value from func]
---- Creates a coroutine to run the <span class="arg">func</span> function in the
---- background.  Clink will automatically resume the coroutine repeatedly while
---- input line editing is idle.  When the <span class="arg">func</span> function
---- completes, Clink will automatically refresh the prompt by triggering prompt
---- filtering again.
----
---- A coroutine is only created the first time each prompt filter calls this API
---- during a given input line session.  Subsequent calls reuse the
---- already-created coroutine.  (E.g. pressing <kbd>Enter</kbd> ends an input
---- line session.)
----
---- The API returns nil until the <span class="arg">func</span> function has
---- finished.  After that, the API returns whatever the
---- <span class="arg">func</span> function returned.  The API returns one value;
---- if multiple return values are needed, return them in a table.
----
---- If the <code>prompt.async</code> setting is disabled, then the coroutine
---- runs to completion immediately before returning.  Otherwise, the coroutine
---- runs during idle while editing the input line.  The
---- <span class="arg">func</span> function receives one argument: true if it's
---- running in the background, or false if it's running immediately.
----
---- See <a href="#asyncpromptfiltering">Asynchronous Prompt Filtering</a> for
---- more information.
----
---- <strong>Note:</strong> each prompt filter can have at most one prompt
---- coroutine.
-function clink.promptcoroutine(func)
-    if not prompt_filter_current then
-        error("clink.promptcoroutine can only be used in a prompt filter", 2)
-    end
-
-    local entry = prompt_filter_coroutines[prompt_filter_current]
+-- Returns the entry for the prompt coroutine identified by key, creating and
+-- starting the coroutine the first time.
+local function get_prompt_coroutine(key, func, src_func)
+    local entry = prompt_filter_coroutines[key]
     if entry == nil then
-        local info = debug.getinfo(func, 'S')
+        local info = debug.getinfo(src_func or func, 'S')
         src=info.short_src..":"..info.linedefined
 
         entry = { done=false, refilter=false, result=nil, src=src }
-        prompt_filter_coroutines[prompt_filter_current] = entry
+        prompt_filter_coroutines[key] = entry
 
         local async = settings.get("prompt.async")
 
         -- Wrap the supplied function to track completion and end result.
         local dependency_inversion = { c=nil }
-        coroutine.override_src(func)
+        coroutine.override_src(src_func or func)
         local c = coroutine.create(function (async)
             -- Call the supplied function.
             local o = func(async)
@@ -279,6 +246,243 @@ function clink.promptcoroutine(func)
         end
     end
 
+    return entry
+end
+
+--------------------------------------------------------------------------------
+--- -name:  clink.promptcoroutine
+--- -ver:   1.2.10
+--- -arg:   func:function
+--- -ret:   [return value from func]
+--- Creates a coroutine to run the <span class="arg">func</span> function in the
+--- background.  Clink will automatically resume the coroutine repeatedly while
+--- input line editing is idle.  When the <span class="arg">func</span> function
+--- completes, Clink will automatically refresh the prompt by triggering prompt
+--- filtering again.
+---
+--- A coroutine is only created the first time each prompt filter calls this API
+--- during a given input line session.  Subsequent calls reuse the
+--- already-created coroutine.  (E.g. pressing <kbd>Enter</kbd> ends an input
+--- line session.)
+---
+--- The API returns nil until the <span class="arg">func</span> function has
+--- finished.  After that, the API returns whatever the
+--- <span class="arg">func</span> function returned.  The API returns one value;
+--- if multiple return values are needed, return them in a table.
+---
+--- If the <code>prompt.async</code> setting is disabled, then the coroutine
+--- runs to completion immediately before returning.  Otherwise, the coroutine
+--- runs during idle while editing the input line.  The
+--- <span class="arg">func</span> function receives one argument: true if it's
+--- running in the background, or false if it's running immediately.
+---
+--- See <a href="#asyncpromptfiltering">Asynchronous Prompt Filtering</a> for
+--- more information.
+---
+--- <strong>Note:</strong> each prompt filter can have at most one prompt
+--- coroutine.
+function clink.promptcoroutine(func)
+    if not prompt_filter_current then
+        error("clink.promptcoroutine can only be used in a prompt filter", 2)
+    end
+
+    local entry = get_prompt_coroutine(prompt_filter_current, func)
+
     -- Return the result, if any.
     return entry.result
 end
+
+
+
+--------------------------------------------------------------------------------
+local cache_entries = {}                -- In-memory copies of clink.cache() entries.
+
+--------------------------------------------------------------------------------
+local function serialize_cache_value(value, depth)
+    local t = type(value)
+    if t == "string" then
+        return string.format("%q", value)
+    elseif t == "number" then
+        if value ~= value then
+            return "0/0"
+        elseif value == math.huge then
+            return "1/0"
+        elseif value == -math.huge then
+            return "-1/0"
+        end
+        return string.format("%.17g", value)
+    elseif t == "boolean" or t == "nil" then
+        return tostring(value)
+    elseif t == "table" then
+        if depth > 16 then
+            error("table nested too deeply")
+        end
+        local parts = {}
+        for k,v in pairs(value) do
+            local tk = type(k)
+            if tk ~= "string" and tk ~= "number" then
+                error("unsupported key type '"..tk.."'")
+            end
+            table.insert(parts, "["..serialize_cache_value(k, depth + 1).."]="..serialize_cache_value(v, depth + 1))
+        end
+        return "{"..table.concat(parts, ",").."}"
+    end
+    error("unsupported value type '"..t.."'")
+end
+
+--------------------------------------------------------------------------------
+local function get_cache_signature(validators)
+    if not validators then
+        return ""
+    end
+
+    local sig = {}
+    if validators.files then
+        for _,file in ipairs(validators.files) do
+            table.insert(sig, "f:"..file.."="..(clink._cache_file_stamp(file) or ""))
+        end
+    end
+    if validators.env then
+        for _,name in ipairs(validators.env) do
+            table.insert(sig, "e:"..name.."="..(os.getenv(name) or ""))
+        end
+    end
+    return table.concat(sig, "\n")
+end
+
+--------------------------------------------------------------------------------
+local function is_cache_entry_fresh(entry, ttl, sig, now)
+    if not entry or entry.sig ~= sig then
+        return false
+    end
+    if ttl and ttl >= 0 and now - entry.time >= ttl then
+        return false
+    end
+    return true
+end
+
+--------------------------------------------------------------------------------
+local function load_cache_entry(key)
+    local data = clink._cache_load(key)
+    if not data then
+        return
+    end
+
+    -- The empty environment keeps a damaged or tampered file from running
+    -- anything except a table constructor.
+    local chunk = load("return "..data, "=clink.cache", "t", {})
+    if chunk then
+        local ok, entry = pcall(chunk)
+        if ok and type(entry) == "table" and type(entry.time) == "number" and type(entry.sig) == "string" then
+            return entry
+        end
+    end
+end
+
+--------------------------------------------------------------------------------
+local function save_cache_entry(key, entry)
+    cache_entries[key] = entry
+
+    local ok, data = pcall(serialize_cache_value, entry, 0)
+    if ok then
+        clink._cache_save(key, data)
+    end
+end
+
+--------------------------------------------------------------------------------
+--- -name:  clink.cache
+--- -ver:   1.2.46
+--- -arg:   key:string
+--- -arg:   ttl:number
+--- -arg:   func:function
+--- -arg:   [validators:table]
+--- -ret:   any, boolean
+--- Returns the result of calling the <span class="arg">func</span> function,
+--- reusing a previously saved result when it's still valid.  Saved results are
+--- shared by all Clink instances, so an expensive value computed in one Command
+--- Prompt window can be reused by other windows and by later sessions.
+---
+--- The <span class="arg">key</span> identifies the result; include in it
+--- anything the result depends on (e.g. the repo directory).  A saved result
+--- expires after <span class="arg">ttl</span> seconds; a negative
+--- <span class="arg">ttl</span> means it never expires by age.
+---
+--- The optional <span class="arg">validators</span> table can list additional
+--- conditions; when any of them change the saved result is no longer valid:
+--- <ul>
+--- <li><code>files</code> is a table of file names whose size and last modified
+--- time are checked (e.g. <code>".git/HEAD"</code> and
+--- <code>".git/index"</code>).
+--- <li><code>env</code> is a table of environment variable names whose values
+--- are checked.
+--- </ul>
+---
+--- The result must be a string, number, boolean, nil, or a table of those.
+---
+--- The function returns two values:  the result, and true if the result is
+--- current or false if it's stale.  When called from a prompt filter while the
+--- <code>prompt.async</code> setting is enabled, a stale or missing result
+--- starts <span class="arg">func</span> in a prompt coroutine and immediately
+--- returns the stale result (or nil); the prompt is refreshed when the new
+--- result is ready, the same as with
+--- <a href="#clink.promptcoroutine">clink.promptcoroutine()</a>.  Otherwise
+--- <span class="arg">func</span> runs immediately.  The
+--- <span class="arg">func</span> function receives one argument: true if it's
+--- running in the background, or false if it's running immediately.
+--- -show:  local git_prompt = clink.promptfilter(50)
+--- -show:  function git_prompt:filter(prompt)
+--- -show:  &nbsp;   local git_dir = get_git_dir()   -- Some function that finds the .git directory.
+--- -show:  &nbsp;   if git_dir then
+--- -show:  &nbsp;       local status = clink.cache("git_status:"..git_dir, 60, function()
+--- -show:  &nbsp;           return get_git_status()   -- Some function that may take a while.
+--- -show:  &nbsp;       end, { files={ git_dir.."/HEAD", git_dir.."/index" } })
+--- -show:  &nbsp;       if status then
+--- -show:  &nbsp;           return prompt.." ["..status.."]"
+--- -show:  &nbsp;       end
+--- -show:  &nbsp;   end
+--- -show:  end
+function clink.cache(key, ttl, func, validators)
+    if type(key) ~= "string" then
+        error("bad argument #1 to 'clink.cache' (string expected)", 2)
+    end
+    if ttl ~= nil and type(ttl) ~= "number" then
+        error("bad argument #2 to 'clink.cache' (number expected)", 2)
+    end
+    if type(func) ~= "function" then
+        error("bad argument #3 to 'clink.cache' (function expected)", 2)
+    end
+
+    local sig = get_cache_signature(validators)
+    local now = os.time()
+
+    -- Another Clink instance may have refreshed the entry, so check the store
+    -- before deciding the result is stale.
+    local entry = cache_entries[key]
+    if not is_cache_entry_fresh(entry, ttl, sig, now) then
+        local loaded = load_cache_entry(key)
+        if loaded and (not entry or loaded.time >= entry.time) then
+            entry = loaded
+            cache_entries[key] = entry
+        end
+    end
+
+    if is_cache_entry_fresh(entry, ttl, sig, now) then
+        return entry.value, true
+    end
+
+    local refresh = function(async)
+        local value = func(async)
+        save_cache_entry(key, { time=os.time(), sig=sig, value=value })
+        return value
+    end
+
+    if prompt_filter_current then
+        local co = get_prompt_coroutine("cache:"..key, refresh, func)
+        if co.done then
+            return co.result, true
+        end
+        return entry and entry.value, false
+    end
+
+    return refresh(false), true
+end
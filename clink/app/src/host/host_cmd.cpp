@@ -231,6 +231,13 @@ bool host_has_deprecated_argmatcher(const char* command)
     return host_cmd::get()->has_deprecated_argmatcher(command);
 }
 
+//------------------------------------------------------------------------------
+unsigned int host_get_argmatcher_generation()
+{
+    extern unsigned int get_argmatcher_generation();
+    return get_argmatcher_generation();
+}
+
 //------------------------------------------------------------------------------
 void host_cmd_enqueue_lines(std::list<str_moveable>& lines)
 {
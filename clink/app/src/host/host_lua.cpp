@@ -20,9 +20,30 @@ extern "C" {
 #include <lua.h>
 }
 
+//------------------------------------------------------------------------------
+static setting_bool g_bytecode_cache(
+    "lua.bytecode_cache",
+    "Cache compiled Lua scripts",
+    "When enabled, Lua scripts are compiled once and the compiled chunks are\n"
+    "saved in a 'luacache' directory in the profile directory.  A script is\n"
+    "recompiled when its size or last modified time changes.",
+    true);
+
+//------------------------------------------------------------------------------
+static void get_bytecode_cache_dir(str_base& out)
+{
+    out.clear();
+    if (g_bytecode_cache.get())
+    {
+        app_context::get()->get_state_dir(out);
+        path::append(out, "luacache");
+    }
+}
+
 //------------------------------------------------------------------------------
 extern bool is_force_reload_scripts();
 extern void clear_force_reload_scripts();
+extern void set_prompt_cache_dir(const char* dir);
 
 //------------------------------------------------------------------------------
 host_lua::host_lua()
@@ -39,6 +60,11 @@ host_lua::host_lua()
     lua_State* state = m_state.get_state();
     lua_pushlstring(state, exe_path.c_str(), exe_path.length());
     lua_setglobal(state, "CLINK_EXE");
+
+    str<280> cache_dir;
+    app_context::get()->get_state_dir(cache_dir);
+    path::append(cache_dir, "promptcache");
+    set_prompt_cache_dir(cache_dir.c_str());
 }
 
 //------------------------------------------------------------------------------
@@ -105,7 +131,11 @@ bool host_lua::load_scripts(const char* paths)
             str<280> clink;
             if (path::join(token.c_str(), "clink.lua", clink) &&
                 os::get_path_type(clink.c_str()) == os::path_type_file)
-                m_state.do_file(clink.c_str());
+            {
+                str<280> cache_dir;
+                get_bytecode_cache_dir(cache_dir);
+                m_state.do_file(clink.c_str(), cache_dir.c_str());
+            }
         }
 
         // Load a given directory only once.
@@ -120,6 +150,7 @@ bool host_lua::load_scripts(const char* paths)
         seen_strings.emplace_back(std::move(out));
 
         load_script(token.c_str());
+        add_completions_dir(token.c_str());
     }
     return true;
 }
@@ -133,14 +164,40 @@ void host_lua::load_script(const char* path)
     globber lua_globs(buffer.c_str());
     lua_globs.directories(false);
 
+    str<280> cache_dir;
+    get_bytecode_cache_dir(cache_dir);
+
     while (lua_globs.next(buffer))
     {
         const char* s = path::get_name(buffer.c_str());
         if (stricmp(s, "clink.lua") != 0)
-            m_state.do_file(buffer.c_str());
+            m_state.do_file(buffer.c_str(), cache_dir.c_str());
     }
 }
 
+//------------------------------------------------------------------------------
+void host_lua::add_completions_dir(const char* path)
+{
+    // Scripts in a completions subdirectory aren't loaded here; arguments.lua
+    // loads them on demand the first time their command needs an argmatcher.
+    str<280> dir;
+    if (!path::join(path, "completions", dir) ||
+        os::get_path_type(dir.c_str()) != os::path_type_dir)
+        return;
+
+    lua_State* state = m_state.get_state();
+    save_stack_top ss(state);
+    if (!lua_state::push_named_function(state, "clink._add_completions_dir"))
+        return;
+
+    str<280> cache_dir;
+    get_bytecode_cache_dir(cache_dir);
+
+    lua_pushlstring(state, dir.c_str(), dir.length());
+    lua_pushlstring(state, cache_dir.c_str(), cache_dir.length());
+    m_state.pcall(2, 0);
+}
+
 //------------------------------------------------------------------------------
 bool host_lua::is_script_path_changed() const
 {
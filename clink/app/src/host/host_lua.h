@@ -32,6 +32,7 @@ public:
 private:
     bool                load_scripts(const char* paths);
     void                load_script(const char* path);
+    void                add_completions_dir(const char* path);
     lua_state           m_state;
     lua_match_generator m_generator;
     lua_word_classifier m_classifier;
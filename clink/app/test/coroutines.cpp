@@ -29,6 +29,22 @@ static void set_prompt_async(bool state)
     setting->set(state ? "true" : "false");
 }
 
+//------------------------------------------------------------------------------
+static void set_prompt_async_concurrency(int max)
+{
+    setting* setting = settings::find("prompt.async_concurrency");
+    if (max > 0)
+    {
+        str<> value;
+        value.format("%d", max);
+        setting->set(value.c_str());
+    }
+    else
+    {
+        setting->set();
+    }
+}
+
 //------------------------------------------------------------------------------
 static bool verify_ret_true(lua_state& lua, const char* func_name)
 {
@@ -224,6 +240,7 @@ TEST_CASE("Lua coroutines.")
         SECTION("Enabled")
         {
             set_prompt_async(true);
+            set_prompt_async_concurrency(1);
 
             str<> out;
             REQUIRE(verify_ret_true(lua, "reset_coroutine_test"));
@@ -317,5 +334,188 @@ TEST_CASE("Lua coroutines.")
         }
     }
 
+    SECTION("Concurrent")
+    {
+        const char* script = "\
+        _ran = {}\
+        _refilter = false\
+        \
+        function clink.refilterprompt()\
+            _refilter = true\
+        end\
+        \
+        function io.popenyield_internal(command, mode)\
+            local yieldguard = { _ready=false }\
+            function yieldguard:ready()\
+                return self._ready\
+            end\
+            function yieldguard:command()\
+                return command\
+            end\
+            _ran[command] = yieldguard\
+            return 'fake_file', yieldguard\
+        end\
+        \
+        local function count_ran()\
+            local n = 0\
+            for _ in pairs(_ran) do\
+                n = n + 1\
+            end\
+            return n\
+        end\
+        \
+        function verify_ran_2()\
+            return count_ran() == 2\
+        end\
+        \
+        function verify_ran_3()\
+            return count_ran() == 3\
+        end\
+        \
+        function set_all_ready()\
+            for _,yieldguard in pairs(_ran) do\
+                yieldguard._ready = true\
+            end\
+            return true\
+        end\
+        \
+        function verify_resume_coroutines()\
+            clink._wait_duration()\
+            if clink._has_coroutines() then\
+                clink._resume_coroutines()\
+                return true\
+            end\
+        end\
+        \
+        function verify_no_coroutines()\
+            return clink._has_coroutines() ~= true\
+        end\
+        \
+        function verify_refilter()\
+            return _refilter\
+        end\
+        \
+        local function add_filter(command)\
+            local pf = clink.promptfilter(1)\
+            function pf:filter(prompt)\
+                local result = clink.promptcoroutine(function ()\
+                    io.popenyield(command)\
+                    return command\
+                end)\
+                return prompt..(result or ''), true\
+            end\
+        end\
+        \
+        add_filter('a')\
+        add_filter('b')\
+        add_filter('c')\
+        ";
+
+        REQUIRE(lua.do_string(script));
+
+        set_prompt_async(true);
+        set_prompt_async_concurrency(2);
+
+        str<> out;
+        lua.send_event("onbeginedit");
+        prompt_filter.filter("", out);
+        REQUIRE(out.equals(""));
+
+        // Only two commands may run at once; the third is queued.
+        REQUIRE(verify_ret_true(lua, "verify_resume_coroutines"));
+        REQUIRE(verify_ret_true(lua, "verify_ran_2"));
+        REQUIRE(verify_ret_true(lua, "verify_resume_coroutines"));
+        REQUIRE(verify_ret_true(lua, "verify_ran_2"));
+
+        // Finishing the running commands dequeues the third.
+        REQUIRE(verify_ret_true(lua, "set_all_ready"));
+        REQUIRE(verify_ret_true(lua, "verify_resume_coroutines"));
+        REQUIRE(verify_ret_true(lua, "verify_ran_3"));
+
+        REQUIRE(verify_ret_true(lua, "set_all_ready"));
+        REQUIRE(verify_ret_true(lua, "verify_resume_coroutines"));
+        REQUIRE(verify_ret_true(lua, "verify_no_coroutines"));
+        REQUIRE(verify_ret_true(lua, "verify_refilter"));
+
+        prompt_filter.filter("", out);
+        REQUIRE(out.length() == 3);
+    }
+
+    SECTION("Cache")
+    {
+        const char* script = "\
+        _calls = 0\
+        _value = 'one'\
+        _refilter = false\
+        os.setenv('CLINK_TEST_CACHE', 'a')\
+        \
+        function clink.refilterprompt()\
+            _refilter = true\
+        end\
+        \
+        function verify_resume_coroutines()\
+            clink._wait_duration()\
+            if clink._has_coroutines() then\
+                clink._resume_coroutines()\
+                return true\
+            end\
+        end\
+        \
+        function verify_calls_1()\
+            return _calls == 1\
+        end\
+        \
+        function verify_calls_2()\
+            return _calls == 2\
+        end\
+        \
+        function change_validator()\
+            _value = 'two'\
+            os.setenv('CLINK_TEST_CACHE', 'b')\
+            return true\
+        end\
+        \
+        local pf = clink.promptfilter(1)\
+        function pf:filter(prompt)\
+            local value, fresh = clink.cache('test_key', -1, function ()\
+                _calls = _calls + 1\
+                return _value\
+            end, { env={ 'CLINK_TEST_CACHE' } })\
+            return (value or '')..(fresh and '+' or '-'), false\
+        end\
+        ";
+
+        REQUIRE(lua.do_string(script));
+
+        set_prompt_async(true);
+
+        // Nothing cached yet; the refresh runs in the background.
+        str<> out;
+        lua.send_event("onbeginedit");
+        prompt_filter.filter("", out);
+        REQUIRE(out.equals("-"));
+        REQUIRE(verify_ret_true(lua, "verify_resume_coroutines"));
+        REQUIRE(verify_ret_true(lua, "verify_calls_1"));
+        prompt_filter.filter("", out);
+        REQUIRE(out.equals("one+"));
+
+        // A valid entry is returned without calling the function.
+        lua.send_event("onbeginedit");
+        prompt_filter.filter("", out);
+        REQUIRE(out.equals("one+"));
+        REQUIRE(verify_ret_true(lua, "verify_calls_1"));
+
+        // Changing a validator shows the stale value while refreshing.
+        REQUIRE(verify_ret_true(lua, "change_validator"));
+        lua.send_event("onbeginedit");
+        prompt_filter.filter("", out);
+        REQUIRE(out.equals("one-"));
+        REQUIRE(verify_ret_true(lua, "verify_resume_coroutines"));
+        REQUIRE(verify_ret_true(lua, "verify_calls_2"));
+        prompt_filter.filter("", out);
+        REQUIRE(out.equals("two+"));
+    }
+
     set_prompt_async_default();
+    set_prompt_async_concurrency(0);
 }
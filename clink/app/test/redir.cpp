@@ -297,3 +297,107 @@ TEST_CASE("Redir parsing")
         }
     }
 }
+
+//------------------------------------------------------------------------------
+TEST_CASE("Incremental word collection")
+{
+    static const char* const lines[] = {
+        "nullcmd & argcmd 2>&1 x | \"quo & ted\" y && z -a:b -c=",
+        "a&&b||c&d|e \"f|g\" h^&i",
+        "argcmd > x & nullcmd < y | argcmd >",
+    };
+
+    cmd_command_tokeniser command_tokeniser;
+    cmd_word_tokeniser word_tokeniser;
+    word_collector incremental(&command_tokeniser, &word_tokeniser);
+
+    auto same_words = [] (const std::vector<word>& a, const std::vector<word>& b)
+    {
+        if (a.size() != b.size())
+            return false;
+        for (size_t i = 0; i < a.size(); ++i)
+        {
+            if (a[i].offset != b[i].offset ||
+                a[i].length != b[i].length ||
+                a[i].command_word != b[i].command_word ||
+                a[i].is_alias != b[i].is_alias ||
+                a[i].is_redir_arg != b[i].is_redir_arg ||
+                a[i].quoted != b[i].quoted ||
+                a[i].delim != b[i].delim)
+                return false;
+        }
+        return true;
+    };
+
+    // Type each line one char at a time, then delete from the middle, and
+    // compare against collecting the words from scratch each time.
+    for (const char* line : lines)
+    {
+        str<> input;
+        const unsigned int line_len = unsigned(strlen(line));
+        for (unsigned int i = 0; i <= line_len * 2; ++i)
+        {
+            input.clear();
+            if (i <= line_len)
+                input.concat(line, i);
+            else
+            {
+                const unsigned int cut = (i - line_len) / 2;
+                input.concat(line, line_len / 2);
+                input.concat(line + line_len / 2 + cut);
+            }
+
+            const unsigned int len = input.length();
+            for (unsigned int cursor : { len, len / 2 })
+            {
+                for (auto mode : { collect_words_mode::stop_at_cursor, collect_words_mode::whole_command })
+                {
+                    word_collector fresh(&command_tokeniser, &word_tokeniser);
+                    std::vector<word> expected;
+                    std::vector<word> words;
+                    const unsigned int expected_offset = fresh.collect_words(input.c_str(), len, cursor, expected, mode);
+                    const unsigned int command_offset = incremental.collect_words(input.c_str(), len, cursor, words, mode);
+
+                    REQUIRE(command_offset == expected_offset, [&] () {
+                        printf("input '%s', cursor %u\n", input.c_str(), cursor);
+                    });
+                    REQUIRE(same_words(words, expected), [&] () {
+                        printf("input '%s', cursor %u\n", input.c_str(), cursor);
+                    });
+                }
+            }
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+TEST_CASE("Word collection after argmatchers change")
+{
+    // Stands in for an argmatcher being loaded on demand while editing.
+    class test_command_tokeniser : public cmd_command_tokeniser
+    {
+    public:
+        bool has_deprecated_argmatcher(const char* command) override { return m_deprecated; }
+        unsigned int get_argmatcher_generation() override { return m_generation; }
+        bool m_deprecated = false;
+        unsigned int m_generation = 0;
+    };
+
+    test_command_tokeniser command_tokeniser;
+    cmd_word_tokeniser word_tokeniser;
+    word_collector collector(&command_tokeniser, &word_tokeniser);
+
+    const char* input = "argcmd -a:b";
+    const unsigned int len = unsigned(strlen(input));
+    std::vector<word> words;
+
+    collector.collect_words(input, len, len, words, collect_words_mode::whole_command);
+    REQUIRE(words.size() == 3);
+
+    // Deprecated argmatchers don't split flags at ':'.
+    command_tokeniser.m_deprecated = true;
+    command_tokeniser.m_generation++;
+
+    collector.collect_words(input, len, len, words, collect_words_mode::whole_command);
+    REQUIRE(words.size() == 2);
+}
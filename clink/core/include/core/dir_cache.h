@@ -0,0 +1,67 @@
+// Copyright (c) 2021 Christopher Antos
+// License: http://opensource.org/licenses/MIT
+
+#pragma once
+
+#include <Windows.h>
+
+#include <memory>
+#include <vector>
+
+//------------------------------------------------------------------------------
+// Immutable listing of one directory, as returned by FindFirstFile("dir\*").
+// Snapshots are shared, so a globber can keep iterating one even if the cache
+// replaces it in the meantime.
+class dir_snapshot
+{
+public:
+    struct entry
+    {
+        unsigned int        name_offset;
+        DWORD               attr;
+        DWORD               reparse_tag;
+        unsigned long long  size;
+        FILETIME            accessed;
+        FILETIME            modified;
+        FILETIME            created;
+    };
+
+    unsigned int            size() const { return (unsigned int)(m_entries.size()); }
+    const entry&            get_entry(unsigned int index) const { return m_entries[index]; }
+    const wchar_t*          get_name(unsigned int index) const { return m_names.data() + m_entries[index].name_offset; }
+
+private:
+    friend class            dir_snapshot_builder;
+    std::vector<entry>      m_entries;
+    std::vector<wchar_t>    m_names;
+};
+
+//------------------------------------------------------------------------------
+struct dir_cache_stats
+{
+    unsigned int            dirs;
+    unsigned int            hits;
+    unsigned int            misses;
+    unsigned int            invalidations;
+    unsigned int            evictions;
+};
+
+//------------------------------------------------------------------------------
+// Process-wide cache of directory snapshots.  A snapshot is revalidated on each
+// lookup by comparing the directory's last write time, which changes whenever
+// entries are added, removed, or renamed.  Attribute and size changes don't
+// touch the directory's write time, so callers that need exact sizes or times
+// shouldn't use the cache.  The cache is thread safe.
+//
+// Unlike FindFirstFile, match_name() only matches long names, never 8.3 short
+// names (see is_cacheable_pattern).
+namespace dir_cache
+{
+
+std::shared_ptr<const dir_snapshot> get(const wchar_t* dir);
+bool                        is_cacheable_pattern(const wchar_t* name);
+bool                        match_name(const wchar_t* pattern, const wchar_t* name);
+void                        clear();
+void                        get_stats(dir_cache_stats& stats);
+
+}; // namespace dir_cache
@@ -0,0 +1,49 @@
+// Copyright (c) 2021 Christopher Antos
+// License: http://opensource.org/licenses/MIT
+
+#pragma once
+
+#include <Windows.h>
+
+#include <memory>
+#include <vector>
+
+//------------------------------------------------------------------------------
+// Sorted, deduplicated list of the executable files found in a set of
+// directories.  When the same name exists in more than one directory, the
+// first directory wins (the same as command resolution).
+class exec_list
+{
+public:
+    struct entry
+    {
+        unsigned int        name_offset;
+        unsigned int        dir_offset;
+        DWORD               attr;
+        DWORD               reparse_tag;
+    };
+
+    unsigned int            size() const { return (unsigned int)(m_entries.size()); }
+    const entry&            get_entry(unsigned int index) const { return m_entries[index]; }
+    const char*             get_name(unsigned int index) const { return m_strings.data() + m_entries[index].name_offset; }
+    const char*             get_dir(unsigned int index) const { return m_strings.data() + m_entries[index].dir_offset; }
+
+private:
+    friend class            exec_index_builder;
+    std::vector<entry>      m_entries;
+    std::vector<char>       m_strings;
+};
+
+//------------------------------------------------------------------------------
+// Index of executables in the directories of a PATH-style list, filtered by a
+// PATHEXT-style list of extensions.  Each directory's listing comes from
+// dir_cache, so a directory is only enumerated again when its last write time
+// changes, and the merged list is only rebuilt when some directory's listing
+// changed (or the lists themselves changed).
+namespace exec_index
+{
+
+std::shared_ptr<const exec_list> get(const char* paths, const char* pathexts);
+void                        clear();
+
+}; // namespace exec_index
@@ -7,6 +7,10 @@
 
 #include <Windows.h>
 
+#include <memory>
+
+class dir_snapshot;
+
 //------------------------------------------------------------------------------
 class globber
 {
@@ -29,15 +33,23 @@ public:
     void                hidden(bool state)      { m_hidden = state; }
     void                system(bool state)      { m_system = state; }
     void                dots(bool state)        { m_dots = state; }
+    void                cached(bool state)      { m_cached = state; }
     bool                older_than(int seconds);
     bool                next(str_base& out, bool rooted=true, extrainfo* extrainfo=nullptr);
 
 private:
                         globber(const globber&) = delete;
     void                operator = (const globber&) = delete;
+    void                open();
+    bool                has_file() const;
     void                next_file();
+    bool                next_snapshot_file();
     WIN32_FIND_DATAW    m_data;
     HANDLE              m_handle;
+    std::shared_ptr<const dir_snapshot> m_snapshot;
+    unsigned int        m_snapshot_index;
+    wstr<280>           m_pattern;
+    unsigned int        m_name_offset;
     str<280>            m_root;
     bool                m_files;
     bool                m_directories;
@@ -45,6 +57,8 @@ private:
     bool                m_hidden;
     bool                m_system;
     bool                m_dots;
+    bool                m_cached;
+    bool                m_opened;
     bool                m_onlyolder;
     FILETIME            m_olderthan;
 
@@ -0,0 +1,70 @@
+// Copyright (c) 2021 Christopher Antos
+// License: http://opensource.org/licenses/MIT
+
+#pragma once
+
+//------------------------------------------------------------------------------
+enum class latency_phase : unsigned char
+{
+    input,          // update_input(), one key (or batch of keys) end to end.
+    dispatch,       // Nested dispatch() for commands that read more input.
+    update,         // update_internal().
+    generate,       // update_matches() generate step.
+    restrict,       // update_matches() restrict step.
+    select,         // update_matches() select step.
+    sort,           // update_matches() sort step.
+    classify,       // Word classification.
+    prompt,         // Prompt filtering.
+    redisplay,      // Readline redisplay.
+    gc,             // Lua garbage collection step while idle.
+    max
+};
+
+//------------------------------------------------------------------------------
+struct latency_histogram
+{
+    enum { num_buckets = 12 };
+
+    unsigned int            buckets[num_buckets];
+    unsigned int            count;
+    unsigned long long      total_us;
+    unsigned long long      max_us;
+};
+
+//------------------------------------------------------------------------------
+// Fixed-bucket histograms of how long each phase of handling input takes.
+// Spans are inclusive, so a phase nested inside another (e.g. classify inside
+// redisplay) counts toward both.  When disabled, a span costs one test of a
+// static bool.
+namespace latency
+{
+
+void                        enable(bool enable);
+bool                        is_enabled();
+void                        reset();
+void                        record(latency_phase phase, unsigned long long us);
+bool                        get_histogram(latency_phase phase, latency_histogram& out);
+const char*                 get_phase_name(latency_phase phase);
+unsigned int                get_bucket_limit(unsigned int bucket); // In microseconds; 0 means unbounded.
+
+}; // namespace latency
+
+//------------------------------------------------------------------------------
+class latency_span
+{
+public:
+                            latency_span(latency_phase phase) : m_phase(phase), m_start(start()) {}
+                            ~latency_span() { if (m_start) stop(m_phase, m_start); }
+
+    // For spans that can't be scoped; start() returns 0 when disabled.
+    static long long        start() { return s_enabled ? now() : 0; }
+    static void             stop(latency_phase phase, long long started);
+
+private:
+    friend void             latency::enable(bool enable);
+    friend bool             latency::is_enabled();
+    static long long        now();
+    const latency_phase     m_phase;
+    const long long         m_start;
+    static bool             s_enabled;
+};
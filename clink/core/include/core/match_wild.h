@@ -7,6 +7,8 @@
 #include <core/str_compare.h>
 #include <core/str_iter.h>
 
+#include <vector>
+
 class str_base;
 
 namespace path
@@ -16,194 +18,250 @@ namespace path
 enum star_matches_everything { no, yes, at_end };
 
 //------------------------------------------------------------------------------
-template <class T, int MODE, bool fuzzy_accents>
-bool match_char_impl(int pc, int fc)
+// A wildcard pattern compiled into a list of ops, so that many strings can be
+// matched against it cheaply.  Literal runs are folded once, up front, per the
+// str_compare_scope that is current when the pattern is compiled.
+//
+// Matching doesn't recurse or keep a stack:  only the most recent '*' ever
+// needs to be retried, since it can absorb anything an earlier '*' could.  And
+// unless '*' matches everything, once a path separator after a '*' matches,
+// the '*' can't be retried at all.
+template <class T>
+class wild_pattern
 {
-    if (MODE > 0)
+public:
+    explicit                wild_pattern(const str_iter_impl<T>& pattern);
+    bool                    match(const str_iter_impl<T>& file, star_matches_everything match_everything=no) const;
+
+private:
+    enum op_type : unsigned char { op_literal, op_any, op_star, op_separator };
+
+    struct op
     {
-        pc = (pc > 0xffff) ? pc : int(uintptr_t(CharLowerW(LPWSTR(uintptr_t(pc)))));
-        fc = (fc > 0xffff) ? fc : int(uintptr_t(CharLowerW(LPWSTR(uintptr_t(fc)))));
-    }
+        op_type             type;
+        unsigned int        offset;     // Literal runs:  index into m_chars.
+        unsigned int        length;     // Literal runs:  number of chars.
+    };
+
+    int                     fold(int c) const;
+    bool                    match_literal(const op& op, str_iter_impl<T>& file) const;
+    bool                    find_literal(const op& op, str_iter_impl<T>& from, str_iter_impl<T>& file, bool cross_separators) const;
+    std::vector<op>         m_ops;
+    std::vector<int>        m_chars;
+    std::vector<int>        m_unaccented;
+    int                     m_skip_dots_op = -1;
+    int                     m_mode;
+    bool                    m_fuzzy_accents;
+};
+
+//------------------------------------------------------------------------------
+template <class T>
+wild_pattern<T>::wild_pattern(const str_iter_impl<T>& _pattern)
+: m_mode(str_compare_scope::current())
+, m_fuzzy_accents(str_compare_scope::current_fuzzy_accents())
+{
+    const fold_tables& tables = fold_tables::get();
+
+    unsigned int final_component = 0;
+    bool final_wildcard = false;
 
-    if (MODE > 1)
+    str_iter_impl<T> pattern(_pattern);
+    while (int c = pattern.next())
     {
-        pc = (pc == '-') ? '_' : pc;
-        fc = (fc == '-') ? '_' : fc;
+        const op* prev = m_ops.empty() ? nullptr : &m_ops.back();
+        if (path::is_separator(c))
+        {
+            // Consider "\\\\" and "\" equal.
+            if (!prev || prev->type != op_separator)
+                m_ops.push_back({ op_separator });
+            final_component = (unsigned int)(m_ops.size());
+            final_wildcard = false;
+        }
+        else if (c == '*' || c == '?')
+        {
+            // A '?' right after a '*' adds nothing; the '*' already covers it.
+            if (!prev || prev->type != op_star)
+                m_ops.push_back({ (c == '*') ? op_star : op_any });
+            final_wildcard = true;
+        }
+        else
+        {
+            if (!prev || prev->type != op_literal)
+                m_ops.push_back({ op_literal, (unsigned int)(m_chars.size()), 0 });
+            c = fold(c);
+            m_chars.push_back(c);
+            m_unaccented.push_back(m_fuzzy_accents ? tables.unaccent(c) : c);
+            m_ops.back().length++;
+        }
     }
 
-    if (pc == '\\') pc = '/';
-    if (fc == '\\') fc = '/';
+    // When the final component has wildcards, leading periods in the file's
+    // final component are ignored unless the pattern explicitly starts with a
+    // period (so "bu*" matches ".build" but ".bu*" doesn't match "..build").
+    if (final_wildcard &&
+        final_component < m_ops.size() &&
+        m_ops[final_component].type == op_literal &&
+        m_chars[m_ops[final_component].offset] != '.')
+        m_skip_dots_op = int(final_component);
+}
 
-    if (pc != fc)
+//------------------------------------------------------------------------------
+template <class T>
+int wild_pattern<T>::fold(int c) const
+{
+    if (m_mode > 0)
+        c = fold_tables::get().lower(c);
+    if (m_mode > 1 && c == '-')
+        c = '_';
+    return c;
+}
+
+//------------------------------------------------------------------------------
+template <class T>
+bool wild_pattern<T>::match_literal(const op& op, str_iter_impl<T>& file) const
+{
+    const int* chars = m_chars.data() + op.offset;
+    const int* unaccented = m_unaccented.data() + op.offset;
+    for (unsigned int i = 0; i < op.length; ++i)
     {
-        if (!fuzzy_accents)
+        int d = file.next();
+        if (!d)
             return false;
-        pc = normalize_accent(pc);
-        fc = normalize_accent(fc);
-        if (pc != fc)
+
+        d = fold(d);
+        if (d == chars[i])
+            continue;
+        if (!m_fuzzy_accents || fold_tables::get().unaccent(d) != unaccented[i])
             return false;
     }
-
     return true;
 }
 
 //------------------------------------------------------------------------------
-template <class T, int MODE, bool fuzzy_accents>
-bool match_wild_impl(const str_iter_impl<T>& _pattern, const str_iter_impl<T>& _file, star_matches_everything match_everything=no)
+// Searches forward from 'from' for the literal run.  On success 'from' is where
+// the run starts and 'file' is just past it.
+template <class T>
+bool wild_pattern<T>::find_literal(const op& op, str_iter_impl<T>& from, str_iter_impl<T>& file, bool cross_separators) const
 {
-    str_iter_impl<T> pattern(_pattern);
-    str_iter_impl<T> file(_file);
+    while (true)
+    {
+        file = from;
+        if (match_literal(op, file))
+            return true;
+
+        int d = from.next();
+        if (!d || (!cross_separators && path::is_separator(d)))
+            return false;
+    }
+}
 
-    unsigned depth = 0;
-    const T* pattern_stack[10];
-    const T* file_stack[10];
-    bool path_component_stack[10];
+//------------------------------------------------------------------------------
+template <class T>
+bool wild_pattern<T>::match(const str_iter_impl<T>& _file, star_matches_everything match_everything) const
+{
+    const bool cross_separators = (match_everything == yes);
 
-    const T* final_pattern_component = nullptr;
-    const T* final_file_component = nullptr;
-    bool has_final_wildcard = false;
+    // Find where the file's final component starts, for skipping periods.
+    const T* final_component = nullptr;
+    if (m_skip_dots_op >= 0)
+    {
+        str_iter_impl<T> tmp(_file);
+        final_component = tmp.get_pointer();
+        while (int d = tmp.next())
+            if (path::is_separator(d))
+                final_component = tmp.get_pointer();
+    }
 
-    bool start_of_path_component = true;
+    str_iter_impl<T> file(_file);
+    str_iter_impl<T> star_file(_file);
+    unsigned int star = 0;              // Index of the op after the most recent '*', or 0.
 
+    unsigned int i = 0;
     while (true)
     {
-        int c = pattern.peek();
-        int d = file.peek();
-        if (!c)
+        bool matched = false;
+        if (i >= m_ops.size())
         {
-            // Consumed pattern, so it's a match iff file was consumed.
-            if (!d)
+            if (!file.more())
                 return true;
-back_track:
-            if (depth)
-            {
-                // Backtrack.
-                depth--;
-                pattern.reset_pointer(pattern_stack[depth]);
-                file.reset_pointer(file_stack[depth]);
-                start_of_path_component = path_component_stack[depth];
-                continue;
-            }
-            return false;
         }
-
-        bool symbol_matched = false;
-        switch (c)
+        else
         {
-        case '?':
-            // Any 1 character (or missing character), except slashes.
-            if (path::is_separator(d))
-                break;
-            if (d)
-                file.next();
-            pattern.next();
-            symbol_matched = true;
-            break;
-        case '*': {
-            const T* push_pattern = pattern.get_pointer();
-            while (c == '*' || c == '?')
+            const op& op = m_ops[i];
+            switch (op.type)
             {
-                pattern.next();
-                c = pattern.peek();
-            }
-            if (c == '\0' && match_everything >= yes)
-                return true;
-            if (c != '?' &&
-                c != '*')
-            {
-                // Iterate until file char matches pattern char after wildcard.
-                const T* push_scout = file.get_pointer();
-                while (d &&
-                       (match_everything == yes || !path::is_separator(d)) &&
-                       !match_char_impl<T,MODE,fuzzy_accents>(d, c))
+            case op_literal:
+                if (star && i == star)
                 {
-                    file.next();
-                    d = file.peek();
+                    // Search for the run, instead of retrying at each position.
+                    if (!find_literal(op, star_file, file, cross_separators))
+                        return false;
+                    matched = true;
+                    break;
                 }
-                if (!match_char_impl<T,MODE,fuzzy_accents>(d, c))
+                if (int(i) == m_skip_dots_op && file.get_pointer() == final_component)
                 {
-                    file.reset_pointer(push_scout);
-                    break; // Next character has no possible match ahead.
+                    while (file.peek() == '.')
+                        file.next();
                 }
-                file.next();
-                pattern.next();
-            }
-            if (match_everything != yes && path::is_separator(d))
-            {
-                // Wildcards don't match past a path separator.
-                depth = 0;
-            }
-            else
-            {
-                if (depth == _countof(pattern_stack))
-                    return false; // Stack overflow.
-                pattern_stack[depth] = push_pattern;
-                file_stack[depth] = file.get_pointer();
-                path_component_stack[depth] = start_of_path_component;
-                depth++;
-            }
-            symbol_matched = true;
-            break; }
-        default: {
-            // Single character.
-            if (!d)
+                matched = match_literal(op, file);
                 break;
-            if (path::is_separator(d))
-                start_of_path_component = true;
-            else if (d == '.' && start_of_path_component)
-            {
-                if (!final_file_component)
+
+            case op_any:
                 {
-                    int x;
-                    for (str_iter tmp(_pattern); x = tmp.peek(); tmp.next())
-                        if (path::is_separator(x))
-                        {
-                            final_pattern_component = tmp.get_pointer() + 1;
-                            has_final_wildcard = false;
-                        }
-                        else if (x == '?' || x == '*')
-                        {
-                            has_final_wildcard = true;
-                        }
-                    for (str_iter tmp(_file); x = tmp.peek(); tmp.next())
-                        if (path::is_separator(x))
-                            final_file_component = tmp.get_pointer() + 1;
-                    if (!final_pattern_component)
-                        final_pattern_component = _pattern.get_pointer();
-                    if (!final_file_component)
-                        final_file_component = _file.get_pointer();
+                    // Any 1 character (or missing character), except slashes.
+                    int d = file.peek();
+                    if (!path::is_separator(d))
+                    {
+                        if (d)
+                            file.next();
+                        matched = true;
+                    }
                 }
-                if (has_final_wildcard &&
-                    file.get_pointer() == final_file_component &&
-                    pattern.get_pointer() == final_pattern_component &&
-                    c != '.')
+                break;
+
+            case op_separator:
+                if (path::is_separator(file.next()))
                 {
-                    while (d == '.')
-                    {
+                    while (path::is_separator(file.peek()))
                         file.next();
-                        d = file.peek();
-                    }
+                    if (!cross_separators)
+                        star = 0;
+                    matched = true;
                 }
-            }
-            if (!match_char_impl<T,MODE,fuzzy_accents>(d, c))
                 break;
-            pattern.next();
-            file.next();
-            symbol_matched = true;
-            // Advance past path separators (consider "\\\\" and "\" equal).
-            assert(path::is_separator(c) == path::is_separator(d));
-            if (path::is_separator(c))
-            {
-                while (path::is_separator(pattern.peek()))
-                    pattern.next();
-                while (path::is_separator(file.peek()))
-                    file.next();
+
+            case op_star:
+                if (i + 1 == m_ops.size())
+                {
+                    if (match_everything >= yes)
+                        return true;
+                    while (int d = file.next())
+                        if (path::is_separator(d))
+                            return false;
+                    return true;
+                }
+                star = i + 1;
+                star_file = file;
+                matched = true;
+                break;
             }
-            break; }
         }
 
-        if (!symbol_matched)
-            goto back_track;
+        if (matched)
+        {
+            ++i;
+            continue;
+        }
+
+        // Let the most recent '*' absorb one more character, and retry.
+        if (!star)
+            return false;
+        int d = star_file.next();
+        if (!d || (!cross_separators && path::is_separator(d)))
+            return false;
+        file = star_file;
+        i = star;
     }
 }
 
@@ -211,19 +269,7 @@ back_track:
 template <class T>
 bool match_wild(const str_iter_impl<T>& pattern, const str_iter_impl<T>& file, star_matches_everything match_everything=no)
 {
-    bool fuzzy_accents = str_compare_scope::current_fuzzy_accents();
-    switch (str_compare_scope::current())
-    {
-    case str_compare_scope::relaxed:
-        if (fuzzy_accents)  return match_wild_impl<T, 2, true>(pattern, file, match_everything);
-        else                return match_wild_impl<T, 2, false>(pattern, file, match_everything);
-    case str_compare_scope::caseless:
-        if (fuzzy_accents)  return match_wild_impl<T, 1, true>(pattern, file, match_everything);
-        else                return match_wild_impl<T, 1, false>(pattern, file, match_everything);
-    default:
-        if (fuzzy_accents)  return match_wild_impl<T, 0, true>(pattern, file, match_everything);
-        else                return match_wild_impl<T, 0, false>(pattern, file, match_everything);
-    }
+    return wild_pattern<T>(pattern).match(file, match_everything);
 }
 
 //------------------------------------------------------------------------------
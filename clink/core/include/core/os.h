@@ -47,6 +47,8 @@ bool    remove_dir(const char* dir);
 bool    unlink(const char* path);
 bool    move(const char* src_path, const char* dest_path);
 bool    copy(const char* src_path, const char* dest_path);
+bool    atomic_write_file(const char* path, bool (*writer)(FILE* file, void* param), void* param);
+bool    get_file_stamp(const char* path, unsigned long long& size, unsigned long long& mtime);
 bool    get_temp_dir(str_base& out);
 FILE*   create_temp_file(str_base* out=nullptr, const char* prefix=nullptr, const char* ext=nullptr, temp_file_mode mode=normal, const char* path=nullptr);
 bool    expand_env(const char* in, unsigned int in_len, str_base& out, int* point=nullptr);
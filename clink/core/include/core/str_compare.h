@@ -10,7 +10,13 @@
 #include <Windows.h>
 #include <assert.h>
 
+#if defined(_M_IX86) || defined(_M_X64) || defined(__SSE2__)
+#   include <emmintrin.h>
+#   define STR_COMPARE_SSE2
+#endif
+
 #include <map>
+#include <vector>
 
 //------------------------------------------------------------------------------
 class str_compare_scope
@@ -41,6 +47,94 @@ private:
 //------------------------------------------------------------------------------
 int normalize_accent(int c);
 
+//------------------------------------------------------------------------------
+// Precomputed case folding (CharLowerW) and accent folding (normalize_accent)
+// for the BMP.  The tables are built once, on first use, from the functions
+// they replace, so results are identical.  Lookups are two-stage:  a block
+// index per 256 codepoints, then the block; blocks that fold to themselves
+// all share block 0.
+class fold_tables
+{
+public:
+    static const fold_tables& get();
+    int                     lower(int c) const;
+    int                     unaccent(int c) const;
+    bool                    is_ascii_simple() const { return m_ascii_simple; }
+
+private:
+                            fold_tables();
+    unsigned short          add_block(const wchar_t* block);
+    unsigned short          m_lower_index[256];
+    unsigned short          m_accent_index[256];
+    wchar_t                 m_ascii_lower[128];
+    bool                    m_ascii_simple;
+    const wchar_t*          m_blocks;
+    std::vector<wchar_t>    m_storage;
+};
+
+//------------------------------------------------------------------------------
+inline int fold_tables::lower(int c) const
+{
+    if (unsigned(c) < 0x80)
+        return m_ascii_lower[c];
+    if (unsigned(c) > 0xffff)
+        return c;
+    return m_blocks[(m_lower_index[c >> 8] << 8) | (c & 0xff)];
+}
+
+//------------------------------------------------------------------------------
+inline int fold_tables::unaccent(int c) const
+{
+    if (unsigned(c) < 0x80 || unsigned(c) > 0xffff)
+        return c;
+    return m_blocks[(m_accent_index[c >> 8] << 8) | (c & 0xff)];
+}
+
+//------------------------------------------------------------------------------
+#ifdef STR_COMPARE_SSE2
+// Returns true if the next 16 bytes of l and r are plain ASCII, contain no nul
+// or path separator, and are equal after folding per MODE.  Only valid when
+// fold_tables::is_ascii_simple() is true.
+template <int MODE>
+bool str_compare_ascii_chunk(const char* l, const char* r)
+{
+    __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(l));
+    __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(r));
+
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i slash = _mm_set1_epi8('/');
+    __m128i special = _mm_or_si128(_mm_cmpeq_epi8(a, zero), _mm_cmpeq_epi8(b, zero));
+    special = _mm_or_si128(special, _mm_or_si128(_mm_cmpeq_epi8(a, backslash), _mm_cmpeq_epi8(b, backslash)));
+    special = _mm_or_si128(special, _mm_or_si128(_mm_cmpeq_epi8(a, slash), _mm_cmpeq_epi8(b, slash)));
+    if (_mm_movemask_epi8(_mm_or_si128(a, b)) | _mm_movemask_epi8(special))
+        return false;
+
+    if (MODE > 0)
+    {
+        const __m128i before_a = _mm_set1_epi8('A' - 1);
+        const __m128i after_z = _mm_set1_epi8('Z' + 1);
+        const __m128i bit = _mm_set1_epi8(0x20);
+        __m128i upper_a = _mm_and_si128(_mm_cmpgt_epi8(a, before_a), _mm_cmplt_epi8(a, after_z));
+        __m128i upper_b = _mm_and_si128(_mm_cmpgt_epi8(b, before_a), _mm_cmplt_epi8(b, after_z));
+        a = _mm_or_si128(a, _mm_and_si128(upper_a, bit));
+        b = _mm_or_si128(b, _mm_and_si128(upper_b, bit));
+    }
+
+    if (MODE > 1)
+    {
+        const __m128i dash = _mm_set1_epi8('-');
+        const __m128i underscore = _mm_set1_epi8('_');
+        __m128i dash_a = _mm_cmpeq_epi8(a, dash);
+        __m128i dash_b = _mm_cmpeq_epi8(b, dash);
+        a = _mm_or_si128(_mm_andnot_si128(dash_a, a), _mm_and_si128(dash_a, underscore));
+        b = _mm_or_si128(_mm_andnot_si128(dash_b, b), _mm_and_si128(dash_b, underscore));
+    }
+
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(a, b)) == 0xffff;
+}
+#endif
+
 //------------------------------------------------------------------------------
 // Returns how many characters match at the beginning of the strings.
 // If the entire strings match and compute_lcd is false, it returns -1.
@@ -48,9 +142,31 @@ template <class T, int MODE, bool fuzzy_accents, bool compute_lcd>
 int str_compare_impl(str_iter_impl<T>& lhs, str_iter_impl<T>& rhs)
 {
     const T* start = lhs.get_pointer();
+    const fold_tables& tables = fold_tables::get();
+
+#ifdef STR_COMPARE_SSE2
+    // Runs of plain ASCII are compared 16 bytes at a time.  After a chunk that
+    // can't be compared that way, wait 16 bytes before trying again.
+    const bool use_sse2 = (sizeof(T) == 1 && (MODE == 0 || tables.is_ascii_simple()));
+    const T* retry_sse2 = start;
+#endif
 
     while (1)
     {
+#ifdef STR_COMPARE_SSE2
+        if (use_sse2 && lhs.get_pointer() >= retry_sse2)
+        {
+            while (lhs.can_read(16) && rhs.can_read(16) &&
+                   str_compare_ascii_chunk<MODE>(reinterpret_cast<const char*>(lhs.get_pointer()),
+                                                 reinterpret_cast<const char*>(rhs.get_pointer())))
+            {
+                lhs.advance(16);
+                rhs.advance(16);
+            }
+            retry_sse2 = lhs.get_pointer() + 16;
+        }
+#endif
+
         int c = lhs.peek();
         int d = rhs.peek();
         if (!c || !d)
@@ -58,8 +174,8 @@ int str_compare_impl(str_iter_impl<T>& lhs, str_iter_impl<T>& rhs)
 
         if (MODE > 0)
         {
-            c = (c > 0xffff) ? c : int(uintptr_t(CharLowerW(LPWSTR(uintptr_t(c)))));
-            d = (d > 0xffff) ? d : int(uintptr_t(CharLowerW(LPWSTR(uintptr_t(d)))));
+            c = tables.lower(c);
+            d = tables.lower(d);
         }
 
         if (MODE > 1)
@@ -75,8 +191,8 @@ int str_compare_impl(str_iter_impl<T>& lhs, str_iter_impl<T>& rhs)
         {
             if (!fuzzy_accents)
                 break;
-            c = normalize_accent(c);
-            d = normalize_accent(d);
+            c = tables.unaccent(c);
+            d = tables.unaccent(d);
             if (c != d)
                 break;
         }
@@ -137,3 +253,53 @@ int str_compare(const str_impl<T>& lhs, const str_impl<T>& rhs)
     str_iter_impl<T> rhs_iter(rhs);
     return str_compare<T, compute_lcd>(lhs_iter, rhs_iter);
 }
+
+//------------------------------------------------------------------------------
+template <class T, int MODE, bool fuzzy_accents>
+int str_compute_lcd_impl(const T* const* strs, unsigned int count, unsigned int skip, bool sorted)
+{
+    if (!count)
+        return 0;
+
+    const T* first = strs[0] + skip;
+    int lcd = int(str_iter_impl<T>(first).length());
+
+    // Each string only needs comparing as far as the common prefix found so
+    // far, so the work shrinks along with the prefix.
+    for (unsigned int i = sorted ? count - 1 : 1; i < count && lcd > 0; ++i)
+    {
+        str_iter_impl<T> lhs(first, lcd);
+        str_iter_impl<T> rhs(strs[i] + skip);
+        const int len = str_compare_impl<T, MODE, fuzzy_accents, true>(lhs, rhs);
+        if (lcd > len)
+            lcd = len;
+    }
+
+    return lcd;
+}
+
+//------------------------------------------------------------------------------
+// Returns the length of the longest common prefix of the strings, in code units
+// of strs[0], per the current str_compare_scope.  The first skip code units of
+// each string are ignored.
+//
+// If the strings are sorted in an order consistent with the scope (so strings
+// sharing a prefix are adjacent), pass sorted=true and only the first and last
+// strings are compared.
+template <class T>
+int str_compute_lcd(const T* const* strs, unsigned int count, unsigned int skip=0, bool sorted=false)
+{
+    bool fuzzy_accents = str_compare_scope::current_fuzzy_accents();
+    switch (str_compare_scope::current())
+    {
+    case str_compare_scope::relaxed:
+        if (fuzzy_accents)  return str_compute_lcd_impl<T, 2, true>(strs, count, skip, sorted);
+        else                return str_compute_lcd_impl<T, 2, false>(strs, count, skip, sorted);
+    case str_compare_scope::caseless:
+        if (fuzzy_accents)  return str_compute_lcd_impl<T, 1, true>(strs, count, skip, sorted);
+        else                return str_compute_lcd_impl<T, 1, false>(strs, count, skip, sorted);
+    default:
+        if (fuzzy_accents)  return str_compute_lcd_impl<T, 0, true>(strs, count, skip, sorted);
+        else                return str_compute_lcd_impl<T, 0, false>(strs, count, skip, sorted);
+    }
+}
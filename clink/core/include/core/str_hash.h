@@ -29,3 +29,40 @@ inline unsigned int wstr_hash(const wchar_t* in, int length=-1)
 {
     return str_hash_impl<wchar_t>(in, length);
 }
+
+//------------------------------------------------------------------------------
+// FNV-1a followed by the MurmurHash3 64 bit finalizer.  Unlike str_hash(), the
+// low bits are well distributed, so it is suitable for open addressing tables
+// that mask the hash to a power of two capacity.
+template <typename T> unsigned int str_hash_mixed_impl(const T* in, unsigned int length)
+{
+    unsigned long long hash = 0xcbf29ce484222325ull;
+
+    while (int c = *in++)
+    {
+        hash ^= (unsigned int)c;
+        hash *= 0x100000001b3ull;
+        if (!--length)
+            break;
+    }
+
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdull;
+    hash ^= hash >> 33;
+    hash *= 0xc4ceb9fe1a85ec53ull;
+    hash ^= hash >> 33;
+
+    return (unsigned int)hash;
+}
+
+//------------------------------------------------------------------------------
+inline unsigned int str_hash_mixed(const char* in, int length=-1)
+{
+    return str_hash_mixed_impl<unsigned char>((const unsigned char*)in, length);
+}
+
+//------------------------------------------------------------------------------
+inline unsigned int wstr_hash_mixed(const wchar_t* in, int length=-1)
+{
+    return str_hash_mixed_impl<wchar_t>(in, length);
+}
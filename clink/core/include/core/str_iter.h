@@ -21,6 +21,8 @@ public:
     int             next();
     bool            more() const;
     unsigned int    length() const;
+    bool            can_read(unsigned int n) const;
+    void            advance(unsigned int n);
 
 private:
     const T*        m_ptr;
@@ -97,6 +99,28 @@ template <typename T> bool str_iter_impl<T>::more() const
 
 
 
+//------------------------------------------------------------------------------
+// Returns whether n units can be read directly from get_pointer().  This
+// doesn't check for a nul terminator, so unbounded iterators only allow reads
+// that stay within the current page.
+template <typename T> bool str_iter_impl<T>::can_read(unsigned int n) const
+{
+    if (m_ptr <= m_end && unsigned(m_end - m_ptr) < n)
+        return false;
+    return ((uintptr_t(m_ptr) & 0xfff) + n * sizeof(T)) <= 0x1000;
+}
+
+//------------------------------------------------------------------------------
+// Skips n units; the caller must already know they're readable and contain no
+// nul terminator.
+template <typename T> void str_iter_impl<T>::advance(unsigned int n)
+{
+    assert(can_read(n));
+    m_ptr += n;
+}
+
+
+
 //------------------------------------------------------------------------------
 typedef str_iter_impl<char>     str_iter;
 typedef str_iter_impl<wchar_t>  wstr_iter;
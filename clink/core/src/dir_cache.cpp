@@ -0,0 +1,304 @@
+// Copyright (c) 2021 Christopher Antos
+// License: http://opensource.org/licenses/MIT
+
+#include "pch.h"
+#include "dir_cache.h"
+#include "str.h"
+
+//------------------------------------------------------------------------------
+// Large enough to hold every directory in a long PATH (see exec_index) plus the
+// directories recently used for file completion.
+static const unsigned int c_max_dirs = 256;
+
+// A snapshot taken within this many seconds of the directory's last write
+// time isn't trusted, since a further change within the file system's
+// timestamp granularity would go unnoticed.
+static const ULONGLONG c_racy_window = 2 * ULONGLONG(10000000);
+
+
+
+//------------------------------------------------------------------------------
+class dir_snapshot_builder
+{
+public:
+    static std::shared_ptr<const dir_snapshot> build(const wchar_t* dir);
+};
+
+//------------------------------------------------------------------------------
+std::shared_ptr<const dir_snapshot> dir_snapshot_builder::build(const wchar_t* dir)
+{
+    wstr<280> pattern(dir);
+    if (pattern.length() && pattern.c_str()[pattern.length() - 1] != '\\')
+        pattern << L"\\";
+    pattern << L"*";
+
+    WIN32_FIND_DATAW fd;
+    HANDLE h = FindFirstFileExW(pattern.c_str(), FindExInfoBasic, &fd, FindExSearchNameMatch, nullptr, FIND_FIRST_EX_LARGE_FETCH);
+    if (h == INVALID_HANDLE_VALUE)
+        return nullptr;
+
+    std::shared_ptr<dir_snapshot> snapshot = std::make_shared<dir_snapshot>();
+    do
+    {
+        dir_snapshot::entry entry;
+        entry.name_offset = (unsigned int)(snapshot->m_names.size());
+        entry.attr = fd.dwFileAttributes;
+        entry.reparse_tag = fd.dwReserved0;
+        entry.size = (ULONGLONG(fd.nFileSizeHigh) << 32) | fd.nFileSizeLow;
+        entry.accessed = fd.ftLastAccessTime;
+        entry.modified = fd.ftLastWriteTime;
+        entry.created = fd.ftCreationTime;
+        snapshot->m_entries.push_back(entry);
+
+        const wchar_t* name = fd.cFileName;
+        snapshot->m_names.insert(snapshot->m_names.end(), name, name + wcslen(name) + 1);
+    }
+    while (FindNextFileW(h, &fd));
+
+    FindClose(h);
+    return snapshot;
+}
+
+
+
+//------------------------------------------------------------------------------
+namespace dir_cache
+{
+
+//------------------------------------------------------------------------------
+struct cached_dir
+{
+    wstr_moveable           key;
+    std::shared_ptr<const dir_snapshot> snapshot;
+    FILETIME                modified;
+    bool                    racy;
+    unsigned int            tick;
+};
+
+//------------------------------------------------------------------------------
+static struct cache_state
+{
+                            cache_state() { InitializeCriticalSection(&lock); }
+                            ~cache_state() { DeleteCriticalSection(&lock); }
+    CRITICAL_SECTION        lock;
+    std::vector<cached_dir> dirs;
+    unsigned int            tick = 0;
+    unsigned int            hits = 0;
+    unsigned int            misses = 0;
+    unsigned int            invalidations = 0;
+    unsigned int            evictions = 0;
+} s_cache;
+
+//------------------------------------------------------------------------------
+class lock_scope
+{
+public:
+                            lock_scope() { EnterCriticalSection(&s_cache.lock); }
+                            ~lock_scope() { LeaveCriticalSection(&s_cache.lock); }
+};
+
+//------------------------------------------------------------------------------
+static bool is_valid(const cached_dir& dir, const FILETIME& modified)
+{
+    if (dir.racy)
+        return false;
+    return CompareFileTime(&dir.modified, &modified) == 0;
+}
+
+//------------------------------------------------------------------------------
+static int find_dir(const wchar_t* full)
+{
+    for (unsigned int index = 0; index < s_cache.dirs.size(); ++index)
+        if (_wcsicmp(s_cache.dirs[index].key.c_str(), full) == 0)
+            return int(index);
+    return -1;
+}
+
+//------------------------------------------------------------------------------
+static void remove_dir(unsigned int index)
+{
+    if (index + 1 < s_cache.dirs.size())
+        s_cache.dirs[index] = std::move(s_cache.dirs.back());
+    s_cache.dirs.pop_back();
+}
+
+//------------------------------------------------------------------------------
+std::shared_ptr<const dir_snapshot> get(const wchar_t* dir)
+{
+    wstr<280> full;
+    {
+        const wchar_t* in = (dir && *dir) ? dir : L".";
+        DWORD len = GetFullPathNameW(in, full.size(), full.data(), nullptr);
+        if (!len || len >= full.size())
+            return nullptr;
+        while (len > 3 && full.c_str()[len - 1] == '\\')
+            full.data()[--len] = '\0';
+    }
+
+    WIN32_FILE_ATTRIBUTE_DATA fad;
+    if (!GetFileAttributesExW(full.c_str(), GetFileExInfoStandard, &fad) ||
+        !(fad.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY))
+        return nullptr;
+
+    {
+        lock_scope lock;
+
+        const int index = find_dir(full.c_str());
+        if (index >= 0)
+        {
+            cached_dir& cached = s_cache.dirs[index];
+            if (is_valid(cached, fad.ftLastWriteTime))
+            {
+                s_cache.hits++;
+                cached.tick = ++s_cache.tick;
+                return cached.snapshot;
+            }
+
+            s_cache.invalidations++;
+        }
+
+        s_cache.misses++;
+    }
+
+    // Enumerate the directory without holding the lock, so that a slow (e.g.
+    // network) directory doesn't stall lookups of other directories.
+    std::shared_ptr<const dir_snapshot> snapshot = dir_snapshot_builder::build(full.c_str());
+
+    FILETIME now;
+    GetSystemTimeAsFileTime(&now);
+    ULONGLONG now_ull = (ULONGLONG(now.dwHighDateTime) << 32) | now.dwLowDateTime;
+    ULONGLONG mod_ull = (ULONGLONG(fad.ftLastWriteTime.dwHighDateTime) << 32) | fad.ftLastWriteTime.dwLowDateTime;
+    const bool racy = (now_ull < mod_ull + c_racy_window);
+
+    lock_scope lock;
+
+    // Another thread may have updated the directory in the meantime.
+    int index = find_dir(full.c_str());
+    if (!snapshot)
+    {
+        if (index >= 0)
+            remove_dir(index);
+        return nullptr;
+    }
+
+    if (index < 0)
+    {
+        if (s_cache.dirs.size() >= c_max_dirs)
+        {
+            unsigned int oldest = 0;
+            for (unsigned int i = 1; i < s_cache.dirs.size(); ++i)
+                if (s_cache.dirs[i].tick < s_cache.dirs[oldest].tick)
+                    oldest = i;
+            remove_dir(oldest);
+            s_cache.evictions++;
+        }
+
+        cached_dir added;
+        added.key = full.c_str();
+        s_cache.dirs.emplace_back(std::move(added));
+        index = int(s_cache.dirs.size() - 1);
+    }
+
+    cached_dir& cached = s_cache.dirs[index];
+    cached.snapshot = snapshot;
+    cached.modified = fad.ftLastWriteTime;
+    cached.racy = racy;
+    cached.tick = ++s_cache.tick;
+    return snapshot;
+}
+
+//------------------------------------------------------------------------------
+bool is_cacheable_pattern(const wchar_t* name)
+{
+    // Only simple patterns are matched against snapshots.  FindFirstFile has
+    // quirks for `?`, trailing dots, and the DOS wildcards `<`, `>`, and `"`;
+    // patterns that could depend on those fall back to FindFirstFile.
+    //
+    // Snapshots only hold long names, so unlike FindFirstFile, matching never
+    // considers 8.3 short names:  `mydoc*` doesn't match "My Documents" via
+    // its short name "MYDOCU~1", and `*.htm` doesn't match "a.html".  Patterns
+    // containing `~` can only be meant for short names, so they fall back.
+    if (!name || !*name)
+        return false;
+
+    for (const wchar_t* p = name; *p; ++p)
+    {
+        switch (*p)
+        {
+        case '?':
+        case '<':
+        case '>':
+        case '"':
+        case '~':
+        case '\\':
+        case '/':
+        case ':':
+            return false;
+        }
+    }
+
+    return name[wcslen(name) - 1] != '.';
+}
+
+//------------------------------------------------------------------------------
+static wchar_t fold(wchar_t c)
+{
+    return wchar_t(uintptr_t(CharLowerW(LPWSTR(uintptr_t(c)))));
+}
+
+//------------------------------------------------------------------------------
+bool match_name(const wchar_t* pattern, const wchar_t* name)
+{
+    // `*.*` matches everything, the same as `*`.
+    if (wcscmp(pattern, L"*.*") == 0)
+        return true;
+
+    const wchar_t* star_pattern = nullptr;
+    const wchar_t* star_name = nullptr;
+    while (*name)
+    {
+        if (*pattern == '*')
+        {
+            star_pattern = ++pattern;
+            star_name = name;
+        }
+        else if (*pattern && fold(*pattern) == fold(*name))
+        {
+            ++pattern;
+            ++name;
+        }
+        else if (star_pattern)
+        {
+            pattern = star_pattern;
+            name = ++star_name;
+        }
+        else
+        {
+            return false;
+        }
+    }
+
+    while (*pattern == '*')
+        ++pattern;
+    return !*pattern;
+}
+
+//------------------------------------------------------------------------------
+void clear()
+{
+    lock_scope lock;
+    s_cache.dirs.clear();
+}
+
+//------------------------------------------------------------------------------
+void get_stats(dir_cache_stats& stats)
+{
+    lock_scope lock;
+    stats.dirs = (unsigned int)(s_cache.dirs.size());
+    stats.hits = s_cache.hits;
+    stats.misses = s_cache.misses;
+    stats.invalidations = s_cache.invalidations;
+    stats.evictions = s_cache.evictions;
+}
+
+}; // namespace dir_cache
@@ -0,0 +1,248 @@
+// Copyright (c) 2021 Christopher Antos
+// License: http://opensource.org/licenses/MIT
+
+#include "pch.h"
+#include "exec_index.h"
+#include "dir_cache.h"
+#include "str.h"
+#include "str_tokeniser.h"
+
+#include <algorithm>
+
+//------------------------------------------------------------------------------
+class exec_index_builder
+{
+public:
+    struct candidate
+    {
+        const wchar_t*      name;
+        unsigned int        dir;
+        const dir_snapshot::entry* entry;
+    };
+
+    static std::shared_ptr<const exec_list> build(const std::vector<str_moveable>& dirs, std::vector<candidate>& candidates);
+};
+
+//------------------------------------------------------------------------------
+static void append_string(std::vector<char>& strings, const char* s, unsigned int len)
+{
+    strings.insert(strings.end(), s, s + len + 1);
+}
+
+//------------------------------------------------------------------------------
+std::shared_ptr<const exec_list> exec_index_builder::build(const std::vector<str_moveable>& dirs, std::vector<candidate>& candidates)
+{
+    // Candidates are in PATH order, so a stable sort keeps the first directory
+    // first among names that compare equal.
+    std::stable_sort(candidates.begin(), candidates.end(), [](const candidate& a, const candidate& b) {
+        return _wcsicmp(a.name, b.name) < 0;
+    });
+
+    std::shared_ptr<exec_list> list = std::make_shared<exec_list>();
+
+    std::vector<unsigned int> dir_offsets;
+    dir_offsets.reserve(dirs.size());
+    for (const auto& dir : dirs)
+    {
+        dir_offsets.push_back((unsigned int)(list->m_strings.size()));
+        append_string(list->m_strings, dir.c_str(), dir.length());
+    }
+
+    str<280> name;
+    const wchar_t* prev = nullptr;
+    for (const auto& c : candidates)
+    {
+        if (prev && _wcsicmp(prev, c.name) == 0)
+            continue;
+        prev = c.name;
+
+        exec_list::entry entry;
+        entry.name_offset = (unsigned int)(list->m_strings.size());
+        entry.dir_offset = dir_offsets[c.dir];
+        entry.attr = c.entry->attr;
+        entry.reparse_tag = c.entry->reparse_tag;
+        list->m_entries.push_back(entry);
+
+        name = c.name;
+        append_string(list->m_strings, name.c_str(), name.length());
+    }
+
+    return list;
+}
+
+
+
+//------------------------------------------------------------------------------
+namespace exec_index
+{
+
+//------------------------------------------------------------------------------
+struct indexed_dir
+{
+    std::shared_ptr<const dir_snapshot> snapshot;
+    std::vector<unsigned int> execs;
+};
+
+//------------------------------------------------------------------------------
+static struct index_state
+{
+                            index_state() { InitializeCriticalSection(&lock); }
+                            ~index_state() { DeleteCriticalSection(&lock); }
+    CRITICAL_SECTION        lock;
+    str_moveable            paths;
+    str_moveable            pathexts;
+    std::vector<str_moveable> dir_names;
+    std::vector<indexed_dir> dirs;
+    std::vector<wstr_moveable> exts;
+    std::shared_ptr<const exec_list> list;
+} s_index;
+
+//------------------------------------------------------------------------------
+class lock_scope
+{
+public:
+                            lock_scope() { EnterCriticalSection(&s_index.lock); }
+                            ~lock_scope() { LeaveCriticalSection(&s_index.lock); }
+};
+
+//------------------------------------------------------------------------------
+static void parse_lists(const char* paths, const char* pathexts)
+{
+    s_index.paths = paths;
+    s_index.pathexts = pathexts;
+    s_index.dir_names.clear();
+    s_index.dirs.clear();
+    s_index.exts.clear();
+    s_index.list.reset();
+
+    const char* start;
+    int length;
+
+    str_tokeniser dir_tokens(paths, ";");
+    while (dir_tokens.next(start, length))
+    {
+        str_moveable dir;
+        concat_strip_quotes(dir, start, length);
+        dir.trim();
+        if (dir.empty())
+            continue;
+
+        bool dupe = false;
+        for (const auto& existing : s_index.dir_names)
+            if (_stricmp(existing.c_str(), dir.c_str()) == 0)
+            {
+                dupe = true;
+                break;
+            }
+        if (dupe)
+            continue;
+
+        s_index.dir_names.emplace_back(std::move(dir));
+    }
+
+    s_index.dirs.resize(s_index.dir_names.size());
+
+    str_tokeniser ext_tokens(pathexts, ";");
+    while (ext_tokens.next(start, length))
+    {
+        str<32> ext;
+        ext.concat(start, length);
+        ext.trim();
+        if (ext.empty())
+            continue;
+        s_index.exts.emplace_back(ext.c_str());
+    }
+}
+
+//------------------------------------------------------------------------------
+static bool is_executable(const wchar_t* name)
+{
+    const wchar_t* ext = wcsrchr(name, '.');
+    if (!ext)
+        return false;
+
+    for (const auto& e : s_index.exts)
+        if (_wcsicmp(ext, e.c_str()) == 0)
+            return true;
+
+    return false;
+}
+
+//------------------------------------------------------------------------------
+static void filter_dir(indexed_dir& dir)
+{
+    dir.execs.clear();
+    if (!dir.snapshot)
+        return;
+
+    for (unsigned int i = 0; i < dir.snapshot->size(); ++i)
+    {
+        if (dir.snapshot->get_entry(i).attr & FILE_ATTRIBUTE_DIRECTORY)
+            continue;
+        if (is_executable(dir.snapshot->get_name(i)))
+            dir.execs.push_back(i);
+    }
+}
+
+//------------------------------------------------------------------------------
+std::shared_ptr<const exec_list> get(const char* paths, const char* pathexts)
+{
+    lock_scope lock;
+
+    if (!paths)
+        paths = "";
+    if (!pathexts)
+        pathexts = "";
+
+    if (!s_index.list ||
+        strcmp(s_index.paths.c_str(), paths) != 0 ||
+        strcmp(s_index.pathexts.c_str(), pathexts) != 0)
+        parse_lists(paths, pathexts);
+
+    // Revalidate each directory; only directories whose listing changed need
+    // to be filtered again.
+    bool changed = !s_index.list;
+    wstr<280> wdir;
+    for (unsigned int i = 0; i < s_index.dirs.size(); ++i)
+    {
+        wdir = s_index.dir_names[i].c_str();
+        std::shared_ptr<const dir_snapshot> snapshot = dir_cache::get(wdir.c_str());
+
+        indexed_dir& dir = s_index.dirs[i];
+        if (snapshot == dir.snapshot)
+            continue;
+
+        dir.snapshot = std::move(snapshot);
+        filter_dir(dir);
+        changed = true;
+    }
+
+    if (changed)
+    {
+        std::vector<exec_index_builder::candidate> candidates;
+        for (unsigned int i = 0; i < s_index.dirs.size(); ++i)
+        {
+            const indexed_dir& dir = s_index.dirs[i];
+            for (unsigned int j : dir.execs)
+                candidates.push_back({ dir.snapshot->get_name(j), i, &dir.snapshot->get_entry(j) });
+        }
+
+        s_index.list = exec_index_builder::build(s_index.dir_names, candidates);
+    }
+
+    return s_index.list;
+}
+
+//------------------------------------------------------------------------------
+void clear()
+{
+    lock_scope lock;
+    s_index.paths.clear();
+    s_index.pathexts.clear();
+    s_index.dir_names.clear();
+    s_index.dirs.clear();
+    s_index.exts.clear();
+    s_index.list.reset();
+}
+
+}; // namespace exec_index
@@ -3,6 +3,7 @@
 
 #include "pch.h"
 #include "globber.h"
+#include "dir_cache.h"
 #include "os.h"
 #include "path.h"
 #include "str.h"
@@ -10,13 +11,20 @@
 #include <sys/stat.h>
 
 //------------------------------------------------------------------------------
+// The search is opened lazily by the first call to next(), so that options such
+// as cached() can be set after construction.
 globber::globber(const char* pattern)
-: m_files(true)
+: m_handle(nullptr)
+, m_snapshot_index(0)
+, m_name_offset(0)
+, m_files(true)
 , m_directories(true)
 , m_dir_suffix(true)
 , m_hidden(false)
 , m_system(false)
 , m_dots(false)
+, m_cached(false)
+, m_opened(false)
 , m_onlyolder(false)
 {
     str<32> strip_quotes;
@@ -27,7 +35,7 @@ globber::globber(const char* pattern)
     // both a server and share component.
     if (path::is_incomplete_unc(pattern))
     {
-        m_handle = nullptr;
+        m_opened = true;
         return;
     }
 
@@ -62,10 +70,14 @@ globber::globber(const char* pattern)
         }
     }
 
-    wstr<280> wglob(pattern);
-    m_handle = FindFirstFileW(wglob.c_str(), &m_data);
-    if (m_handle == INVALID_HANDLE_VALUE)
-        m_handle = nullptr;
+    m_pattern = pattern;
+    if (const char* name = path::get_name(pattern))
+    {
+        str<280> dir;
+        dir.concat(pattern, int(name - pattern));
+        wstr<280> wdir(dir.c_str());
+        m_name_offset = wdir.length();
+    }
 
     path::get_directory(pattern, m_root);
     path::normalise_separators(m_root.data());
@@ -78,6 +90,38 @@ globber::~globber()
         FindClose(m_handle);
 }
 
+//------------------------------------------------------------------------------
+void globber::open()
+{
+    m_opened = true;
+
+    // Simple patterns are matched against a cached snapshot of the directory,
+    // when the caller allows it.
+    const wchar_t* name = m_pattern.c_str() + m_name_offset;
+    if (m_cached && dir_cache::is_cacheable_pattern(name))
+    {
+        wstr<280> dir;
+        dir.concat(m_pattern.c_str(), m_name_offset);
+        m_snapshot = dir_cache::get(dir.c_str());
+        if (m_snapshot)
+        {
+            m_snapshot_index = 0;
+            next_snapshot_file();
+            return;
+        }
+    }
+
+    m_handle = FindFirstFileW(m_pattern.c_str(), &m_data);
+    if (m_handle == INVALID_HANDLE_VALUE)
+        m_handle = nullptr;
+}
+
+//------------------------------------------------------------------------------
+bool globber::has_file() const
+{
+    return m_handle != nullptr || m_snapshot;
+}
+
 //------------------------------------------------------------------------------
 bool globber::older_than(int seconds)
 {
@@ -88,6 +132,8 @@ bool globber::older_than(int seconds)
         if (m_handle != nullptr)
             FindClose(m_handle);
         m_handle = nullptr;
+        m_snapshot.reset();
+        m_opened = true;
         return false;
     }
 
@@ -107,7 +153,10 @@ bool globber::older_than(int seconds)
 //------------------------------------------------------------------------------
 bool globber::next(str_base& out, bool rooted, extrainfo* extrainfo)
 {
-    if (m_handle == nullptr)
+    if (!m_opened)
+        open();
+
+    if (!has_file())
         return false;
 
     str<280> file_name;
@@ -120,7 +169,7 @@ bool globber::next(str_base& out, bool rooted, extrainfo* extrainfo)
 
     while (true)
     {
-        if (m_handle == nullptr)
+        if (!has_file())
             return false;
 
         file_name = m_data.cFileName;
@@ -191,9 +240,44 @@ bool globber::next(str_base& out, bool rooted, extrainfo* extrainfo)
 //------------------------------------------------------------------------------
 void globber::next_file()
 {
+    if (m_snapshot)
+    {
+        next_snapshot_file();
+        return;
+    }
+
     if (FindNextFileW(m_handle, &m_data))
         return;
 
     FindClose(m_handle);
     m_handle = nullptr;
 }
+
+//------------------------------------------------------------------------------
+// Fills m_data from the next snapshot entry that matches the pattern, so that
+// next() needn't care where the data came from.
+bool globber::next_snapshot_file()
+{
+    const wchar_t* pattern = m_pattern.c_str() + m_name_offset;
+    while (m_snapshot_index < m_snapshot->size())
+    {
+        unsigned int index = m_snapshot_index++;
+        const wchar_t* name = m_snapshot->get_name(index);
+        if (!dir_cache::match_name(pattern, name))
+            continue;
+
+        const dir_snapshot::entry& entry = m_snapshot->get_entry(index);
+        wcsncpy_s(m_data.cFileName, _countof(m_data.cFileName), name, _TRUNCATE);
+        m_data.dwFileAttributes = entry.attr;
+        m_data.dwReserved0 = entry.reparse_tag;
+        m_data.nFileSizeLow = DWORD(entry.size);
+        m_data.nFileSizeHigh = DWORD(entry.size >> 32);
+        m_data.ftLastAccessTime = entry.accessed;
+        m_data.ftLastWriteTime = entry.modified;
+        m_data.ftCreationTime = entry.created;
+        return true;
+    }
+
+    m_snapshot.reset();
+    return false;
+}
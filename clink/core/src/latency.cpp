@@ -0,0 +1,129 @@
+// Copyright (c) 2021 Christopher Antos
+// License: http://opensource.org/licenses/MIT
+
+#include "pch.h"
+#include "latency.h"
+#include "base.h"
+
+//------------------------------------------------------------------------------
+// Upper bounds (exclusive) of the histogram buckets, in microseconds.  The last
+// bucket is unbounded.
+static const unsigned int c_bucket_limits[latency_histogram::num_buckets - 1] =
+{
+    50, 100, 250, 500, 1000, 2500, 5000, 10000, 25000, 50000, 100000,
+};
+
+static const char* const c_phase_names[] =
+{
+    "input",
+    "dispatch",
+    "update",
+    "generate",
+    "restrict",
+    "select",
+    "sort",
+    "classify",
+    "prompt",
+    "redisplay",
+    "gc",
+};
+static_assert(sizeof_array(c_phase_names) == size_t(latency_phase::max), "phase names mismatch");
+
+static latency_histogram s_histograms[size_t(latency_phase::max)];
+static long long s_frequency = 0;
+bool latency_span::s_enabled = false;
+
+
+
+//------------------------------------------------------------------------------
+long long latency_span::now()
+{
+    LARGE_INTEGER counter;
+    QueryPerformanceCounter(&counter);
+    return counter.QuadPart;
+}
+
+//------------------------------------------------------------------------------
+void latency_span::stop(latency_phase phase, long long started)
+{
+    if (!started || !s_frequency)
+        return;
+
+    const long long ticks = now() - started;
+    latency::record(phase, (unsigned long long)(ticks) * 1000000 / s_frequency);
+}
+
+
+
+namespace latency
+{
+
+//------------------------------------------------------------------------------
+void enable(bool enable)
+{
+    if (enable && !s_frequency)
+    {
+        LARGE_INTEGER frequency;
+        if (!QueryPerformanceFrequency(&frequency) || !frequency.QuadPart)
+            return;
+        s_frequency = frequency.QuadPart;
+    }
+
+    latency_span::s_enabled = enable;
+}
+
+//------------------------------------------------------------------------------
+bool is_enabled()
+{
+    return latency_span::s_enabled;
+}
+
+//------------------------------------------------------------------------------
+void reset()
+{
+    memset(s_histograms, 0, sizeof(s_histograms));
+}
+
+//------------------------------------------------------------------------------
+void record(latency_phase phase, unsigned long long us)
+{
+    if (size_t(phase) >= size_t(latency_phase::max))
+        return;
+
+    unsigned int bucket = 0;
+    while (bucket < sizeof_array(c_bucket_limits) && us >= c_bucket_limits[bucket])
+        ++bucket;
+
+    latency_histogram& h = s_histograms[size_t(phase)];
+    h.buckets[bucket]++;
+    h.count++;
+    h.total_us += us;
+    if (h.max_us < us)
+        h.max_us = us;
+}
+
+//------------------------------------------------------------------------------
+bool get_histogram(latency_phase phase, latency_histogram& out)
+{
+    if (size_t(phase) >= size_t(latency_phase::max))
+        return false;
+
+    out = s_histograms[size_t(phase)];
+    return true;
+}
+
+//------------------------------------------------------------------------------
+const char* get_phase_name(latency_phase phase)
+{
+    if (size_t(phase) >= size_t(latency_phase::max))
+        return nullptr;
+    return c_phase_names[size_t(phase)];
+}
+
+//------------------------------------------------------------------------------
+unsigned int get_bucket_limit(unsigned int bucket)
+{
+    return (bucket < sizeof_array(c_bucket_limits)) ? c_bucket_limits[bucket] : 0;
+}
+
+}; // namespace latency
@@ -314,6 +314,53 @@ bool copy(const char* src_path, const char* dest_path)
     return false;
 }
 
+//------------------------------------------------------------------------------
+// Calls writer to write a temporary file next to path, and then replaces path
+// with it.  Concurrent processes never see a partially written file.
+bool atomic_write_file(const char* path, bool (*writer)(FILE* file, void* param), void* param)
+{
+    str<280> tmp;
+    tmp.format("%s.%u", path, GetCurrentProcessId());
+
+    wstr<280> wtmp(tmp.c_str());
+    FILE* file = _wfopen(wtmp.c_str(), L"wb");
+    if (!file)
+    {
+        map_errno();
+        return false;
+    }
+
+    bool ok = writer(file, param);
+    ok = (fclose(file) == 0) && ok;
+
+    wstr<280> wpath(path);
+    if (!ok || !MoveFileExW(wtmp.c_str(), wpath.c_str(), MOVEFILE_REPLACE_EXISTING))
+    {
+        _wunlink(wtmp.c_str());
+        return false;
+    }
+
+    return true;
+}
+
+//------------------------------------------------------------------------------
+// Gets the size and last write time of a file, which together identify a
+// version of the file cheaply enough for cache validation.
+bool get_file_stamp(const char* path, unsigned long long& size, unsigned long long& mtime)
+{
+    wstr<280> wpath(path);
+    WIN32_FILE_ATTRIBUTE_DATA fad;
+    if (!GetFileAttributesExW(wpath.c_str(), GetFileExInfoStandard, &fad))
+    {
+        map_errno();
+        return false;
+    }
+
+    size = (unsigned long long)(fad.nFileSizeHigh) << 32 | fad.nFileSizeLow;
+    mtime = (unsigned long long)(fad.ftLastWriteTime.dwHighDateTime) << 32 | fad.ftLastWriteTime.dwLowDateTime;
+    return true;
+}
+
 //------------------------------------------------------------------------------
 bool get_temp_dir(str_base& out)
 {
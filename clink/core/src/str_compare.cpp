@@ -4,6 +4,8 @@
 #include "pch.h"
 #include "str_compare.h"
 
+#include <vector>
+
 threadlocal int str_compare_scope::ts_mode = str_compare_scope::exact;
 threadlocal bool str_compare_scope::ts_fuzzy_accents = false;
 
@@ -395,3 +397,66 @@ int normalize_accent(int c)
 
     return c;
 }
+
+
+
+//------------------------------------------------------------------------------
+const fold_tables& fold_tables::get()
+{
+    static const fold_tables s_tables;
+    return s_tables;
+}
+
+//------------------------------------------------------------------------------
+fold_tables::fold_tables()
+{
+    wchar_t block[256];
+
+    // Block 0 is the identity block.
+    for (unsigned int lo = 0; lo < 256; ++lo)
+        block[lo] = wchar_t(lo);
+    m_storage.assign(block, block + 256);
+
+    for (unsigned int hi = 0; hi < 256; ++hi)
+    {
+        for (unsigned int lo = 0; lo < 256; ++lo)
+        {
+            unsigned int c = (hi << 8) | lo;
+            block[lo] = wchar_t(uintptr_t(CharLowerW(LPWSTR(uintptr_t(c)))));
+        }
+        m_lower_index[hi] = add_block(block);
+    }
+
+    for (unsigned int hi = 0; hi < 256; ++hi)
+    {
+        for (unsigned int lo = 0; lo < 256; ++lo)
+            block[lo] = wchar_t(normalize_accent((hi << 8) | lo));
+        m_accent_index[hi] = add_block(block);
+    }
+
+    m_blocks = m_storage.data();
+
+    m_ascii_simple = true;
+    for (unsigned int c = 0; c < 128; ++c)
+    {
+        m_ascii_lower[c] = m_blocks[(m_lower_index[0] << 8) | c];
+        unsigned int expected = (c >= 'A' && c <= 'Z') ? c + 0x20 : c;
+        if (m_ascii_lower[c] != expected)
+            m_ascii_simple = false;
+    }
+}
+
+//------------------------------------------------------------------------------
+// Returns the index of a block with the given contents, reusing an identical
+// block if there is one (most blocks are identity blocks).
+unsigned short fold_tables::add_block(const wchar_t* block)
+{
+    const unsigned int bytes = 256 * sizeof(wchar_t);
+    const unsigned int count = (unsigned int)(m_storage.size() / 256);
+    for (unsigned int i = 0; i < count; ++i)
+        if (memcmp(m_storage.data() + (i << 8), block, bytes) == 0)
+            return (unsigned short)i;
+
+    m_storage.insert(m_storage.end(), block, block + 256);
+    return (unsigned short)count;
+}
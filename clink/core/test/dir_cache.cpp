@@ -0,0 +1,87 @@
+// Copyright (c) 2021 Christopher Antos
+// License: http://opensource.org/licenses/MIT
+
+#include "pch.h"
+#include "fs_fixture.h"
+
+#include <core/dir_cache.h>
+#include <core/globber.h>
+#include <core/str.h>
+
+#include <set>
+#include <string>
+
+//------------------------------------------------------------------------------
+static std::set<std::string> glob(const char* pattern, bool cached)
+{
+    std::set<std::string> names;
+    globber globber(pattern);
+    globber.cached(cached);
+    str<> name;
+    while (globber.next(name, false))
+        names.insert(name.c_str());
+    return names;
+}
+
+//------------------------------------------------------------------------------
+TEST_CASE("Directory cache")
+{
+    SECTION("Cacheable patterns")
+    {
+        REQUIRE(dir_cache::is_cacheable_pattern(L"*"));
+        REQUIRE(dir_cache::is_cacheable_pattern(L"*.*"));
+        REQUIRE(dir_cache::is_cacheable_pattern(L"abc*"));
+        REQUIRE(dir_cache::is_cacheable_pattern(L"*.exe"));
+        REQUIRE(!dir_cache::is_cacheable_pattern(L""));
+        REQUIRE(!dir_cache::is_cacheable_pattern(L"a?c"));
+        REQUIRE(!dir_cache::is_cacheable_pattern(L"abc."));
+        REQUIRE(!dir_cache::is_cacheable_pattern(L"progra~*"));
+        REQUIRE(!dir_cache::is_cacheable_pattern(L"a<b"));
+    }
+
+    SECTION("Match names")
+    {
+        REQUIRE(dir_cache::match_name(L"*", L"abc"));
+        REQUIRE(dir_cache::match_name(L"*.*", L"abc"));
+        REQUIRE(dir_cache::match_name(L"ab*", L"ABC"));
+        REQUIRE(dir_cache::match_name(L"*.exe", L"foo.EXE"));
+        REQUIRE(dir_cache::match_name(L"*.exe", L"foo.bar.exe"));
+        REQUIRE(dir_cache::match_name(L"f*o*r", L"foobar"));
+        REQUIRE(!dir_cache::match_name(L"*.exe", L"foo.exex"));
+        REQUIRE(!dir_cache::match_name(L"ab*", L"xabc"));
+        REQUIRE(!dir_cache::match_name(L"abc", L"abcd"));
+    }
+
+    SECTION("Globbing")
+    {
+        fs_fixture fs;
+        dir_cache::clear();
+
+        static const char* patterns[] = { "*", "file*", "dir1\\*", "*_2", "nope*" };
+        for (auto pattern : patterns)
+        {
+            std::set<std::string> uncached = glob(pattern, false);
+            REQUIRE(glob(pattern, true) == uncached);
+            REQUIRE(glob(pattern, true) == uncached);
+        }
+
+        dir_cache_stats stats;
+        dir_cache::get_stats(stats);
+        REQUIRE(stats.misses > 0);
+    }
+
+    SECTION("Revalidation")
+    {
+        fs_fixture fs;
+        dir_cache::clear();
+
+        REQUIRE(glob("new*", true).empty());
+
+        if (FILE* f = fopen("new_file", "wt"))
+            fclose(f);
+
+        std::set<std::string> names = glob("new*", true);
+        REQUIRE(names.size() == 1);
+        REQUIRE(*names.begin() == "new_file");
+    }
+}
@@ -0,0 +1,52 @@
+// Copyright (c) 2021 Christopher Antos
+// License: http://opensource.org/licenses/MIT
+
+#include "pch.h"
+#include "fs_fixture.h"
+
+#include <core/exec_index.h>
+#include <core/path.h>
+#include <core/str.h>
+
+//------------------------------------------------------------------------------
+TEST_CASE("Executable index")
+{
+    static const char* exec_fs[] = {
+        "one/run.exe",
+        "one/Tool.cmd",
+        "one/readme.txt",
+        "one/dir.exe/x",
+        "two/tool.CMD",
+        "two/zap.bat",
+        "two/run.exex",
+        nullptr,
+    };
+
+    fs_fixture fs(exec_fs);
+    exec_index::clear();
+
+    str<> paths;
+    paths << fs.get_root() << "\\one;\"" << fs.get_root() << "\\two\";;" << fs.get_root() << "\\one";
+
+    std::shared_ptr<const exec_list> list = exec_index::get(paths.c_str(), ".EXE;.CMD;.BAT");
+    REQUIRE(list);
+    REQUIRE(list->size() == 3);
+
+    SECTION("Sorted and deduplicated")
+    {
+        REQUIRE(strcmp(list->get_name(0), "run.exe") == 0);
+        REQUIRE(strcmp(list->get_name(1), "Tool.cmd") == 0);
+        REQUIRE(strcmp(list->get_name(2), "zap.bat") == 0);
+
+        // The first directory wins.
+        REQUIRE(strcmp(path::get_name(list->get_dir(1)), "one") == 0);
+        REQUIRE(strcmp(path::get_name(list->get_dir(2)), "two") == 0);
+    }
+
+    SECTION("Different PATHEXT")
+    {
+        std::shared_ptr<const exec_list> txt = exec_index::get(paths.c_str(), ".txt");
+        REQUIRE(txt->size() == 1);
+        REQUIRE(strcmp(txt->get_name(0), "readme.txt") == 0);
+    }
+}
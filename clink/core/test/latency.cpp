@@ -0,0 +1,65 @@
+// Copyright (c) 2021 Christopher Antos
+// License: http://opensource.org/licenses/MIT
+
+#include "pch.h"
+
+#include <core/latency.h>
+
+//------------------------------------------------------------------------------
+TEST_CASE("Latency histograms")
+{
+    latency::reset();
+
+    SECTION("Buckets")
+    {
+        latency::record(latency_phase::classify, 0);
+        latency::record(latency_phase::classify, 49);
+        latency::record(latency_phase::classify, 50);
+        latency::record(latency_phase::classify, 99999);
+        latency::record(latency_phase::classify, 100000);
+        latency::record(latency_phase::classify, 5000000);
+
+        latency_histogram h;
+        REQUIRE(latency::get_histogram(latency_phase::classify, h));
+        REQUIRE(h.count == 6);
+        REQUIRE(h.total_us == 0 + 49 + 50 + 99999 + 100000 + 5000000);
+        REQUIRE(h.max_us == 5000000);
+        REQUIRE(h.buckets[0] == 2);
+        REQUIRE(h.buckets[1] == 1);
+        REQUIRE(h.buckets[latency_histogram::num_buckets - 2] == 1);
+        REQUIRE(h.buckets[latency_histogram::num_buckets - 1] == 2);
+
+        REQUIRE(latency::get_bucket_limit(0) == 50);
+        REQUIRE(latency::get_bucket_limit(latency_histogram::num_buckets - 1) == 0);
+
+        REQUIRE(latency::get_histogram(latency_phase::sort, h));
+        REQUIRE(h.count == 0);
+    }
+
+    SECTION("Disabled")
+    {
+        latency::enable(false);
+        {
+            latency_span span(latency_phase::input);
+        }
+
+        latency_histogram h;
+        REQUIRE(latency::get_histogram(latency_phase::input, h));
+        REQUIRE(h.count == 0);
+    }
+
+    SECTION("Enabled")
+    {
+        latency::enable(true);
+        {
+            latency_span span(latency_phase::input);
+        }
+        latency::enable(false);
+
+        latency_histogram h;
+        REQUIRE(latency::get_histogram(latency_phase::input, h));
+        REQUIRE(h.count == 1);
+    }
+
+    latency::reset();
+}
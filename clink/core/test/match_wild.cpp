@@ -85,4 +85,30 @@ TEST_CASE("path::match_wild()")
         REQUIRE(path::match_wild("*st*", "origin/master", path::star_matches_everything::yes));
         REQUIRE(!path::match_wild("*st*", "origin/master", path::star_matches_everything::at_end));
     }
+
+    SECTION("Many stars")
+    {
+        REQUIRE(path::match_wild("*a*b*c*d*e*f*g*h*i*j*k*l*", "aabbccddeeffgghhiijjkkll"));
+        REQUIRE(!path::match_wild("*a*b*c*d*e*f*g*h*i*j*k*l*", "aabbccddeeffgghhiijjkk"));
+        REQUIRE(path::match_wild("*?*?*?*?*?*?*?*?*?*?*?*x", "abcdefghijklx"));
+    }
+
+    SECTION("Separator runs")
+    {
+        REQUIRE(path::match_wild("a*//b", "abc/b"));
+        REQUIRE(path::match_wild("a*/b", "abc\\\\b"));
+        REQUIRE(!path::match_wild("a*/b", "abc/d/b"));
+    }
+
+    SECTION("Compiled")
+    {
+        str_compare_scope _(str_compare_scope::caseless, false);
+        const path::wild_pattern<char> pattern(str_iter("*FOO*bar"));
+
+        REQUIRE(pattern.match(str_iter("foobar")));
+        REQUIRE(pattern.match(str_iter("build.foo123BAR")));
+        REQUIRE(!pattern.match(str_iter("build.fo123bar")));
+        REQUIRE(!pattern.match(str_iter("abc/foo/bar"), path::at_end));
+        REQUIRE(pattern.match(str_iter("abc/foo/bar"), path::yes));
+    }
 }
@@ -113,9 +113,70 @@ TEST_CASE("String compare")
         REQUIRE(str_compare("\xc2\x80""abc", "\xc2\x80") == 2);
     }
 
+    SECTION("Long ASCII runs")
+    {
+        const char* lower = "abcdefghijklmnopqrstuvwxyz_0123456789_abcdefghijklmnopqrstuvwxyz";
+        const char* upper = "ABCDEFGHIJKLMNOPQRSTUVWXYZ-0123456789-ABCDEFGHIJKLMNOPQRSTUVWXYZ";
+
+        {
+            str_compare_scope _(str_compare_scope::exact, false);
+            REQUIRE(str_compare(lower, lower) == -1);
+            REQUIRE(str_compare(lower, upper) == 0);
+            REQUIRE(str_compare(lower, "abcdefghijklmnopqrstuvwxyz_0123456789_abcdefghijklmnopqrstuvwxyZ") == 63);
+        }
+
+        {
+            str_compare_scope _(str_compare_scope::caseless, false);
+            REQUIRE(str_compare(lower, upper) == 26);
+            REQUIRE(str_compare("abcdefghijklmnopqrstuvwxyz\\dir", "ABCDEFGHIJKLMNOPQRSTUVWXYZ/dir") == -1);
+        }
+
+        {
+            str_compare_scope _(str_compare_scope::relaxed, false);
+            REQUIRE(str_compare(lower, upper) == -1);
+            REQUIRE(str_compare("abcdefghijklmnop\xc3\x84""bcdefghijklmnop", "ABCDEFGHIJKLMNOP\xc3\xa4""BCDEFGHIJKLMNOP") == -1);
+            REQUIRE(str_compare("abcdefghijklmnopqrstuvwxyz", "abcdefghijklmnopqrstuvwxyz0") == 26);
+        }
+
+        {
+            str_compare_scope _(str_compare_scope::caseless, true);
+            REQUIRE(str_compare("abcdefghijklmnop\xc3\xa4""bcdefghijklmnop", "ABCDEFGHIJKLMNOPABCDEFGHIJKLMNOP") == -1);
+        }
+    }
+
     SECTION("UTF-16")
     {
         REQUIRE(str_compare(L"abc123", L"abc123") == -1);
         REQUIRE(str_compare(L"\xd800\xdc00" L"abc", L"\xd800\xdc00") == 2);
     }
+
+    SECTION("Longest common prefix")
+    {
+        const char* strs[] = { "abcdefghijklmnopqrstuvwxyz", "abcdefghijklmnopqrstUVWXYZ", "abcdefghijklmnopqrstuvw", "abcdefghiJ" };
+
+        {
+            str_compare_scope _(str_compare_scope::exact, false);
+            REQUIRE(str_compute_lcd(strs, 0) == 0);
+            REQUIRE(str_compute_lcd(strs, 1) == 26);
+            REQUIRE(str_compute_lcd(strs, 2) == 20);
+            REQUIRE(str_compute_lcd(strs, 3) == 20);
+            REQUIRE(str_compute_lcd(strs, 4) == 9);
+            REQUIRE(str_compute_lcd(strs, 3, 5) == 15);
+        }
+
+        {
+            str_compare_scope _(str_compare_scope::caseless, false);
+            REQUIRE(str_compute_lcd(strs, 2) == 26);
+            REQUIRE(str_compute_lcd(strs, 3) == 23);
+            REQUIRE(str_compute_lcd(strs, 4) == 10);
+        }
+
+        {
+            // Only the first and last are compared when sorted.
+            str_compare_scope _(str_compare_scope::exact, false);
+            const char* sorted[] = { "abc", "abd", "xyz", "abe" };
+            REQUIRE(str_compute_lcd(sorted, 4) == 0);
+            REQUIRE(str_compute_lcd(sorted, 4, 0, true) == 2);
+        }
+    }
 }
@@ -3,6 +3,8 @@
 
 #pragma once
 
+#include <core/str.h>
+
 class line_state;
 class match_builder;
 struct match_display_filter_entry;
@@ -18,6 +20,17 @@ struct word_break_info
     int             keep : 16;
 };
 
+//------------------------------------------------------------------------------
+// Readline state captured on the input thread, for generators that run on a
+// worker thread (see match_generator::can_generate_async).
+struct async_generate_state
+{
+    str_moveable    end_word;               // With any tilde expanded.
+    str_moveable    match_root;             // Directory to prefix matches with.
+    bool            just_tilde = false;     // End word is exactly "~".
+    int             completion_type = 0;    // rl_completion_type.
+};
+
 //------------------------------------------------------------------------------
 class match_generator
 {
@@ -26,6 +39,20 @@ public:
     virtual void    get_word_break_info(const line_state& line, word_break_info& info) const = 0;
     virtual bool    match_display_filter(const char* needle, char** matches, match_display_filter_entry*** filtered_matches, display_filter_flags flag, bool* old_filtering=nullptr) { return false; }
 
+    // Returns true if generate_async() may run on a worker thread (see
+    // match.async).  capture_async_state() runs first on the input thread and
+    // is the only place such generators may touch Readline state.
+    // generate_async() must not touch Lua or Readline state, may only add
+    // matches, and should stop early when builder.is_cancelled().
+    virtual bool    can_generate_async() const { return false; }
+    virtual void    capture_async_state(const line_state& line, async_generate_state& state) const {}
+    virtual bool    generate_async(const line_state& line, match_builder& builder, const async_generate_state& state) { return false; }
+
+    // Returns false if generate() shouldn't run speculatively for the line
+    // while the input is idle (see match.preload), e.g. because it's expensive
+    // or has side effects.
+    virtual bool    can_preload(const line_state& line) { return true; }
+
 private:
 };
 
@@ -3,6 +3,7 @@
 
 #pragma once
 
+#include <core/match_wild.h>
 #include <core/str_iter.h>
 #include <assert.h>
 
@@ -102,7 +103,7 @@ private:
     bool                    has_match() const { return m_index < m_next; }
     const matches&          m_matches;
     char*                   m_expanded_pattern;
-    str_iter                m_pattern;
+    path::wild_pattern<char> m_pattern;
     bool                    m_has_pattern = false;
     unsigned int            m_index = 0;
     unsigned int            m_next = 0;
@@ -145,8 +146,14 @@ public:
     virtual int             get_word_break_position() const = 0;
     virtual bool            match_display_filter(const char* needle, char** matches, match_display_filter_entry*** filtered_matches, display_filter_flags flags, bool* old_filtering=nullptr) const = 0;
 
+    // Large lists may be put in order lazily, as each index is accessed.  A
+    // pass that visits every match but doesn't depend on their order can set
+    // this so it sees the matches as they are, instead of ordering them all.
+    virtual void            set_any_order(bool any_order) const {}
+
 private:
     friend class matches_iter;
+    virtual void            ensure_ordered() const {}
     virtual const char*     get_unfiltered_match(unsigned int index) const { return nullptr; }
     virtual match_type      get_unfiltered_match_type(unsigned int index) const { return match_type::none; }
     virtual const char*     get_unfiltered_match_display(unsigned int index) const { return nullptr; }
@@ -178,12 +185,14 @@ public:
                             match_builder(matches& matches);
     bool                    add_match(const char* match, match_type type, bool already_normalised=false);
     bool                    add_match(const match_desc& desc, bool already_normalised=false);
+    unsigned int            add_matches(const match_desc* descs, unsigned int count, bool already_normalised=false);
     void                    set_append_character(char append);
     void                    set_suppress_append(bool suppress=true);
     void                    set_suppress_quoting(int suppress=1); //0=no, 1=yes, 2=suppress end quote
 
     void                    set_deprecated_mode();
     void                    set_matches_are_files(bool files=true);
+    bool                    is_cancelled() const;
 
 private:
     matches&                m_matches;
@@ -36,6 +36,17 @@ struct word_class_info
     bool            argmatcher;
 };
 
+//------------------------------------------------------------------------------
+// Results for one command, saved so the command can skip being classified
+// again while it's unchanged.
+struct command_classification
+{
+    unsigned int    start;
+    unsigned int    end;
+    std::vector<word_class_info> info;
+    std::vector<char> faces;
+};
+
 //------------------------------------------------------------------------------
 class word_classifications : public no_copy
 {
@@ -50,8 +61,12 @@ public:
     void            init(size_t line_length, const word_classifications* face_defs);
     unsigned int    add_command(const line_state& line);
     void            set_word_has_argmatcher(unsigned int index);
+    void            set_command_extent(unsigned int index, unsigned int start, unsigned int end);
     void            finish(bool show_argmatchers);
 
+    bool            save_command(unsigned int index, unsigned int start, unsigned int end, command_classification& saved) const;
+    void            restore_command(unsigned int index, const command_classification& saved);
+
     unsigned int    size() const { return static_cast<unsigned int>(m_info.size()); }
     const word_class_info* operator[](unsigned int index) const { return &m_info[index]; }
     bool            equals(const word_classifications& other) const;
@@ -66,7 +81,19 @@ public:
     bool            is_word_classified(unsigned int index);
 
 private:
+    struct command_info
+    {
+        unsigned int index;                 // Index of the command's first word.
+        unsigned int num_words;
+        unsigned int extent_start;          // Range of the text it applied
+        unsigned int extent_end;            // faces to (empty if start > end).
+    };
+
+    command_info*   find_command(unsigned int index);
+    const command_info* find_command(unsigned int index) const;
+
     std::vector<word_class_info> m_info;
+    std::vector<command_info> m_commands;
     std::vector<str_moveable> m_face_definitions;
     char*           m_faces = nullptr;
     unsigned int    m_length = 0;
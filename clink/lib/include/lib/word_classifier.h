@@ -12,5 +12,15 @@ class word_classifications;
 class word_classifier
 {
 public:
-    virtual void    classify(const std::vector<line_state>& commands, word_classifications& classifications) = 0;
+    // commands may be only some of the commands in the line; word_indices
+    // gives the index in classifications of each command's first word.
+    virtual void    classify(const std::vector<line_state>& commands, const std::vector<unsigned int>& word_indices, word_classifications& classifications) = 0;
+
+    // Changes whenever something that affects how words are classified has
+    // changed, such as argmatchers or classifiers being added or modified.
+    virtual unsigned int get_generation() = 0;
+
+    // Whether classify() may be given only the commands that changed.  When
+    // false, it's always given every command in the line.
+    virtual bool    can_skip_unchanged() = 0;
 };
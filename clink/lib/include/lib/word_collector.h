@@ -5,6 +5,7 @@
 
 #include "line_state.h"
 
+#include <core/str.h>
 #include <core/str_iter.h>
 #include <core/str_tokeniser.h>
 
@@ -34,6 +35,7 @@ public:
     virtual void start(const str_iter& iter, const char* quote_pair) = 0;
     virtual word_token next(unsigned int& offset, unsigned int& length) = 0;
     virtual bool has_deprecated_argmatcher(const char* command) { return false; }
+    virtual unsigned int get_argmatcher_generation() { return 0; }
 };
 
 //------------------------------------------------------------------------------
@@ -43,6 +45,9 @@ class word_collector
     {
         unsigned int        offset;
         unsigned int        length;
+        bool                is_break = false;   // Ended at a separator, with more text after it.
+        bool                has_words = false;
+        std::vector<word>   words;
     };
 
 public:
@@ -52,18 +57,26 @@ public:
                                std::vector<word>& words, collect_words_mode mode) const;
     unsigned int collect_words(const line_buffer& buffer,
                                std::vector<word>& words, collect_words_mode mode) const;
+    void clear_cache();
 
 private:
     char get_opening_quote() const;
     char get_closing_quote() const;
-    void find_command_bounds(const char* buffer, unsigned int length, unsigned int cursor,
-                             std::vector<command>& commands, bool stop_at_cursor) const;
+    void update_commands(const char* buffer, unsigned int line_stop) const;
+    void collect_command_words(const char* line_buffer, command& command) const;
 
 private:
     collector_tokeniser* const m_command_tokeniser;
     collector_tokeniser* m_word_tokeniser;
     const char* const m_quote_pair;
     bool m_delete_word_tokeniser = false;
+
+    // Commands (and their words) from the previous call, and the text they
+    // were found in.  Commands that ended before the first changed char are
+    // reused instead of tokenising the whole line again.
+    mutable std::vector<command> m_commands;
+    mutable str_moveable m_commands_text;
+    mutable unsigned int m_commands_generation = 0;
 };
 
 //------------------------------------------------------------------------------
@@ -174,6 +174,13 @@ bool cmd_command_tokeniser::has_deprecated_argmatcher(const char* command)
     return host_has_deprecated_argmatcher(command);
 }
 
+//------------------------------------------------------------------------------
+unsigned int cmd_command_tokeniser::get_argmatcher_generation()
+{
+    extern unsigned int host_get_argmatcher_generation();
+    return host_get_argmatcher_generation();
+}
+
 
 
 //------------------------------------------------------------------------------
@@ -26,43 +26,52 @@ setting_bool g_glob_system(
     "file lists.",
     false);
 
+setting_bool g_glob_cache(
+    "files.cache",
+    "Cache directory listings",
+    "Caches directory listings used when generating file lists.  Cached listings\n"
+    "are revalidated by the directory's last write time, and match only long\n"
+    "file names (not 8.3 short names).",
+    true);
+
 
 
 //------------------------------------------------------------------------------
 static class : public match_generator
 {
     virtual bool generate(const line_state& line, match_builder& builder, bool /*old_filtering*/) override
+    {
+        async_generate_state state;
+        capture_async_state(line, state);
+        return generate_async(line, builder, state);
+    }
+
+    virtual bool can_generate_async() const override
+    {
+        return true;
+    }
+
+    virtual void capture_async_state(const line_state& line, async_generate_state& state) const override
     {
         str<288> root;
         line.get_end_word(root);
 
-        bool expanded_tilde;
+        state.just_tilde = (strcmp(root.c_str(), "~") == 0);
+        char* expanded_root = tilde_expand(root.c_str());
+        const bool expanded_tilde = (expanded_root && strcmp(expanded_root, root.c_str()) != 0);
+        if (expanded_tilde)
         {
-            bool just_tilde = (strcmp(root.c_str(), "~") == 0);
-            char* expanded_root = tilde_expand(root.c_str());
-            expanded_tilde = (expanded_root && strcmp(expanded_root, root.c_str()) != 0);
-            if (expanded_tilde)
-            {
-                root = expanded_root;
-                if (just_tilde)
-                    path::append(root, "");
-            }
-            free(expanded_root);
-
-            if (just_tilde && rl_completion_type == '?')
-                return true;
+            root = expanded_root;
+            if (state.just_tilde)
+                path::append(root, "");
         }
+        free(expanded_root);
 
         path::normalise_separators(root);
+        state.end_word = root.c_str();
 
         root << "*";
-
-        globber globber(root.c_str());
-        globber.hidden(g_glob_hidden.get());
-        globber.system(g_glob_system.get());
-
         path::get_directory(root);
-        unsigned int root_len = root.length();
 
         if (expanded_tilde)
         {
@@ -72,13 +81,35 @@ static class : public match_generator
                 root = collapsed.c_str();
         }
 
+        state.match_root = root.c_str();
+        state.completion_type = rl_completion_type;
+    }
+
+    virtual bool generate_async(const line_state& line, match_builder& builder, const async_generate_state& state) override
+    {
+        if (state.just_tilde && state.completion_type == '?')
+            return true;
+
+        str<288> root(state.end_word.c_str());
+        root << "*";
+
+        globber globber(root.c_str());
+        globber.hidden(g_glob_hidden.get());
+        globber.system(g_glob_system.get());
+        globber.cached(g_glob_cache.get());
+
+        root = state.match_root.c_str();
+        unsigned int root_len = root.length();
+
         str<288> buffer;
         globber::extrainfo info;
         while (globber.next(buffer, false, &info))
         {
             root.truncate(root_len);
             path::append(root, buffer.c_str());
-            builder.add_match(root.c_str(), to_match_type(info.st_mode, info.attr, root.c_str()), true/*already_normalised*/);
+            if (!builder.add_match(root.c_str(), to_match_type(info.st_mode, info.attr, root.c_str()), true/*already_normalised*/) &&
+                builder.is_cancelled())
+                break;
         }
 
         return true;
@@ -11,6 +11,7 @@
 #include "host_callbacks.h"
 
 #include <core/base.h>
+#include <core/latency.h>
 #include <core/os.h>
 #include <core/path.h>
 #include <core/str_iter.h>
@@ -27,6 +28,40 @@ extern "C" {
 }
 
 //------------------------------------------------------------------------------
+static setting_bool g_match_async(
+    "match.async",
+    "Generate file matches asynchronously",
+    "When enabled, match generators that support it (such as the built-in file\n"
+    "match generator) run on a background thread.  Completion waits for them to\n"
+    "finish unless a key is pressed, in which case partial results are used and\n"
+    "the rest are added as they arrive.  Typing a different word cancels them.",
+    false);
+
+static setting_bool g_match_preload(
+    "match.preload",
+    "Generate matches while idle",
+    "When enabled, matches for the word at the cursor are generated once the input\n"
+    "has been idle for match.preload_delay milliseconds, so that completion finds\n"
+    "them ready.  Typing a different word discards them.  Match generators that\n"
+    "are expensive or have side effects can opt out.",
+    false);
+
+static setting_int g_match_preload_delay(
+    "match.preload_delay",
+    "Idle time before generating matches",
+    "The number of milliseconds the input must be idle before match.preload\n"
+    "generates matches.",
+    250);
+
+static setting_bool g_latency(
+    "clink.latency",
+    "Record input latency histograms",
+    "When enabled, the time taken by each phase of handling input (e.g. key\n"
+    "dispatch, match generation, classifying words, prompt filtering, and\n"
+    "redisplay) is recorded into histograms.  They can be shown by the\n"
+    "clink-diagnostics command or retrieved via clink.getlatency().",
+    false);
+
 extern setting_bool g_classify_words;
 
 extern bool is_showing_argmatchers();
@@ -99,6 +134,16 @@ bool is_regen_blocked()
     return (s_editor && s_editor->m_matches.is_regen_blocked());
 }
 
+//------------------------------------------------------------------------------
+bool get_match_store_stats(match_store_stats& stats, bool regen)
+{
+    if (!s_editor)
+        return false;
+
+    (regen ? s_editor->m_regen_matches : s_editor->m_matches).get_store_stats(stats);
+    return true;
+}
+
 //------------------------------------------------------------------------------
 void force_update_internal(bool restrict)
 {
@@ -297,6 +342,8 @@ void line_editor_impl::begin_line()
     clear_flag(~flag_init);
     set_flag(flag_editing);
 
+    latency::enable(g_latency.get());
+
     m_bind_resolver.reset();
     m_command_offset = 0;
     m_keys_size = 0;
@@ -314,8 +361,10 @@ void line_editor_impl::begin_line()
     m_desc.input->begin();
     m_desc.output->begin();
     m_buffer.begin_line();
+    m_collector.clear_cache();
     m_prev_generate.clear();
     m_prev_classify.clear();
+    m_classify_cache.clear();
 
     rl_before_display_function = before_display;
 
@@ -332,6 +381,8 @@ void line_editor_impl::end_line()
 
     rl_before_display_function = nullptr;
 
+    cancel_match_job();
+
     m_buffer.end_line();
     m_desc.output->end();
     m_desc.input->end();
@@ -407,12 +458,28 @@ bool line_editor_impl::edit(str_base& out)
             callback = nullptr;
 
         if (!m_module.is_input_pending())
-            m_desc.input->select(callback);
+            select_input(callback);
     }
 
     return get_line(out);
 }
 
+//------------------------------------------------------------------------------
+void line_editor_impl::select_input(input_idle* callback)
+{
+    // Also wake up to preload matches once the input has been idle for a
+    // while.
+    if (can_preload())
+    {
+        m_preload_idle.arm(callback, g_match_preload_delay.get());
+        m_desc.input->select(&m_preload_idle);
+    }
+    else
+    {
+        m_desc.input->select(callback);
+    }
+}
+
 //------------------------------------------------------------------------------
 bool line_editor_impl::update()
 {
@@ -432,18 +499,37 @@ bool line_editor_impl::update()
         return true;
     }
 
-    update_input();
+    // Process all input that's already waiting before updating, so that a
+    // burst of input (e.g. pasting) is classified, drawn, and updated once
+    // instead of once per key.
+    bool complete;
+    {
+        rollback<bool> _(m_batching, true);
+        m_batch_stale = false;
+        do
+        {
+            complete = update_input();
+            if (!check_flag(flag_editing))
+                return false;
+        }
+        while (!m_module.is_input_pending() &&
+               m_desc.input->peek() != terminal_in::input_none);
+    }
 
-    if (!check_flag(flag_editing))
-        return false;
+    if (g_classify_words.get())
+        classify();
+    m_buffer.draw();
 
-    update_internal();
+    // Nothing has changed while a chord is still in progress.
+    if (complete)
+        update_internal();
     return true;
 }
 
 //------------------------------------------------------------------------------
 void line_editor_impl::reset_generate_matches()
 {
+    cancel_match_job();
     set_flag(flag_generate);
     set_flag(flag_select);
     m_prev_key.reset();
@@ -474,14 +560,30 @@ void line_editor_impl::update_matches()
 
     if (generate)
     {
+        latency_span span(latency_phase::generate);
+
+        cancel_match_job();
+
         line_state line = get_linestate();
         match_pipeline pipeline(m_matches);
         pipeline.reset();
-        pipeline.generate(line, m_generators);
+        unsigned int next = pipeline.generate(line, m_generators, false, g_match_async.get());
+        if (next < m_generators.size())
+        {
+            m_match_job = std::make_shared<match_job>(line, m_generators, next);
+            m_match_job->start();
+            finish_match_job(true/*wait*/);
+        }
     }
+    else if (m_match_job && finish_match_job(m_wait_match_job))
+    {
+        select = true;
+    }
+    m_wait_match_job = false;
 
     if (restrict)
     {
+        latency_span span(latency_phase::restrict);
         match_pipeline pipeline(m_matches);
 
         // Strip quotes so `"foo\"ba` can complete to `"foo\bar"`.  Stripping
@@ -510,8 +612,14 @@ void line_editor_impl::update_matches()
     if (select)
     {
         match_pipeline pipeline(m_matches);
-        pipeline.select(m_needle.c_str());
-        pipeline.sort();
+        {
+            latency_span span(latency_phase::select);
+            pipeline.select(m_needle.c_str());
+        }
+        {
+            latency_span span(latency_phase::sort);
+            pipeline.sort();
+        }
     }
 
     // Tell all the modules that the matches changed.
@@ -524,12 +632,92 @@ void line_editor_impl::update_matches()
     }
 }
 
+//------------------------------------------------------------------------------
+bool line_editor_impl::can_preload()
+{
+    // Only while no other mode (e.g. the pager, clink-select-complete, or a
+    // Readline search) has taken over the input.
+    return (g_match_preload.get() &&
+            check_flag(flag_editing) &&
+            check_flag(flag_generate) &&
+            m_bind_resolver.get_group() == m_binder.get_group());
+}
+
+//------------------------------------------------------------------------------
+// Runs the generate step of update_matches() ahead of time while the input is
+// idle, so that completion finds the matches ready.  If the end word changes
+// before then, update_internal() discards them as usual.
+void line_editor_impl::preload_matches()
+{
+    if (!can_preload())
+        return;
+
+    line_state line = get_linestate();
+    for (auto* generator : m_generators)
+    {
+        if (!generator->can_preload(line))
+            return;
+    }
+
+    clear_flag(flag_generate);
+    set_flag(flag_select);
+
+    cancel_match_job();
+
+    match_pipeline pipeline(m_matches);
+    pipeline.reset();
+    unsigned int next = pipeline.generate(line, m_generators, false, g_match_async.get());
+    if (next < m_generators.size())
+    {
+        // Let it run in the background; update_matches() waits for it.
+        m_match_job = std::make_shared<match_job>(line, m_generators, next);
+        m_match_job->start();
+        m_wait_match_job = true;
+    }
+}
+
+//------------------------------------------------------------------------------
+void line_editor_impl::cancel_match_job()
+{
+    if (m_match_job)
+    {
+        m_match_job->cancel();
+        m_match_job.reset();
+    }
+    m_wait_match_job = false;
+}
+
+//------------------------------------------------------------------------------
+// Moves matches published so far by the match job into m_matches.  Returns
+// true if any matches were added.  When wait is true, waits for the job to
+// finish unless key input arrives first.
+bool line_editor_impl::finish_match_job(bool wait)
+{
+    if (!m_match_job)
+        return false;
+
+    const bool done = (wait ? m_match_job->wait_unless_input(*m_desc.input, INFINITE) : m_match_job->is_done());
+
+    m_matches.reopen();
+    const bool added = (m_match_job->drain(m_matches) > 0);
+
+    if (done)
+    {
+        m_match_job.reset();
+        m_matches.done_building();
+    }
+
+    return added || done;
+}
+
 //------------------------------------------------------------------------------
 void line_editor_impl::dispatch(int bind_group)
 {
     assert(check_flag(flag_init));
     assert(check_flag(flag_editing));
 
+    latency_span span(latency_phase::dispatch);
+
     // Claim any pending binding, otherwise we'll try to dispatch it again.
 
     if (m_pending_binding)
@@ -542,6 +730,9 @@ void line_editor_impl::dispatch(int bind_group)
 
     m_dispatching++;
 
+    // A nested dispatch loop isn't part of the caller's input batch.
+    rollback<bool> _(m_batching, false);
+
     do
     {
         m_desc.input->select();
@@ -585,6 +776,8 @@ void line_editor_impl::set_keyseq_len(int len)
 // to help dispatch() be able to dispatch an entire chord.
 bool line_editor_impl::update_input()
 {
+    latency_span span(latency_phase::input);
+
     if (!m_module.is_input_pending())
     {
         int key = m_desc.input->read();
@@ -632,18 +825,65 @@ bool line_editor_impl::update_input()
         unsigned char   flags;  // = 0;   <! issues about C2905
     };
 
+    bool complete = true;
+    str<> text;
     while (auto binding = m_bind_resolver.next())
     {
-        // Binding found, dispatch it off to the module.
-        result_impl result;
-        result.flags = 0;
-        result.group = m_bind_resolver.get_group();
-
         str<16> chord;
         editor_module* module = binding.get_module();
         unsigned char id = binding.get_id();
         binding.get_chord(chord);
 
+        const bool self_insert = (module == &m_module &&
+                                  chord.length() == 1 &&
+                                  m_module.is_self_insert(chord.c_str()[0]));
+
+        // Text that's typed ahead (e.g. pasted) is collected and inserted all
+        // at once, rather than letting Readline insert and redisplay it one
+        // byte at a time.  A run can't start on a UTF8 continuation byte.
+        if (!m_dispatching &&
+            self_insert &&
+            (text.length() || (chord.c_str()[0] & 0xc0) != 0x80))
+        {
+            const int next = m_desc.input->peek();
+            if (text.length() || (next >= 0x20 && next != 0x7f))
+            {
+                binding.claim();
+                text.concat(chord.c_str(), 1);
+                if (next >= 0x20 && next != 0x7f)
+                {
+                    const int key = m_desc.input->read();
+                    if (key >= 0)
+                        complete = m_bind_resolver.step(key);
+                }
+                continue;
+            }
+        }
+
+        if (text.length())
+        {
+            m_module.insert_text(text.c_str(), text.length());
+            m_buffer.set_need_draw();
+            text.clear();
+            m_batch_stale = true;
+        }
+
+        // Other bindings (e.g. completion) can use the words and matches that
+        // update_internal() derives from the line, so bring them up to date
+        // before dispatching one in the middle of a batch.
+        if (m_batching && m_batch_stale && !m_dispatching && !self_insert)
+        {
+            if (g_classify_words.get())
+                classify();
+            update_internal();
+            m_batch_stale = false;
+        }
+
+        // Binding found, dispatch it off to the module.
+        result_impl result;
+        result.flags = 0;
+        result.group = m_bind_resolver.get_group();
+
         {
             rollback<bind_resolver::binding*> _(m_pending_binding, &binding);
 
@@ -670,8 +910,13 @@ bool line_editor_impl::update_input()
         }
         else
         {
-            // Classify words in the input line (if configured).
-            if (g_classify_words.get())
+            if (m_batching)
+                m_batch_stale = true;
+
+            // Classify words in the input line (if configured).  When batching
+            // input, update() classifies once at the end of the batch.
+            if (g_classify_words.get() &&
+                (!m_batching || (result.flags & result_impl::flag_done)))
                 classify();
 
             if (result.flags & result_impl::flag_done)
@@ -690,8 +935,16 @@ bool line_editor_impl::update_input()
             m_buffer.redraw();
     }
 
-    m_buffer.draw();
-    return true;
+    if (text.length())
+    {
+        m_module.insert_text(text.c_str(), text.length());
+        m_buffer.set_need_draw();
+        m_batch_stale = true;
+    }
+
+    if (!m_batching || m_dispatching)
+        m_buffer.draw();
+    return complete;
 }
 
 //------------------------------------------------------------------------------
@@ -825,13 +1078,34 @@ void line_editor_impl::classify()
     if (m_prev_classify.equals(m_buffer.get_buffer(), m_buffer.get_length()))
         return;
 
+    latency_span span(latency_phase::classify);
+
+    // Saved results for a command can be reused only while all the text up to
+    // the end of the command is unchanged, and argmatchers haven't changed.
+    unsigned int same = 0;
+    if (const char* prev = m_prev_classify.get())
+    {
+        const char* buffer = m_buffer.get_buffer();
+        const unsigned int max_same = min<unsigned int>(m_prev_classify.length(), m_buffer.get_length());
+        while (same < max_same && prev[same] == buffer[same])
+            same++;
+    }
+
+    const unsigned int generation = m_classifier->get_generation();
+    if (m_classify_generation != generation)
+    {
+        m_classify_cache.clear();
+        m_classify_generation = generation;
+    }
+
     // Use the full line; don't stop at the cursor.
     collect_words(true/*for_classify*/);
     line_state line = get_linestate(true/*for_classify*/);
+    const unsigned int line_length = static_cast<unsigned int>(strlen(line.get_line()));
 
     // Hang on to the old classifications so it's possible to detect changes.
     word_classifications old_classifications(std::move(m_classifications));
-    m_classifications.init(strlen(line.get_line()), &old_classifications);
+    m_classifications.init(line_length, &old_classifications);
 
     // Count number of commands so we can pre-allocate words_storage so that
     // emplace_back() doesn't invalidate pointers (references) stored in
@@ -882,7 +1156,57 @@ void line_editor_impl::classify()
         i++;
     }
 
-    m_classifier->classify(linestates, m_classifications);
+    // Each command owns the text from its start up to the start of the next
+    // command (the first command also owns any leading text).
+    std::vector<unsigned int> word_indices;
+    std::vector<unsigned int> bounds;
+    word_indices.reserve(linestates.size());
+    bounds.reserve(linestates.size() + 1);
+    for (const auto& linestate : linestates)
+    {
+        word_indices.push_back(m_classifications.add_command(linestate));
+        bounds.push_back(bounds.empty() ? 0 : linestate.get_command_offset());
+    }
+    bounds.push_back(line_length);
+
+    // Reuse saved results for leading commands that haven't changed.  That's
+    // only allowed if the classifier accepts being given just the commands
+    // that changed.
+    const bool skip_unchanged = m_classifier->can_skip_unchanged();
+    if (!skip_unchanged)
+        m_classify_cache.clear();
+
+    size_t reuse = 0;
+    while (reuse < linestates.size() && reuse < m_classify_cache.size())
+    {
+        const command_classification& saved = m_classify_cache[reuse];
+        if (saved.start != bounds[reuse] ||
+            saved.end != bounds[reuse + 1] ||
+            saved.end > same ||
+            saved.info.size() != linestates[reuse].get_word_count())
+            break;
+
+        m_classifications.restore_command(word_indices[reuse], saved);
+        reuse++;
+    }
+    m_classify_cache.resize(reuse);
+
+    // Only the remaining commands need to be classified.
+    if (reuse < linestates.size())
+    {
+        std::vector<line_state> changed(linestates.begin() + reuse, linestates.end());
+        std::vector<unsigned int> changed_indices(word_indices.begin() + reuse, word_indices.end());
+        m_classifier->classify(changed, changed_indices, m_classifications);
+
+        for (size_t ii = reuse; skip_unchanged && ii < linestates.size(); ++ii)
+        {
+            command_classification saved;
+            if (!m_classifications.save_command(word_indices[ii], bounds[ii], bounds[ii + 1], saved))
+                break;
+            m_classify_cache.emplace_back(std::move(saved));
+        }
+    }
+
     m_classifications.finish(is_showing_argmatchers());
 
 #ifdef DEBUG
@@ -1015,6 +1339,8 @@ matches* line_editor_impl::get_mutable_matches(bool nosort)
     m_prev_key = next_key;
     m_prev_generate.set(m_buffer.get_buffer(), end_word.offset + end_word.length);
 
+    cancel_match_job();
+
     match_pipeline pipeline(m_matches);
     pipeline.reset();
     pipeline.set_nosort(nosort);
@@ -1039,6 +1365,8 @@ matches* get_mutable_matches(bool nosort=false)
 //------------------------------------------------------------------------------
 void line_editor_impl::update_internal()
 {
+    latency_span span(latency_phase::update);
+
     // This is responsible for updating the matches for the word under the
     // cursor.  It tries to call match generators only once for the current
     // word, and then repeatedly filter the results as the word is edited.
@@ -1073,6 +1401,7 @@ void line_editor_impl::update_internal()
             // otherwise it will constantly generate in response to every input.
             if (!m_selectcomplete.is_active())
             {
+                cancel_match_job();
                 match_pipeline pipeline(m_matches);
                 pipeline.reset();
                 // Defer generating until update_matches().  Must set word break
@@ -1118,6 +1447,57 @@ void line_editor_impl::update_internal()
 
     if (is_endword_tilde(get_linestate()))
         reset_generate_matches();
+
+    // Pick up matches published by an in-flight match job since the last
+    // update, so the completion UI sees them.
+    if (m_match_job && !check_flag(flag_generate) && finish_match_job(false/*wait*/))
+        set_flag(flag_select);
+}
+
+//------------------------------------------------------------------------------
+void line_editor_impl::preload_idle::arm(input_idle* inner, int delay)
+{
+    m_inner = inner;
+    m_due = GetTickCount() + max<int>(delay, 0);
+    m_pending = true;
+}
+
+//------------------------------------------------------------------------------
+bool line_editor_impl::preload_idle::is_enabled()
+{
+    m_inner_enabled = (m_inner && m_inner->is_enabled());
+    return m_pending || m_inner_enabled;
+}
+
+//------------------------------------------------------------------------------
+unsigned line_editor_impl::preload_idle::get_timeout()
+{
+    unsigned timeout = m_inner_enabled ? m_inner->get_timeout() : INFINITE;
+    if (m_pending)
+    {
+        const int remaining = int(m_due - GetTickCount());
+        timeout = min<unsigned>(timeout, remaining > 0 ? remaining : 0);
+    }
+    return timeout;
+}
+
+//------------------------------------------------------------------------------
+void* line_editor_impl::preload_idle::get_waitevent()
+{
+    return m_inner_enabled ? m_inner->get_waitevent() : nullptr;
+}
+
+//------------------------------------------------------------------------------
+void line_editor_impl::preload_idle::on_idle()
+{
+    if (m_pending && int(GetTickCount() - m_due) >= 0)
+    {
+        m_pending = false;
+        m_editor.preload_matches();
+    }
+
+    if (m_inner_enabled)
+        m_inner->on_idle();
 }
 
 //------------------------------------------------------------------------------
@@ -15,6 +15,7 @@
 #include "line_editor.h"
 #include "line_state.h"
 #include "matches_impl.h"
+#include "match_job.h"
 #include "word_classifier.h"
 #include "word_classifications.h"
 #include "word_collector.h"
@@ -69,6 +70,7 @@ public:
     virtual bool        translate(const char* seq, int len, str_base& out) override;
     virtual void        set_keyseq_len(int len) override;
 
+    void                select_input(input_idle* callback);
     void                reset_generate_matches();
     void                force_update_internal(bool restrict=false);
     bool                call_lua_rl_global_function(const char* func_name);
@@ -82,6 +84,7 @@ private:
     friend matches* get_mutable_matches(bool nosort);
     friend matches* maybe_regenerate_matches(const char* needle, display_filter_flags flags);
     friend bool is_regen_blocked();
+    friend bool get_match_store_stats(match_store_stats& stats, bool regen);
 
     enum flags : unsigned char
     {
@@ -94,6 +97,28 @@ private:
         flag_eof        = 1 << 6,
     };
 
+    // Wraps the host's input_idle so that select() also wakes up to preload
+    // matches once the input has been idle long enough.
+    class preload_idle
+        : public input_idle
+    {
+    public:
+                        preload_idle(line_editor_impl& editor) : m_editor(editor) {}
+        void            arm(input_idle* inner, int delay);
+        virtual void    reset() override {}
+        virtual bool    is_enabled() override;
+        virtual unsigned get_timeout() override;
+        virtual void*   get_waitevent() override;
+        virtual void    on_idle() override;
+
+    private:
+        line_editor_impl& m_editor;
+        input_idle*     m_inner = nullptr;
+        unsigned int    m_due = 0;
+        bool            m_pending = false;
+        bool            m_inner_enabled = false;
+    };
+
     struct key_t
     {
         void            reset() { memset(this, 0xff, sizeof(*this)); }
@@ -112,6 +137,10 @@ private:
     matches*            get_mutable_matches(bool nosort=false);
     void                update_internal();
     bool                update_input();
+    bool                can_preload();
+    void                preload_matches();
+    void                cancel_match_job();
+    bool                finish_match_job(bool wait);
     module::context     get_context() const;
     line_state          get_linestate(bool for_classify=false) const;
     void                set_flag(unsigned char flag);
@@ -146,17 +175,24 @@ private:
     str<64>             m_needle;
 
     prev_buffer         m_prev_generate;
+    std::shared_ptr<match_job> m_match_job;
+    bool                m_wait_match_job = false;
+    preload_idle        m_preload_idle = { *this };
     words               m_words;
     unsigned short      m_command_offset = 0;
 
     prev_buffer         m_prev_classify;
     words               m_classify_words;
     unsigned short      m_classify_command_offset = 0;
+    std::vector<command_classification> m_classify_cache;
+    unsigned int        m_classify_generation = 0;
 
     const char*         m_insert_on_begin = nullptr;
 
     // State for dispatch().
     unsigned char       m_dispatching = 0;
+    bool                m_batching = false;
+    bool                m_batch_stale = false;  // Batched input since update_internal().
     bool                m_invalid_dispatch;
     bind_resolver::binding* m_pending_binding = nullptr;
 };
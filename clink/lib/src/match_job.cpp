@@ -0,0 +1,193 @@
+// Copyright (c) 2021 Christopher Antos
+// License: http://opensource.org/licenses/MIT
+
+#include "pch.h"
+#include "match_job.h"
+#include "match_generator.h"
+
+#include <core/array.h>
+#include <core/base.h>
+#include <terminal/terminal_in.h>
+
+#include <assert.h>
+#include <process.h>
+
+//------------------------------------------------------------------------------
+match_job::match_job(const line_state& line, const array<match_generator*>& generators, unsigned int first)
+: m_line(line.get_line())
+, m_words(line.get_words())
+, m_cursor(line.get_cursor())
+, m_command_offset(line.get_command_offset())
+{
+    unsigned int index = 0;
+    for (auto* generator : generators)
+    {
+        if (index++ >= first)
+            m_generators.push_back(generator);
+    }
+
+    m_states.resize(m_generators.size());
+    for (size_t i = 0; i < m_generators.size(); ++i)
+        m_generators[i]->capture_async_state(line, m_states[i]);
+
+    InitializeCriticalSection(&m_lock);
+
+    m_back.m_publish_lock = &m_lock;
+    m_back.m_cancel = &m_cancelled;
+}
+
+//------------------------------------------------------------------------------
+match_job::~match_job()
+{
+    if (m_thread_handle)
+    {
+        cancel();
+        CloseHandle(m_thread_handle);
+    }
+    if (m_done_event)
+        CloseHandle(m_done_event);
+
+    DeleteCriticalSection(&m_lock);
+}
+
+//------------------------------------------------------------------------------
+void match_job::start()
+{
+    assert(!m_thread_handle);
+    assert(!m_done_event);
+
+    m_done_event = CreateEvent(nullptr, true, false, nullptr);
+    if (m_done_event)
+    {
+        m_thread_handle = reinterpret_cast<HANDLE>(_beginthreadex(nullptr, 0, &threadproc, this, CREATE_SUSPENDED, nullptr));
+        if (m_thread_handle)
+        {
+            m_holder = shared_from_this(); // Now threadproc holds a strong ref.
+            ResumeThread(m_thread_handle);
+            return;
+        }
+    }
+
+    // Fall back to generating synchronously.
+    run();
+    if (m_done_event)
+        SetEvent(m_done_event);
+}
+
+//------------------------------------------------------------------------------
+void match_job::cancel()
+{
+    InterlockedExchange(&m_cancelled, true);
+}
+
+//------------------------------------------------------------------------------
+bool match_job::is_done() const
+{
+    return !m_done_event || WaitForSingleObject(m_done_event, 0) == WAIT_OBJECT_0;
+}
+
+//------------------------------------------------------------------------------
+// Returns true if the job finished, or false if key input arrived (or the
+// timeout elapsed) first.
+bool match_job::wait_unless_input(terminal_in& in, unsigned int timeout) const
+{
+    if (!m_done_event)
+        return true;
+
+    // The input handle is also signaled by mouse/focus/etc events, which must
+    // not end the wait.  peek() consumes those without blocking, so the handle
+    // is only signaled again when more input arrives.
+    HANDLE handles[2] = { m_done_event, in.get_waitevent() };
+    const DWORD count = handles[1] ? 2 : 1;
+
+    const DWORD start = GetTickCount();
+    while (true)
+    {
+        if (is_done())
+            return true;
+        if (in.peek() != terminal_in::input_none)
+            return false;
+
+        DWORD wait = INFINITE;
+        if (timeout != INFINITE)
+        {
+            const DWORD elapsed = GetTickCount() - start;
+            if (elapsed >= timeout)
+                return false;
+            wait = timeout - elapsed;
+        }
+
+        const DWORD result = WaitForMultipleObjects(count, handles, false, wait);
+        if (result == WAIT_OBJECT_0)
+            return true;
+        if (result != WAIT_OBJECT_0 + 1)
+            return false;
+    }
+}
+
+//------------------------------------------------------------------------------
+unsigned int match_job::drain(matches_impl& front)
+{
+    EnterCriticalSection(&m_lock);
+
+    const unsigned int count = m_back.get_info_count();
+    const match_info* infos = m_back.get_infos();
+
+    unsigned int added = 0;
+    for (unsigned int i = m_drained; i < count; ++i)
+    {
+        const match_info& info = infos[i];
+        match_desc desc = { info.match, info.display, info.description, info.type, info.append_display };
+        if (front.add_match(desc, true/*already_normalized*/))
+            ++added;
+    }
+    m_drained = count;
+
+    // Generators can also set flags on the builder.
+    if (m_back.m_append_character)
+        front.set_append_character(m_back.m_append_character);
+    if (m_back.m_suppress_append)
+        front.set_suppress_append(true);
+    if (m_back.m_suppress_quoting)
+        front.set_suppress_quoting(m_back.m_suppress_quoting);
+    if (!m_back.m_can_infer_type)
+        front.set_deprecated_mode();
+    if (m_back.m_filename_completion_desired.is_explicit())
+        front.m_filename_completion_desired.set_explicit(m_back.m_filename_completion_desired.get());
+    if (m_back.m_filename_display_desired.is_explicit())
+        front.m_filename_display_desired.set_explicit(m_back.m_filename_display_desired.get());
+
+    LeaveCriticalSection(&m_lock);
+    return added;
+}
+
+//------------------------------------------------------------------------------
+void match_job::run()
+{
+    line_state line(m_line.c_str(), m_cursor, m_command_offset, m_words);
+
+    match_builder builder(m_back);
+    for (size_t i = 0; i < m_generators.size(); ++i)
+    {
+        if (m_cancelled)
+            break;
+        if (m_generators[i]->generate_async(line, builder, m_states[i]))
+            break;
+    }
+}
+
+//------------------------------------------------------------------------------
+unsigned __stdcall match_job::threadproc(void* arg)
+{
+    match_job* _this = static_cast<match_job*>(arg);
+
+    _this->run();
+
+    SetEvent(_this->m_done_event);
+
+    // Release threadproc's strong ref.
+    _this->m_holder = nullptr;
+
+    _endthreadex(0);
+    return 0;
+}
@@ -0,0 +1,54 @@
+// Copyright (c) 2021 Christopher Antos
+// License: http://opensource.org/licenses/MIT
+
+#pragma once
+
+#include "line_state.h"
+#include "match_generator.h"
+#include "matches_impl.h"
+
+#include <core/str.h>
+
+#include <memory>
+#include <vector>
+
+class terminal_in;
+template <typename T> class array;
+
+//------------------------------------------------------------------------------
+// Runs async capable match generators on a worker thread.  The worker builds
+// into a private matches_impl (the back buffer), and the input thread drains
+// newly added matches into the visible matches_impl (the front buffer) in
+// batches, so the completion UI can consume partial results.  Any Readline
+// state the generators need is captured when the job is created, on the input
+// thread.
+class match_job
+    : public std::enable_shared_from_this<match_job>
+{
+public:
+                        match_job(const line_state& line, const array<match_generator*>& generators, unsigned int first);
+                        ~match_job();
+    void                start();
+    void                cancel();
+    bool                is_done() const;
+    bool                wait_unless_input(terminal_in& in, unsigned int timeout) const;
+    unsigned int        drain(matches_impl& front);
+
+private:
+    static unsigned __stdcall threadproc(void* arg);
+    void                run();
+
+    str_moveable        m_line;
+    std::vector<word>   m_words;
+    unsigned int        m_cursor;
+    unsigned int        m_command_offset;
+    std::vector<match_generator*> m_generators;
+    std::vector<async_generate_state> m_states;
+    matches_impl        m_back;
+    CRITICAL_SECTION    m_lock;
+    unsigned int        m_drained = 0;
+    HANDLE              m_thread_handle = 0;
+    HANDLE              m_done_event = 0;
+    volatile long       m_cancelled = false;
+    std::shared_ptr<match_job> m_holder;
+};
@@ -37,6 +37,10 @@ static setting_enum g_sort_dirs(
 //------------------------------------------------------------------------------
 static bool s_nosort = false;
 
+// Lists longer than this are put in order lazily:  only the pages that get
+// accessed are ordered (see matches_impl::ensure_ordered).
+static const unsigned int c_lazy_sort_threshold = 4096;
+
 //------------------------------------------------------------------------------
 static unsigned int normal_selector(
     const char* needle,
@@ -61,7 +65,7 @@ static unsigned int restrict_selector(
     match_info* infos,
     int count)
 {
-    int needle_len = strlen(needle);
+    const path::wild_pattern<char> pattern(str_iter(needle, int(strlen(needle))));
 
     int select_count = 0;
     for (int i = 0; i < count; ++i)
@@ -72,7 +76,7 @@ static unsigned int restrict_selector(
             match_len--;
 
         const path::star_matches_everything flag = (is_pathish(infos[i].type) ? path::at_end : path::yes);
-        infos[i].select = path::match_wild(str_iter(needle, needle_len), str_iter(match, match_len), flag);
+        infos[i].select = pattern.match(str_iter(match, match_len), flag);
         ++select_count;
     }
 
@@ -138,7 +142,7 @@ inline bool sort_worker(wstr_base& l, match_type l_type,
 }
 
 //------------------------------------------------------------------------------
-static void alpha_sorter(match_info* infos, int count)
+static void alpha_sorter(match_info* infos, unsigned int first, unsigned int nth, unsigned int last)
 {
     int order = g_sort_dirs.get();
     wstr<> ltmp;
@@ -152,7 +156,10 @@ static void alpha_sorter(match_info* infos, int count)
         return sort_worker(ltmp, lhs.type, rtmp, rhs.type, order);
     };
 
-    std::sort(infos, infos + count, predicate);
+    if (nth >= last)
+        std::sort(infos + first, infos + last, predicate);
+    else
+        std::nth_element(infos + first, infos + nth, infos + last, predicate);
 }
 
 //------------------------------------------------------------------------------
@@ -191,6 +198,11 @@ void sort_match_list(char** matches, int len)
         return sort_worker(ltmp, l_type, rtmp, r_type, order);
     };
 
+    // Matches copied from an ordered match list are usually already in order,
+    // and checking is linear.
+    if (std::is_sorted(matches, matches + len, predicate))
+        return;
+
     std::sort(matches, matches + len, predicate);
 }
 
@@ -216,17 +228,35 @@ void match_pipeline::set_nosort(bool nosort)
 }
 
 //------------------------------------------------------------------------------
-void match_pipeline::generate(
+// Returns the index of the first generator that was not run.  When
+// stop_at_async is true, generation stops before the first generator of a
+// trailing run of async capable generators; the caller is then responsible
+// for running the rest (see match_job) and calling done_building().
+unsigned int match_pipeline::generate(
     const line_state& state,
     const array<match_generator*>& generators,
-    bool old_filtering) const
+    bool old_filtering,
+    bool stop_at_async) const
 {
     m_matches.set_word_break_position(state.get_end_word_offset());
 
+    unsigned int async_start = generators.size();
+    if (stop_at_async && !old_filtering)
+    {
+        while (async_start > 0 && (*generators[async_start - 1])->can_generate_async())
+            --async_start;
+    }
+
+    unsigned int index = 0;
     match_builder builder(m_matches);
     for (auto* generator : generators)
+    {
+        if (index >= async_start)
+            return index;
+        ++index;
         if (generator->generate(state, builder, old_filtering))
             break;
+    }
 
     m_matches.done_building();
 
@@ -251,6 +281,8 @@ void match_pipeline::generate(
         printf("\n");
     }
 #endif
+
+    return generators.size();
 }
 
 //------------------------------------------------------------------------------
@@ -329,9 +361,15 @@ void match_pipeline::sort() const
     if (s_nosort)
         return;
 
-    int count = m_matches.get_match_count();
+    unsigned int count = m_matches.get_match_count();
     if (!count)
         return;
 
-    alpha_sorter(m_matches.get_infos(), count);
+    // Large lists are ordered a page at a time as the pages are accessed, so
+    // e.g. clink-select-complete only orders the pages it shows.  The longest
+    // common denominator doesn't depend on the order, so it's unaffected.
+    if (count > c_lazy_sort_threshold)
+        m_matches.set_lazy_sort(alpha_sorter);
+    else
+        alpha_sorter(m_matches.get_infos(), 0, count, count);
 }
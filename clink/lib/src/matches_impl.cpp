@@ -22,6 +22,7 @@ extern "C" {
 #include <readline/rlprivate.h>
 };
 
+#include <algorithm>
 #include <assert.h>
 
 //------------------------------------------------------------------------------
@@ -45,22 +46,135 @@ static setting_enum g_translate_slashes(
 
 
 //------------------------------------------------------------------------------
-struct matches_impl::match_lookup_hasher
+match_lookup_table::~match_lookup_table()
 {
-    size_t operator()(const match_lookup& info) const
+    free(m_slots);
+}
+
+//------------------------------------------------------------------------------
+unsigned int match_lookup_table::hash(const char* match)
+{
+    return str_hash_mixed(match);
+}
+
+//------------------------------------------------------------------------------
+void match_lookup_table::clear()
+{
+    // Keep the slot array; the next generation will most likely need a similar
+    // capacity.
+    if (m_count)
+        memset(m_slots, 0, m_capacity * sizeof(*m_slots));
+    m_count = 0;
+}
+
+//------------------------------------------------------------------------------
+unsigned int match_lookup_table::find_slot(const match_lookup& lookup, unsigned int hash) const
+{
+    assert(m_capacity);
+    const unsigned int mask = m_capacity - 1;
+    for (unsigned int i = hash & mask;; i = (i + 1) & mask)
     {
-        return str_hash(info.match);
+        const slot& s = m_slots[i];
+        if (!s.match)
+            return i;
+        if (s.hash == hash && s.type == lookup.type && strcmp(s.match, lookup.match) == 0)
+            return i;
     }
-};
+}
 
 //------------------------------------------------------------------------------
-struct matches_impl::match_lookup_comparator
+bool match_lookup_table::find(const match_lookup& lookup, unsigned int hash) const
 {
-    bool operator()(const match_lookup& i1, const match_lookup& i2) const
+    if (!m_count)
+        return false;
+
+    return m_slots[find_slot(lookup, hash)].match != nullptr;
+}
+
+//------------------------------------------------------------------------------
+bool match_lookup_table::insert(const match_lookup& lookup, unsigned int hash)
+{
+    // Keep the load factor at or below 1/2 so probe sequences stay short.
+    if ((m_count + 1) * 2 > m_capacity && !grow())
+        return false;
+
+    slot& s = m_slots[find_slot(lookup, hash)];
+    if (s.match)
+        return false;
+
+    s.match = lookup.match;
+    s.hash = hash;
+    s.type = lookup.type;
+    ++m_count;
+    return true;
+}
+
+//------------------------------------------------------------------------------
+void match_lookup_table::erase(const match_lookup& lookup)
+{
+    if (!m_count)
+        return;
+
+    const unsigned int mask = m_capacity - 1;
+    unsigned int i = find_slot(lookup, hash(lookup.match));
+    if (!m_slots[i].match)
+        return;
+
+    // Backward shift deletion; avoids tombstones so lookups never degrade.
+    for (unsigned int j = (i + 1) & mask; m_slots[j].match; j = (j + 1) & mask)
     {
-        return (i1.type == i2.type && strcmp(i1.match, i2.match) == 0);
+        const unsigned int k = m_slots[j].hash & mask;
+        const bool in_run = (i <= j) ? (i < k && k <= j) : (i < k || k <= j);
+        if (in_run)
+            continue;
+
+        m_slots[i] = m_slots[j];
+        i = j;
     }
-};
+
+    m_slots[i].match = nullptr;
+    --m_count;
+}
+
+//------------------------------------------------------------------------------
+// Grows the table once up front so that inserting count more entries doesn't
+// need to rehash repeatedly.
+bool match_lookup_table::reserve(unsigned int count)
+{
+    while ((m_count + count) * 2 > m_capacity)
+    {
+        if (!grow())
+            return false;
+    }
+    return true;
+}
+
+//------------------------------------------------------------------------------
+bool match_lookup_table::grow()
+{
+    const unsigned int capacity = m_capacity ? m_capacity * 2 : 256;
+    slot* slots = (slot*)calloc(capacity, sizeof(*slots));
+    if (!slots)
+        return false;
+
+    const unsigned int mask = capacity - 1;
+    for (unsigned int i = 0; i < m_capacity; ++i)
+    {
+        const slot& s = m_slots[i];
+        if (!s.match)
+            continue;
+
+        unsigned int j = s.hash & mask;
+        while (slots[j].match)
+            j = (j + 1) & mask;
+        slots[j] = s;
+    }
+
+    free(m_slots);
+    m_slots = slots;
+    m_capacity = capacity;
+    return true;
+}
 
 
 
@@ -220,6 +334,18 @@ bool match_builder::add_match(const match_desc& desc, bool already_normalized)
     return ((matches_impl&)m_matches).add_match(desc, already_normalized);
 }
 
+//------------------------------------------------------------------------------
+unsigned int match_builder::add_matches(const match_desc* descs, unsigned int count, bool already_normalized)
+{
+    return ((matches_impl&)m_matches).add_matches(descs, count, already_normalized);
+}
+
+//------------------------------------------------------------------------------
+bool match_builder::is_cancelled() const
+{
+    return ((const matches_impl&)m_matches).is_cancelled();
+}
+
 //------------------------------------------------------------------------------
 void match_builder::set_append_character(char append)
 {
@@ -256,12 +382,15 @@ void match_builder::set_matches_are_files(bool files)
 matches_iter::matches_iter(const matches& matches, const char* pattern)
 : m_matches(matches)
 , m_expanded_pattern(pattern && rl_complete_with_tilde_expansion ? tilde_expand(pattern) : nullptr)
-, m_pattern((m_expanded_pattern ? m_expanded_pattern : pattern),
-            (m_expanded_pattern ? m_expanded_pattern : pattern) ? -1 : 0)
+, m_pattern(str_iter((m_expanded_pattern ? m_expanded_pattern : pattern),
+                     (m_expanded_pattern ? m_expanded_pattern : pattern) ? -1 : 0))
 , m_has_pattern(pattern != nullptr)
 , m_filename_completion_desired(matches.is_filename_completion_desired())
 , m_filename_display_desired(matches.is_filename_display_desired())
 {
+    // Iterating walks the matches in order, so finish ordering them up front
+    // rather than a page at a time.
+    m_matches.ensure_ordered();
 }
 
 //------------------------------------------------------------------------------
@@ -292,7 +421,7 @@ bool matches_iter::next()
                 match_len--;
 
             const path::star_matches_everything flag = is_pathish(get_match_type()) ? path::at_end : path::yes;
-            if (path::match_wild(m_pattern, str_iter(match, match_len), flag))
+            if (m_pattern.match(str_iter(match, match_len), flag))
                 goto found;
         }
     }
@@ -368,26 +497,74 @@ shadow_bool matches_iter::is_filename_display_desired() const
 
 
 
+//------------------------------------------------------------------------------
+// Number of consecutive small generations before surplus pages are released.
+static const unsigned int c_shrink_after_resets = 64;
+
 //------------------------------------------------------------------------------
 matches_impl::store_impl::store_impl(unsigned int size)
 {
     m_size = max((unsigned int)4096, size);
     m_ptr = nullptr;
+    m_front = 0;
+    m_back = m_size;
     new_page();
 }
 
 //------------------------------------------------------------------------------
 matches_impl::store_impl::~store_impl()
 {
-    free_chain(false/*keep_one*/);
+    free_pages(0);
 }
 
 //------------------------------------------------------------------------------
 void matches_impl::store_impl::reset()
 {
-    free_chain(true/*keep_one*/);
+    ++m_resets;
+
+    // Pages are retained for the next generation.  But if many consecutive
+    // generations have used only a small fraction of the retained pages (e.g.
+    // after a one-off huge completion), release the surplus.
+    const unsigned int used = m_page + 1;
+    m_window_peak = max(m_window_peak, used);
+    if (m_window_peak * 4 <= m_pages.size())
+    {
+        if (++m_small_resets >= c_shrink_after_resets)
+        {
+            free_pages(m_window_peak * 2);
+            m_small_resets = 0;
+            m_window_peak = 0;
+            ++m_shrinks;
+        }
+    }
+    else
+    {
+        m_small_resets = 0;
+        m_window_peak = 0;
+    }
+
+    m_page = 0;
+    m_ptr = m_pages.empty() ? nullptr : m_pages[0];
+    m_front = 0;
     m_back = m_size;
-    m_front = sizeof(m_ptr);
+}
+
+//------------------------------------------------------------------------------
+matches_impl::store_impl::checkpoint matches_impl::store_impl::get_checkpoint() const
+{
+    return { m_page, m_front, m_back };
+}
+
+//------------------------------------------------------------------------------
+void matches_impl::store_impl::rollback(const checkpoint& cp)
+{
+    assert(cp.page <= m_page);
+    assert(cp.page < m_page || (cp.front <= m_front && cp.back >= m_back));
+
+    m_page = cp.page;
+    m_ptr = m_pages[m_page];
+    m_front = cp.front;
+    m_back = cp.back;
 }
 
 //------------------------------------------------------------------------------
@@ -395,8 +572,14 @@ const char* matches_impl::store_impl::store_front(const char* str)
 {
     unsigned int size = get_size(str);
     unsigned int next = m_front + size;
-    if (next > m_back && !new_page())
-        return nullptr;
+    if (next > m_back)
+    {
+        if (!new_page())
+            return nullptr;
+        next = m_front + size;
+        if (next > m_back)
+            return nullptr;
+    }
 
     str_base(m_ptr + m_front, size).copy(str);
 
@@ -409,16 +592,33 @@ const char* matches_impl::store_impl::store_front(const char* str)
 const char* matches_impl::store_impl::store_back(const char* str)
 {
     unsigned int size = get_size(str);
-    unsigned int next = m_back - size;
-    if (next < m_front && !new_page())
-        return nullptr;
+    if (m_front + size > m_back)
+    {
+        if (!new_page())
+            return nullptr;
+        if (m_front + size > m_back)
+            return nullptr;
+    }
 
-    m_back = next;
+    m_back -= size;
     str_base(m_ptr + m_back, size).copy(str);
 
     return m_ptr + m_back;
 }
 
+//------------------------------------------------------------------------------
+void matches_impl::store_impl::get_stats(match_store_stats& stats) const
+{
+    stats.page_size = m_size;
+    stats.pages_retained = (unsigned int)m_pages.size();
+    stats.pages_in_use = m_pages.empty() ? 0 : m_page + 1;
+    stats.bytes_in_use = m_page * m_size + m_front + (m_size - m_back);
+    stats.high_water_pages = m_high_water_pages;
+    stats.page_allocs = m_page_allocs;
+    stats.resets = m_resets;
+    stats.shrinks = m_shrinks;
+}
+
 //------------------------------------------------------------------------------
 unsigned int matches_impl::store_impl::get_size(const char* str) const
 {
@@ -431,41 +631,41 @@ unsigned int matches_impl::store_impl::get_size(const char* str) const
 //------------------------------------------------------------------------------
 bool matches_impl::store_impl::new_page()
 {
-    char* temp = (char*)malloc(m_size);
-    if (temp == nullptr)
-        return false;
+    unsigned int next = m_ptr ? m_page + 1 : 0;
+    if (next >= m_pages.size())
+    {
+        char* temp = (char*)malloc(m_size);
+        if (temp == nullptr)
+            return false;
+
+        m_pages.push_back(temp);
+        ++m_page_allocs;
+    }
 
-    *reinterpret_cast<char**>(temp) = m_ptr;
-    m_front = sizeof(m_ptr);
+    m_page = next;
+    m_ptr = m_pages[m_page];
+    m_front = 0;
     m_back = m_size;
-    m_ptr = temp;
+    m_high_water_pages = max(m_high_water_pages, m_page + 1);
     return true;
 }
 
 //------------------------------------------------------------------------------
-void matches_impl::store_impl::free_chain(bool keep_one)
+void matches_impl::store_impl::free_pages(unsigned int keep)
 {
-    char* ptr = m_ptr;
+    assert(!keep || m_page < keep);
 
-    if (!keep_one)
+    for (size_t i = keep; i < m_pages.size(); ++i)
+        free(m_pages[i]);
+    m_pages.resize(min<size_t>(keep, m_pages.size()));
+
+    if (m_pages.empty())
     {
         m_ptr = nullptr;
-        m_front = sizeof(m_ptr);
+        m_page = 0;
+        m_front = 0;
         m_back = m_size;
     }
-
-    while (ptr)
-    {
-        char* tmp = ptr;
-        ptr = *reinterpret_cast<char**>(ptr);
-        if (keep_one)
-        {
-            keep_one = false;
-            *reinterpret_cast<char**>(tmp) = nullptr;
-        }
-        else
-            free(tmp);
-    }
 }
 
 
@@ -522,6 +722,7 @@ const char* matches_impl::get_match(unsigned int index) const
     if (index >= get_match_count())
         return nullptr;
 
+    ensure_ordered(index);
     return m_infos[index].match;
 }
 
@@ -531,6 +732,7 @@ match_type matches_impl::get_match_type(unsigned int index) const
     if (index >= get_match_count())
         return match_type::none;
 
+    ensure_ordered(index);
     return m_infos[index].type;
 }
 
@@ -540,6 +742,7 @@ const char* matches_impl::get_match_display(unsigned int index) const
     if (index >= get_match_count())
         return nullptr;
 
+    ensure_ordered(index);
     return m_infos[index].display;
 }
 
@@ -549,6 +752,7 @@ const char* matches_impl::get_match_description(unsigned int index) const
     if (index >= get_match_count())
         return nullptr;
 
+    ensure_ordered(index);
     return m_infos[index].description;
 }
 
@@ -558,6 +762,7 @@ bool matches_impl::get_match_append_display(unsigned int index) const
     if (index >= get_match_count())
         return false;
 
+    ensure_ordered(index);
     return m_infos[index].append_display;
 }
 
@@ -673,10 +878,12 @@ void matches_impl::reset()
 {
     m_store.reset();
     m_infos.clear();
+    m_dedup.clear();
     m_any_infer_type = false;
     m_can_infer_type = true;
     m_coalesced = false;
     m_count = 0;
+    m_lazy_sort = nullptr;
     m_append_character = '\0';
     m_regen_blocked = false;
     m_suppress_append = false;
@@ -688,21 +895,32 @@ void matches_impl::reset()
     s_slash_translation = g_translate_slashes.get();
 }
 
+//------------------------------------------------------------------------------
+struct publish_lock_scope
+{
+    publish_lock_scope(CRITICAL_SECTION* lock) : m_lock(lock) { if (m_lock) EnterCriticalSection(m_lock); }
+    ~publish_lock_scope() { if (m_lock) LeaveCriticalSection(m_lock); }
+    CRITICAL_SECTION* const m_lock;
+};
+
 //------------------------------------------------------------------------------
 void matches_impl::set_append_character(char append)
 {
+    publish_lock_scope _(m_publish_lock);
     m_append_character = append;
 }
 
 //------------------------------------------------------------------------------
 void matches_impl::set_suppress_append(bool suppress)
 {
+    publish_lock_scope _(m_publish_lock);
     m_suppress_append = suppress;
 }
 
 //------------------------------------------------------------------------------
 void matches_impl::set_suppress_quoting(int suppress)
 {
+    publish_lock_scope _(m_publish_lock);
     m_suppress_quoting = suppress;
 }
 
@@ -721,18 +939,58 @@ void matches_impl::set_regen_blocked()
 //------------------------------------------------------------------------------
 void matches_impl::set_deprecated_mode()
 {
+    publish_lock_scope _(m_publish_lock);
     m_can_infer_type = false;
 }
 
 //------------------------------------------------------------------------------
 void matches_impl::set_matches_are_files(bool files)
 {
+    publish_lock_scope _(m_publish_lock);
     m_filename_completion_desired.set_explicit(files);
     m_filename_display_desired.set_explicit(files);
 }
 
 //------------------------------------------------------------------------------
 bool matches_impl::add_match(const match_desc& desc, bool already_normalized)
+{
+    if (is_cancelled())
+        return false;
+
+    publish_lock_scope _(m_publish_lock);
+    return add_match_internal(desc, already_normalized);
+}
+
+//------------------------------------------------------------------------------
+// Adds many matches at once; the publish lock is taken once and capacity is
+// reserved up front, instead of per match.  Returns the number added.
+unsigned int matches_impl::add_matches(const match_desc* descs, unsigned int count, bool already_normalized)
+{
+    if (is_cancelled() || m_coalesced || !count)
+        return 0;
+
+    publish_lock_scope _(m_publish_lock);
+
+    // Grow geometrically, so that many small batches stay linear.
+    const size_t needed = m_infos.size() + count;
+    if (m_infos.capacity() < needed)
+        m_infos.reserve(max<size_t>(needed, m_infos.capacity() * 2));
+    m_dedup.reserve(count);
+
+    unsigned int added = 0;
+    for (unsigned int i = 0; i < count; ++i)
+    {
+        // Check for cancellation periodically, not per match.
+        if (i && !(i & 0xff) && is_cancelled())
+            break;
+        added += !!add_match_internal(descs[i], already_normalized);
+    }
+
+    return added;
+}
+
+//------------------------------------------------------------------------------
+bool matches_impl::add_match_internal(const match_desc& desc, bool already_normalized)
 {
     const char* match = desc.match;
     match_type type = desc.type;
@@ -787,10 +1045,9 @@ bool matches_impl::add_match(const match_desc& desc, bool already_normalized)
         match = tmp.c_str();
     }
 
-    if (!m_dedup)
-        m_dedup = new match_lookup_unordered_set;
-
-    if (m_dedup->find({ match, type }) != m_dedup->end())
+    // The stored copy of match has the same text, so hash it only once.
+    const unsigned int hash = match_lookup_table::hash(match);
+    if (m_dedup.find({ match, type }, hash))
         return false;
 
     if (is_none)
@@ -801,6 +1058,7 @@ bool matches_impl::add_match(const match_desc& desc, bool already_normalized)
         match = tmp.c_str();
     }
 
+    const store_impl::checkpoint checkpoint = m_store.get_checkpoint();
     const char* store_match = m_store.store_front(match);
     if (!store_match)
         return false;
@@ -815,16 +1073,24 @@ bool matches_impl::add_match(const match_desc& desc, bool already_normalized)
         m_any_infer_type = true;
     }
 
-    const char* store_display = (desc.display && *desc.display) ? m_store.store_front(desc.display) : nullptr;
-    const char* store_description = (desc.description && *desc.description) ? m_store.store_front(desc.description) : nullptr;
+    const char* store_display = nullptr;
+    const char* store_description = nullptr;
+    if ((desc.display && *desc.display && !(store_display = m_store.store_front(desc.display))) ||
+        (desc.description && *desc.description && !(store_description = m_store.store_front(desc.description))))
+    {
+        // Don't leave a partially stored match behind.
+        m_store.rollback(checkpoint);
+        return false;
+    }
     bool append_display = (desc.append_display && store_display);
 
     match_lookup lookup = { store_match, type };
-    m_dedup->emplace(std::move(lookup));
+    m_dedup.insert(lookup, hash);
 
     match_info info = { store_match, store_display, store_description, type, append_display, false/*select*/, is_none/*infer_type*/ };
     m_infos.emplace_back(std::move(info));
     ++m_count;
+    m_lazy_sort = nullptr;
 
     return true;
 }
@@ -858,7 +1124,7 @@ void matches_impl::done_building()
                 case os::path_type_dir:
                     {
                         // Remove it from the dup map before modifying it.
-                        m_dedup->erase(lookup);
+                        m_dedup.erase(lookup);
                         // It's a directory, so update the type and add a
                         // trailing path separator.
                         const size_t len = strlen(m_infos[i].match);
@@ -870,7 +1136,7 @@ void matches_impl::done_building()
                 case os::path_type_file:
                     {
                         // Remove it from the dup map before modifying it.
-                        m_dedup->erase(lookup);
+                        m_dedup.erase(lookup);
                         // It's a file, so update the type.
                         lookup.type |= match_type::file;
                         m_infos[i].type |= lookup.type;
@@ -881,16 +1147,130 @@ void matches_impl::done_building()
                 }
 
                 // Check if it has become a duplicate.
-                if (m_dedup->find(lookup) != m_dedup->end())
+                const unsigned int hash = match_lookup_table::hash(lookup.match);
+                if (m_dedup.find(lookup, hash))
                     m_infos.erase(m_infos.begin() + i);
                 else
-                    m_dedup->emplace(std::move(lookup));
+                    m_dedup.insert(lookup, hash);
             }
         }
     }
 
-    delete m_dedup;
-    m_dedup = nullptr;
+    m_dedup.clear();
+}
+
+//------------------------------------------------------------------------------
+// Allows adding more matches after select() coalesced them, e.g. when a
+// match_job publishes more matches after partial results were selected.
+void matches_impl::reopen()
+{
+    m_count = (unsigned int)m_infos.size();
+    m_coalesced = false;
+    m_lazy_sort = nullptr;
+}
+
+//------------------------------------------------------------------------------
+void matches_impl::get_store_stats(match_store_stats& stats) const
+{
+    m_store.get_stats(stats);
+}
+
+//------------------------------------------------------------------------------
+// Number of matches put in order at a time, when ordering lazily.
+static const unsigned int c_lazy_sort_page = 256;
+
+//------------------------------------------------------------------------------
+void matches_impl::set_any_order(bool any_order) const
+{
+    m_any_order = any_order;
+}
+
+//------------------------------------------------------------------------------
+void matches_impl::set_lazy_sort(lazy_sort_func func)
+{
+    m_lazy_sort = func;
+    m_order_cuts.clear();
+    m_order_cuts.push_back(0);
+    m_order_cuts.push_back(m_count);
+    m_ordered_pages.assign((m_count + c_lazy_sort_page - 1) / c_lazy_sort_page, false);
+    m_ordered_count = 0;
+}
+
+//------------------------------------------------------------------------------
+// Orders the page containing index.  Moving from one page to the next orders
+// as many pages as are already ordered before it, so walking every page only
+// partitions the list a logarithmic number of times.
+void matches_impl::ensure_ordered(unsigned int index) const
+{
+    if (!m_lazy_sort || m_any_order || index >= m_count)
+        return;
+
+    unsigned int page = index / c_lazy_sort_page;
+    if (m_ordered_pages[page])
+        return;
+
+    unsigned int pages = 1;
+    while (pages <= page && m_ordered_pages[page - pages])
+        pages++;
+    pages = min<unsigned int>(pages, unsigned(m_ordered_pages.size()) - page);
+
+    const unsigned int first = page * c_lazy_sort_page;
+    const unsigned int last = min<unsigned int>(first + pages * c_lazy_sort_page, m_count);
+
+    // Once first and last are cuts, infos[first..last) holds exactly the
+    // matches that belong there, and only they need to be fully ordered.
+    // Cutting at last first leaves a smaller span to cut at first.
+    partition_at(last);
+    partition_at(first);
+    m_lazy_sort(const_cast<match_info*>(&m_infos[0]), first, last, last);
+
+    for (unsigned int i = page; i < page + pages; ++i)
+    {
+        if (!m_ordered_pages[i])
+        {
+            m_ordered_pages[i] = true;
+            m_ordered_count += min<unsigned int>((i + 1) * c_lazy_sort_page, m_count) - i * c_lazy_sort_page;
+        }
+    }
+
+    if (m_ordered_count >= m_count)
+        m_lazy_sort = nullptr;
+}
+
+//------------------------------------------------------------------------------
+// Orders every page that isn't ordered yet.
+void matches_impl::ensure_ordered() const
+{
+    if (!m_lazy_sort || m_any_order)
+        return;
+
+    // Cuts are page boundaries, and an ordered page is bounded by cuts, so
+    // each span between cuts is either fully ordered or not ordered at all.
+    match_info* infos = const_cast<match_info*>(&m_infos[0]);
+    for (size_t i = 1; i < m_order_cuts.size(); ++i)
+    {
+        const unsigned int first = m_order_cuts[i - 1];
+        const unsigned int last = m_order_cuts[i];
+        if (!m_ordered_pages[first / c_lazy_sort_page])
+            m_lazy_sort(infos, first, last, last);
+    }
+
+    m_lazy_sort = nullptr;
+}
+
+//------------------------------------------------------------------------------
+// Makes pos a cut, by partitioning the span between the cuts around it.
+void matches_impl::partition_at(unsigned int pos) const
+{
+    // 0 and m_count are always cuts.
+    auto cut = std::lower_bound(m_order_cuts.begin(), m_order_cuts.end(), pos);
+    assert(cut != m_order_cuts.end());
+    if (*cut == pos)
+        return;
+
+    match_info* infos = const_cast<match_info*>(&m_infos[0]);
+    m_lazy_sort(infos, *(cut - 1), pos, *cut);
+    m_order_cuts.insert(cut, pos);
 }
 
 //------------------------------------------------------------------------------
@@ -926,6 +1306,7 @@ void matches_impl::coalesce(unsigned int count_hint, bool restrict)
 
     m_count = j;
     m_coalesced = true;
+    m_lazy_sort = nullptr;
 
     if (restrict)
         m_infos.resize(j);
@@ -6,7 +6,6 @@
 #include "matches.h"
 
 #include "core/array.h"
-#include <unordered_set>
 #include <vector>
 
 //------------------------------------------------------------------------------
@@ -28,8 +27,57 @@ struct match_lookup
     match_type      type;
 };
 
+//------------------------------------------------------------------------------
+// Open addressing (linear probing) set of match_lookup entries, used to dedup
+// matches while building.  The slot array is retained across generations and
+// only grows, so steady state generation does not allocate.
+class match_lookup_table
+{
+public:
+                            match_lookup_table() = default;
+                            ~match_lookup_table();
+                            match_lookup_table(const match_lookup_table&) = delete;
+    match_lookup_table&     operator = (const match_lookup_table&) = delete;
+    static unsigned int     hash(const char* match);
+    void                    clear();
+    bool                    find(const match_lookup& lookup) const { return find(lookup, hash(lookup.match)); }
+    bool                    find(const match_lookup& lookup, unsigned int hash) const;
+    bool                    insert(const match_lookup& lookup) { return insert(lookup, hash(lookup.match)); }
+    bool                    insert(const match_lookup& lookup, unsigned int hash);
+    void                    erase(const match_lookup& lookup);
+    bool                    reserve(unsigned int count);
+    unsigned int            size() const { return m_count; }
+
+private:
+    struct slot
+    {
+        const char*         match;
+        unsigned int        hash;
+        match_type          type;
+    };
+
+    unsigned int            find_slot(const match_lookup& lookup, unsigned int hash) const;
+    bool                    grow();
+    slot*                   m_slots = nullptr;
+    unsigned int            m_capacity = 0;
+    unsigned int            m_count = 0;
+};
+
 
 
+//------------------------------------------------------------------------------
+struct match_store_stats
+{
+    unsigned int            page_size;
+    unsigned int            pages_retained;
+    unsigned int            pages_in_use;
+    unsigned int            bytes_in_use;
+    unsigned int            high_water_pages;
+    unsigned int            page_allocs;
+    unsigned int            resets;
+    unsigned int            shrinks;
+};
+
 //------------------------------------------------------------------------------
 class match_store
 {
@@ -43,16 +91,17 @@ protected:
 //------------------------------------------------------------------------------
 class match_generator;
 
+// Orders infos[first..last) just enough that infos[nth] holds the match that
+// belongs there, with nothing before it that belongs after it and nothing
+// after it that belongs before it.  When nth is last, fully orders them.
+typedef void (*lazy_sort_func)(match_info* infos, unsigned int first, unsigned int nth, unsigned int last);
+
 //------------------------------------------------------------------------------
 class matches_impl
     : public matches
 {
-    struct match_lookup_hasher;
-    struct match_lookup_comparator;
-
 public:
     typedef fixed_array<match_generator*, 32> generators;
-    typedef std::unordered_set<match_lookup, match_lookup_hasher, match_lookup_comparator> match_lookup_unordered_set;
 
                             matches_impl(generators* generators=nullptr, unsigned int store_size=0x10000);
     matches_iter            get_iter() const;
@@ -71,14 +120,21 @@ public:
     virtual int             get_suppress_quoting() const override;
     virtual int             get_word_break_position() const override;
     virtual bool            match_display_filter(const char* needle, char** matches, match_display_filter_entry*** filtered_matches, display_filter_flags flags, bool* old_filtering=nullptr) const override;
+    virtual void            set_any_order(bool any_order) const override;
 
     void                    set_word_break_position(int position);
     void                    set_regen_blocked();
     bool                    is_regen_blocked() const { return m_regen_blocked; }
 
     void                    done_building();
+    void                    reopen();
+    bool                    is_cancelled() const { return m_cancel && *m_cancel; }
+    void                    get_store_stats(match_store_stats& stats) const;
+    void                    set_lazy_sort(lazy_sort_func func);
+    unsigned int            get_ordered_count() const { return m_lazy_sort ? m_ordered_count : m_count; }
 
 private:
+    virtual void            ensure_ordered() const override;
     virtual const char*     get_unfiltered_match(unsigned int index) const override;
     virtual match_type      get_unfiltered_match_type(unsigned int index) const override;
     virtual const char*     get_unfiltered_match_display(unsigned int index) const override;
@@ -88,35 +144,61 @@ private:
     friend class            match_pipeline;
     friend class            match_builder;
     friend class            matches_iter;
+    friend class            match_job;
     void                    set_append_character(char append);
     void                    set_suppress_append(bool suppress);
     void                    set_suppress_quoting(int suppress);
     void                    set_deprecated_mode();
     void                    set_matches_are_files(bool files);
     bool                    add_match(const match_desc& desc, bool already_normalised=false);
+    unsigned int            add_matches(const match_desc* descs, unsigned int count, bool already_normalised=false);
+    bool                    add_match_internal(const match_desc& desc, bool already_normalised);
     unsigned int            get_info_count() const;
     const match_info*       get_infos() const;
     match_info*             get_infos();
     void                    reset();
     void                    coalesce(unsigned int count_hint, bool restrict=false);
+    void                    ensure_ordered(unsigned int index) const;
+    void                    partition_at(unsigned int pos) const;
 
 private:
+    // Retained arena:  pages stay allocated across generations, and are only
+    // released after a sustained run of generations that use far fewer pages
+    // than are retained.
     class store_impl
         : public match_store
     {
     public:
+        struct checkpoint
+        {
+            unsigned int    page;
+            unsigned int    front;
+            unsigned int    back;
+        };
+
                             store_impl(unsigned int size);
                             ~store_impl();
         void                reset();
+        checkpoint          get_checkpoint() const;
+        void                rollback(const checkpoint& cp);
         const char*         store_front(const char* str);
         const char*         store_back(const char* str);
+        void                get_stats(match_store_stats& stats) const;
 
     private:
         unsigned int        get_size(const char* str) const;
         bool                new_page();
-        void                free_chain(bool keep_one);
+        void                free_pages(unsigned int keep);
+        std::vector<char*>  m_pages;
+        unsigned int        m_page = 0;
         unsigned int        m_front;
         unsigned int        m_back;
+        unsigned int        m_window_peak = 0;
+        unsigned int        m_small_resets = 0;
+        unsigned int        m_high_water_pages = 0;
+        unsigned int        m_page_allocs = 0;
+        unsigned int        m_resets = 0;
+        unsigned int        m_shrinks = 0;
     };
 
     typedef std::vector<match_info> infos;
@@ -124,7 +206,7 @@ private:
     store_impl              m_store;
     generators*             m_generators;
     infos                   m_infos;
-    unsigned short          m_count = 0;
+    unsigned int            m_count = 0;
     bool                    m_any_infer_type = false;
     bool                    m_can_infer_type = true;
     bool                    m_coalesced = false;
@@ -136,5 +218,18 @@ private:
     shadow_bool             m_filename_completion_desired;
     shadow_bool             m_filename_display_desired;
 
-    match_lookup_unordered_set* m_dedup = nullptr;
+    match_lookup_table      m_dedup;
+
+    // Lazy ordering:  large lists are put in order a page at a time, as the
+    // accessors reach each page (see match_pipeline::sort).  m_order_cuts are
+    // the positions known to have no match before them that belongs after.
+    mutable lazy_sort_func  m_lazy_sort = nullptr;
+    mutable std::vector<unsigned int> m_order_cuts;
+    mutable std::vector<bool> m_ordered_pages;
+    mutable unsigned int    m_ordered_count = 0;
+    mutable bool            m_any_order = false;
+
+    // Used when a match_job builds on a worker thread.
+    CRITICAL_SECTION*       m_publish_lock = nullptr;
+    const volatile long*    m_cancel = nullptr;
 };
@@ -10,8 +10,11 @@
 #include "rl_commands.h"
 #include "doskey.h"
 #include "terminal_helpers.h"
+#include "matches_impl.h"
 
 #include <core/base.h>
+#include <core/dir_cache.h>
+#include <core/latency.h>
 #include <core/log.h>
 #include <core/path.h>
 #include <core/settings.h>
@@ -1893,6 +1896,83 @@ int clink_diagnostics(int count, int invoking_key)
         g_printer->print(s.c_str(), s.length());
     }
 
+    // Match store arenas.
+
+    match_store_stats stats;
+    extern bool get_match_store_stats(match_store_stats& stats, bool regen);
+    for (int regen = 0; regen < 2; ++regen)
+    {
+        if (!get_match_store_stats(stats, !!regen))
+            break;
+
+        if (!regen)
+        {
+            s.clear();
+            s << bold << "match store:" << norm << lf;
+            g_printer->print(s.c_str(), s.length());
+        }
+
+        printf("  %-*s  %u/%u pages in use (%u bytes), high water %u pages, page size %u\n",
+               spacing, regen ? "regen" : "matches",
+               stats.pages_in_use, stats.pages_retained, stats.bytes_in_use,
+               stats.high_water_pages, stats.page_size);
+        printf("  %-*s  %u resets, %u page allocs, %u shrinks\n",
+               spacing, "", stats.resets, stats.page_allocs, stats.shrinks);
+    }
+
+    // Directory listing cache.
+
+    dir_cache_stats dir_stats;
+    dir_cache::get_stats(dir_stats);
+    if (dir_stats.hits || dir_stats.misses)
+    {
+        s.clear();
+        s << bold << "dir cache:" << norm << lf;
+        g_printer->print(s.c_str(), s.length());
+
+        printf("  %-*s  %u\n", spacing, "dirs", dir_stats.dirs);
+        printf("  %-*s  %u hits, %u misses, %u invalidations, %u evictions\n",
+               spacing, "lookups", dir_stats.hits, dir_stats.misses,
+               dir_stats.invalidations, dir_stats.evictions);
+    }
+
+    // Input latency histograms.
+
+    bool latency_header = false;
+    for (unsigned int phase = 0; phase < (unsigned int)(latency_phase::max); ++phase)
+    {
+        latency_histogram h;
+        if (!latency::get_histogram(latency_phase(phase), h) || !h.count)
+            continue;
+
+        if (!latency_header)
+        {
+            s.clear();
+            s << bold << "latency:" << norm << lf;
+            g_printer->print(s.c_str(), s.length());
+            latency_header = true;
+        }
+
+        printf("  %-*s  %u spans, avg %.2f ms, max %.2f ms\n",
+               spacing, latency::get_phase_name(latency_phase(phase)), h.count,
+               double(h.total_us) / h.count / 1000, double(h.max_us) / 1000);
+
+        s.clear();
+        for (unsigned int bucket = 0; bucket < latency_histogram::num_buckets; ++bucket)
+        {
+            if (!h.buckets[bucket])
+                continue;
+            const unsigned int limit = latency::get_bucket_limit(bucket);
+            str<32> tmp;
+            if (limit)
+                tmp.format("%s<%uus %u", s.empty() ? "" : ", ", limit, h.buckets[bucket]);
+            else
+                tmp.format("%s>=%uus %u", s.empty() ? "" : ", ", latency::get_bucket_limit(bucket - 1), h.buckets[bucket]);
+            s.concat(tmp.c_str(), tmp.length());
+        }
+        printf("  %-*s  %s\n", spacing, "", s.c_str());
+    }
+
     host_call_lua_rl_global_function("clink._diagnostics");
 
     puts("");
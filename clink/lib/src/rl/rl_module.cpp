@@ -14,6 +14,7 @@
 #include "terminal_helpers.h"
 
 #include <core/base.h>
+#include <core/latency.h>
 #include <core/os.h>
 #include <core/path.h>
 #include <core/str_compare.h>
@@ -283,6 +284,14 @@ setting_bool g_prompt_async(
     "Enables asynchronous prompt refresh",
     true);
 
+static setting_int g_prompt_async_concurrency(
+    "prompt.async_concurrency",
+    "Max concurrent io.popenyield commands",
+    "Limits how many commands started by io.popenyield() can run at the same time\n"
+    "during asynchronous prompt refresh.  Commands beyond the limit wait until an\n"
+    "earlier one finishes.  Set to 1 to run them one at a time.",
+    4);
+
 static setting_bool g_rl_hide_stderr(
     "readline.hide_stderr",
     "Suppress stderr from the Readline library",
@@ -1109,6 +1118,12 @@ static int compare_lcd(const char* a, const char* b)
     return str_compare<char, true/*compute_lcd*/>(a, b);
 }
 
+//------------------------------------------------------------------------------
+static int compute_lcd(char** matches, int count, int skip)
+{
+    return str_compute_lcd<char>(matches, count, skip);
+}
+
 //------------------------------------------------------------------------------
 // If the input text starts with a slash and doesn't have any other slashes or
 // path separators, then preserve the original slash in the lcd.  Otherwise it
@@ -1643,6 +1658,16 @@ enum {
 
 
 
+//------------------------------------------------------------------------------
+static long long s_redisplay_started = 0;
+static void redisplay_timing_hook(int begin)
+{
+    if (begin)
+        s_redisplay_started = latency_span::start();
+    else
+        latency_span::stop(latency_phase::redisplay, s_redisplay_started);
+}
+
 //------------------------------------------------------------------------------
 static int terminal_read_thunk(FILE* stream)
 {
@@ -1761,6 +1786,7 @@ rl_module::rl_module(const char* shell_name, terminal_in* input)
     s_direct_input = input;
 
     rl_getc_function = terminal_read_thunk;
+    rl_redisplay_timing_hook = redisplay_timing_hook;
     rl_fwrite_function = terminal_write_thunk;
 #ifdef CAN_LOG_RL_TERMINAL
     if (g_debug_log_terminal.get())
@@ -1805,6 +1831,7 @@ rl_module::rl_module(const char* shell_name, terminal_in* input)
     rl_match_display_filter_func = match_display_filter_callback;
     rl_is_exec_func = is_exec_ext;
     rl_compare_lcd_func = compare_lcd;
+    rl_compute_lcd_func = compute_lcd;
     rl_postprocess_lcd_func = postprocess_lcd;
     rl_read_key_hook = read_key_hook;
     rl_get_face_func = get_face_func;
@@ -2048,6 +2075,69 @@ bool rl_module::is_input_pending()
             rl_executing_macro);
 }
 
+//------------------------------------------------------------------------------
+// Returns true if Readline would simply insert c when it's typed, in which case
+// insert_text() may be used instead.
+bool rl_module::is_self_insert(unsigned char c) const
+{
+    if (c < 0x20 || c == 0x7f)
+        return false;
+
+    if (m_done ||
+        (rl_readline_state & RL_MORE_INPUT_STATES) ||
+        rl_editing_mode != emacs_mode ||
+        rl_insert_mode != RL_IM_INSERT ||
+        rl_explicit_arg ||
+        rl_is_insert_next_callback_pending() ||
+        win_fn_callback_pending())
+        return false;
+
+    return (_rl_keymap[c].type == ISFUNC && _rl_keymap[c].function == rl_insert);
+}
+
+//------------------------------------------------------------------------------
+// Inserts a run of typed text all at once, with the same effect as Readline
+// inserting it one character at a time, except that it redisplays only once.
+void rl_module::insert_text(const char* text, int len)
+{
+    reset_scroll_mode();
+    reset_command_states();
+
+    // A trailing incomplete UTF8 sequence goes through rl_insert(), which holds
+    // onto the bytes until the rest of the sequence arrives.
+    int complete = len;
+    int lead = len;
+    while (lead > 0 && len - lead < 4 && (text[lead - 1] & 0xc0) == 0x80)
+        --lead;
+    if (lead > 0)
+    {
+        const unsigned char c = text[lead - 1];
+        const int need = (c >= 0xf0) ? 4 : (c >= 0xe0) ? 3 : (c >= 0xc0) ? 2 : 1;
+        if (lead - 1 + need > len)
+            complete = lead - 1;
+    }
+
+    if (complete > 0)
+    {
+        str<> tmp;
+        tmp.concat(text, complete);
+
+        if (rl_selection_event_hook)
+            rl_selection_event_hook(SEL_BEFORE_INSERTCHAR);
+        rl_insert_text(tmp.c_str());
+        if (rl_selection_event_hook)
+            rl_selection_event_hook(SEL_AFTER_INSERTCHAR);
+    }
+
+    for (int i = complete; i < len; ++i)
+        rl_insert(1, (unsigned char)text[i]);
+
+    rl_last_func = rl_insert;
+
+    if (rl_mark_active_p())
+        rl_deactivate_mark();
+}
+
 //------------------------------------------------------------------------------
 bool rl_module::next_line(str_base& out)
 {
@@ -2241,6 +2331,8 @@ void rl_module::on_input(const input& input, result& result, const context& cont
         virtual void end() override     {}
         virtual void select(input_idle*) override {}
         virtual int  read() override    { return *(unsigned char*)(data++); }
+        virtual int  peek() override    { return input_none; }
+        virtual void* get_waitevent() const override { return nullptr; }
         virtual key_tester* set_key_tester(key_tester* keys) override { return nullptr; }
         const char*  data;
     } term_in;
@@ -29,6 +29,8 @@ public:
     void            set_prompt(const char* prompt, const char* rprompt, bool redisplay);
 
     bool            is_input_pending();
+    bool            is_self_insert(unsigned char c) const;
+    void            insert_text(const char* text, int len);
     bool            next_line(str_base& out);
 
 private:
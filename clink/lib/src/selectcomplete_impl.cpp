@@ -136,6 +136,18 @@ int ellipsify(const char* in, int limit, str_base& out, bool expand_ctrl)
 
 
 
+//------------------------------------------------------------------------------
+// For passes that visit every match but don't depend on their order, so a
+// lazily ordered list isn't made to order everything.
+struct any_order_scope
+{
+    any_order_scope(const matches* matches) : m_matches(matches) { if (m_matches) m_matches->set_any_order(true); }
+    ~any_order_scope() { if (m_matches) m_matches->set_any_order(false); }
+    const matches* const m_matches;
+};
+
+
+
 //------------------------------------------------------------------------------
 match_adapter::~match_adapter()
 {
@@ -872,6 +884,8 @@ void selectcomplete_impl::update_matches(bool restrict)
 
     if (restrict)
     {
+        any_order_scope any_order(m_matches.get_matches());
+
         // Update Readline modes based on the available completions.
         {
             matches_iter iter = m_matches.get_iter();
@@ -896,14 +910,14 @@ void selectcomplete_impl::update_matches(bool restrict)
 
             // Build char** array for filtering.
             std::vector<autoptr<char>> matches;
-            const unsigned int count = m_matches.get_match_count();
             matches.emplace_back(nullptr); // Placeholder for lcd.
-            for (unsigned int i = 0; i < count; i++)
+            matches_iter iter = m_matches.get_iter();
+            while (iter.next())
             {
-                const char* text = m_matches.get_match(i);
+                const char* text = iter.get_match();
                 const size_t len = strlen(text);
                 char* match = static_cast<char*>(malloc(1 + len + 1));
-                match[0] = static_cast<char>(m_matches.get_match_type(i));
+                match[0] = static_cast<char>(iter.get_match_type());
                 memcpy(match + 1, text, len + 1);
                 matches.emplace_back(match);
             }
@@ -943,6 +957,7 @@ void selectcomplete_impl::update_matches(bool restrict)
     // Determine the lcd.
     if (restrict)
     {
+        any_order_scope any_order(m_matches.get_matches());
         const unsigned int count = m_matches.get_match_count();
         for (unsigned int i = 0; i < count; i++)
         {
@@ -967,6 +982,8 @@ void selectcomplete_impl::update_matches(bool restrict)
         if (restrict)
             m_match_longest = 0;
 
+        any_order_scope any_order(m_matches.get_matches());
+
         const unsigned int count = m_matches.get_match_count();
         for (unsigned int i = 0; i < count; i++)
         {
@@ -24,6 +24,7 @@ word_classifications::~word_classifications()
 word_classifications::word_classifications(word_classifications&& other)
 {
     m_info = std::move(other.m_info);
+    m_commands = std::move(other.m_commands);
     m_face_definitions = std::move(other.m_face_definitions);
     m_faces = other.m_faces;
     m_length = other.m_length;
@@ -39,6 +40,7 @@ void word_classifications::clear()
     free(m_faces);
 
     m_info.clear();
+    m_commands.clear();
     m_face_definitions.clear();
     m_faces = nullptr;
     m_length = 0;
@@ -88,6 +90,7 @@ unsigned int word_classifications::add_command(const line_state& line)
         info.argmatcher = false;
     }
 
+    m_commands.push_back({ index, static_cast<unsigned int>(words.size()), UINT_MAX, 0 });
     return index;
 }
 
@@ -98,6 +101,18 @@ void word_classifications::set_word_has_argmatcher(unsigned int index)
         m_info[index].argmatcher = true;
 }
 
+//------------------------------------------------------------------------------
+void word_classifications::set_command_extent(unsigned int index, unsigned int start, unsigned int end)
+{
+    if (command_info* command = find_command(index))
+    {
+        if (command->extent_start > start)
+            command->extent_start = start;
+        if (command->extent_end < end)
+            command->extent_end = end;
+    }
+}
+
 //------------------------------------------------------------------------------
 void word_classifications::finish(bool show_argmatchers)
 {
@@ -125,6 +140,43 @@ void word_classifications::finish(bool show_argmatchers)
     }
 }
 
+//------------------------------------------------------------------------------
+bool word_classifications::save_command(unsigned int index, unsigned int start, unsigned int end, command_classification& saved) const
+{
+    // A command that applied faces outside its own text can't be reused,
+    // because the faces it applied there won't be saved with it.
+    const command_info* command = find_command(index);
+    if (!command || end > m_length || start > end)
+        return false;
+    if (command->extent_start <= command->extent_end &&
+        (command->extent_start < start || command->extent_end > end))
+        return false;
+
+    saved.start = start;
+    saved.end = end;
+    saved.info.assign(m_info.begin() + index, m_info.begin() + index + command->num_words);
+    saved.faces.assign(m_faces + start, m_faces + end);
+    return true;
+}
+
+//------------------------------------------------------------------------------
+void word_classifications::restore_command(unsigned int index, const command_classification& saved)
+{
+    const command_info* command = find_command(index);
+    if (!command || command->num_words != saved.info.size())
+    {
+        assert(false);
+        return;
+    }
+
+    for (unsigned int i = 0; i < command->num_words; ++i)
+        m_info[index + i] = saved.info[i];
+
+    const unsigned int end = min<unsigned int>(saved.end, m_length);
+    for (unsigned int pos = saved.start; pos < end; ++pos)
+        m_faces[pos] = saved.faces[pos - saved.start];
+}
+
 //------------------------------------------------------------------------------
 bool word_classifications::equals(const word_classifications& other) const
 {
@@ -217,3 +269,20 @@ bool word_classifications::is_word_classified(unsigned int word_index)
 {
     return (word_index < m_info.size() && m_info[word_index].word_class < word_class::max);
 }
+
+//------------------------------------------------------------------------------
+word_classifications::command_info* word_classifications::find_command(unsigned int index)
+{
+    for (auto& command : m_commands)
+    {
+        if (command.index == index)
+            return &command;
+    }
+    return nullptr;
+}
+
+//------------------------------------------------------------------------------
+const word_classifications::command_info* word_classifications::find_command(unsigned int index) const
+{
+    return const_cast<word_classifications*>(this)->find_command(index);
+}
@@ -78,39 +78,169 @@ char word_collector::get_closing_quote() const
 }
 
 //------------------------------------------------------------------------------
-void word_collector::find_command_bounds(const char* buffer, unsigned int length, unsigned int cursor,
-                                         std::vector<command>& commands, bool stop_at_cursor) const
+void word_collector::update_commands(const char* buffer, unsigned int line_stop) const
 {
-    unsigned int line_stop = stop_at_cursor ? cursor : length;
+    // Cached words depend on argmatcher lookups (deprecated argmatchers don't
+    // split flags), so they're stale once argmatchers change.  For example,
+    // an argmatcher can get loaded on demand partway through editing a line.
+    if (m_command_tokeniser)
+    {
+        const unsigned int generation = m_command_tokeniser->get_argmatcher_generation();
+        if (m_commands_generation != generation)
+        {
+            m_commands.clear();
+            m_commands_text.clear();
+            m_commands_generation = generation;
+        }
+    }
 
-    commands.clear();
+    // Find how much of the text is unchanged since the previous call.
+    const char* prev = m_commands_text.c_str();
+    const unsigned int max_same = min<unsigned int>(line_stop, m_commands_text.length());
+    unsigned int same = 0;
+    while (same < max_same && buffer[same] == prev[same])
+        same++;
+
+    m_commands_text.clear();
+    m_commands_text.concat(buffer, line_stop);
 
     if (m_command_tokeniser == nullptr)
     {
-        commands.push_back({ 0, line_stop });
+        m_commands.clear();
+        m_commands.push_back({ 0, line_stop });
         return;
     }
 
-    m_command_tokeniser->start(str_iter(buffer, line_stop), m_quote_pair);
+    // A command can be reused if the separator that ended it and the char
+    // after that are unchanged; the tokeniser never looks back past a
+    // separator.
+    unsigned int keep = 0;
+    while (keep < m_commands.size() &&
+           m_commands[keep].is_break &&
+           m_commands[keep].offset + m_commands[keep].length + 1 < same)
+        keep++;
+    m_commands.resize(keep);
+
+    // Restart the tokeniser on the separator that ended the last reused
+    // command.  It skips separators before each command, so it resumes exactly
+    // where a full pass would, and doesn't treat the next command as the first.
+    const unsigned int resume = keep ? m_commands[keep - 1].offset + m_commands[keep - 1].length : 0;
+    m_command_tokeniser->start(str_iter(buffer + resume, line_stop - resume), m_quote_pair);
     unsigned int command_start;
     unsigned int command_length;
-    while (m_command_tokeniser->next(command_start, command_length))
+    while (word_token token = m_command_tokeniser->next(command_start, command_length))
     {
-        if (stop_at_cursor)
+        m_commands.push_back({ resume + command_start, command_length });
+        m_commands.back().is_break = (token.delim != 0);
+    }
+}
+
+//------------------------------------------------------------------------------
+void word_collector::collect_command_words(const char* line_buffer, command& command) const
+{
+    std::vector<word>& words = command.words;
+    words.clear();
+
+    bool first = true;
+    unsigned int doskey_len = 0;
+    bool deprecated_argmatcher = false;
+
+    {
+        unsigned int first_word_len = 0;
+        while (first_word_len < command.length &&
+                line_buffer[command.offset + first_word_len] != ' ' &&
+                line_buffer[command.offset + first_word_len] != '\t')
+            first_word_len++;
+
+        if (first_word_len > 0)
         {
-            // Have we found the command containing the cursor?
-            if (cursor >= command_start &&
-                cursor <= command_start + command_length)
+            str<32> lookup;
+            str<32> alias;
+            lookup.concat(line_buffer + command.offset, first_word_len);
+            if (os::get_alias(lookup.c_str(), alias))
             {
-                commands.push_back({ command_start, command_length });
-                return;
+                unsigned char delim = (doskey_len < command.length) ? line_buffer[command.offset + doskey_len] : 0;
+                doskey_len = first_word_len;
+                words.push_back({command.offset, doskey_len, first, true/*is_alias*/, false/*is_redir_arg*/, 0, delim});
+                first = false;
             }
+
+            if (m_command_tokeniser)
+                deprecated_argmatcher = m_command_tokeniser->has_deprecated_argmatcher(lookup.c_str());
         }
-        else
+    }
+
+    m_word_tokeniser->start(str_iter(line_buffer + command.offset + doskey_len, command.length - doskey_len), m_quote_pair);
+    while (1)
+    {
+        unsigned int word_offset = 0;
+        unsigned int word_length = 0;
+        word_token token = m_word_tokeniser->next(word_offset, word_length);
+        if (!token)
+            break;
+
+        word_offset += command.offset + doskey_len;
+        const char* word_start = line_buffer + word_offset;
+
+        // Mercy.  We need to know later on if a flag word ends with = but
+        // that's never part of a word because it's a word delimiter.  We
+        // can't really know what is a flag word without running argmatchers
+        // because the argmatchers define the flag character(s) (and linked
+        // argmatchers can define different flag characters).  But we can't
+        // run argmatchers without having already parsed the words.  The
+        // abstraction between collecting words and running argmatchers
+        // breaks down here.
+        //
+        // Rather that redesign the system or dream up a complex solution,
+        // we'll use a simple(ish) mitigation that works the vast majority
+        // of the time because / and - are the only flag characters in
+        // widespread use.
+        //
+        // If the word starts with / or - the word gets special treatment:
+        //  - When = immediately follows the end of the word, it is added to
+        //    the word.
+        //  - When : is reached, it splits the word.
+        //
+        // But not for deprecated argmatchers:
+        // https://github.com/chrisant996/clink/issues/174
+        // An argmatcher may have used an args function to provide flags
+        // like "-D:Aoption", "-D:Boption", etc, in which case `:` and `=`
+        // should not be word breaks.
+        if (!token.redir_arg &&
+            !deprecated_argmatcher &&
+            word_length > 1 &&
+            strchr("-/", *word_start))
         {
-            commands.push_back({ command_start, command_length });
+            str_iter split_iter(word_start, word_length);
+            while (int c = split_iter.next())
+            {
+                if (c == ':')
+                {
+                    const unsigned int split_len = unsigned(split_iter.get_pointer() - word_start);
+                    words.push_back({word_offset, split_len, first, false/*is_alias*/, false/*is_redir_arg*/, 0, ':'});
+                    word_offset += split_len;
+                    word_length -= split_len;
+                    first = false;
+                    break;
+                }
+                else if (!split_iter.more())
+                {
+                    while (word_offset + word_length < command.offset + command.length &&
+                           line_buffer[word_offset + word_length] == '=')
+                    {
+                        word_length++;
+                    }
+                }
+            }
         }
+
+        // Add the word.
+        words.push_back({word_offset, unsigned(word_length), first, false/*is_alias*/, token.redir_arg, 0, token.delim});
+
+        first = false;
     }
+
+    command.has_words = true;
 }
 
 //------------------------------------------------------------------------------
@@ -119,116 +249,28 @@ unsigned int word_collector::collect_words(const char* line_buffer, unsigned int
 {
     words.clear();
 
-    std::vector<command> commands;
     bool stop_at_cursor = (mode == collect_words_mode::stop_at_cursor ||
                            mode == collect_words_mode::display_filter);
-    find_command_bounds(line_buffer, line_length, line_cursor, commands, stop_at_cursor);
+    update_commands(line_buffer, stop_at_cursor ? line_cursor : line_length);
 
     unsigned int command_offset = 0;
 
-    for (auto& command : commands)
+    for (auto& command : m_commands)
     {
-        bool first = true;
-        unsigned int doskey_len = 0;
-        bool deprecated_argmatcher = false;
+        // Have we found the command containing the cursor?
+        if (stop_at_cursor && (line_cursor < command.offset ||
+                               line_cursor > command.offset + command.length))
+            continue;
 
         if (line_cursor >= command.offset)
             command_offset = command.offset;
 
-        {
-            unsigned int first_word_len = 0;
-            while (first_word_len < command.length &&
-                    line_buffer[command.offset + first_word_len] != ' ' &&
-                    line_buffer[command.offset + first_word_len] != '\t')
-                first_word_len++;
+        if (!command.has_words)
+            collect_command_words(line_buffer, command);
+        words.insert(words.end(), command.words.begin(), command.words.end());
 
-            if (first_word_len > 0)
-            {
-                str<32> lookup;
-                str<32> alias;
-                lookup.concat(line_buffer + command.offset, first_word_len);
-                if (os::get_alias(lookup.c_str(), alias))
-                {
-                    unsigned char delim = (doskey_len < command.length) ? line_buffer[command.offset + doskey_len] : 0;
-                    doskey_len = first_word_len;
-                    words.push_back({command.offset, doskey_len, first, true/*is_alias*/, false/*is_redir_arg*/, 0, delim});
-                    first = false;
-                }
-
-                if (m_command_tokeniser)
-                    deprecated_argmatcher = m_command_tokeniser->has_deprecated_argmatcher(lookup.c_str());
-            }
-        }
-
-        m_word_tokeniser->start(str_iter(line_buffer + command.offset + doskey_len, command.length - doskey_len), m_quote_pair);
-        while (1)
-        {
-            unsigned int word_offset = 0;
-            unsigned int word_length = 0;
-            word_token token = m_word_tokeniser->next(word_offset, word_length);
-            if (!token)
-                break;
-
-            word_offset += command.offset + doskey_len;
-            const char* word_start = line_buffer + word_offset;
-
-            // Mercy.  We need to know later on if a flag word ends with = but
-            // that's never part of a word because it's a word delimiter.  We
-            // can't really know what is a flag word without running argmatchers
-            // because the argmatchers define the flag character(s) (and linked
-            // argmatchers can define different flag characters).  But we can't
-            // run argmatchers without having already parsed the words.  The
-            // abstraction between collecting words and running argmatchers
-            // breaks down here.
-            //
-            // Rather that redesign the system or dream up a complex solution,
-            // we'll use a simple(ish) mitigation that works the vast majority
-            // of the time because / and - are the only flag characters in
-            // widespread use.
-            //
-            // If the word starts with / or - the word gets special treatment:
-            //  - When = immediately follows the end of the word, it is added to
-            //    the word.
-            //  - When : is reached, it splits the word.
-            //
-            // But not for deprecated argmatchers:
-            // https://github.com/chrisant996/clink/issues/174
-            // An argmatcher may have used an args function to provide flags
-            // like "-D:Aoption", "-D:Boption", etc, in which case `:` and `=`
-            // should not be word breaks.
-            if (!token.redir_arg &&
-                !deprecated_argmatcher &&
-                word_length > 1 &&
-                strchr("-/", *word_start))
-            {
-                str_iter split_iter(word_start, word_length);
-                while (int c = split_iter.next())
-                {
-                    if (c == ':')
-                    {
-                        const unsigned int split_len = unsigned(split_iter.get_pointer() - word_start);
-                        words.push_back({word_offset, split_len, first, false/*is_alias*/, false/*is_redir_arg*/, 0, ':'});
-                        word_offset += split_len;
-                        word_length -= split_len;
-                        first = false;
-                        break;
-                    }
-                    else if (!split_iter.more())
-                    {
-                        while (word_offset + word_length < command.offset + command.length &&
-                               line_buffer[word_offset + word_length] == '=')
-                        {
-                            word_length++;
-                        }
-                    }
-                }
-            }
-
-            // Add the word.
-            words.push_back({word_offset, unsigned(word_length), first, false/*is_alias*/, token.redir_arg, 0, token.delim});
-
-            first = false;
-        }
+        if (stop_at_cursor)
+            break;
     }
 
     // Add an empty word if no words, or if stopping at the cursor and it's at
@@ -280,3 +322,10 @@ unsigned int word_collector::collect_words(const line_buffer& buffer, std::vecto
 {
     return collect_words(buffer.get_buffer(), buffer.get_length(), buffer.get_cursor(), words, mode);
 }
+
+//------------------------------------------------------------------------------
+void word_collector::clear_cache()
+{
+    m_commands.clear();
+    m_commands_text.clear();
+}
@@ -0,0 +1,68 @@
+// Copyright (c) 2021 Christopher Antos
+// License: http://opensource.org/licenses/MIT
+
+#include "pch.h"
+#include "matches_impl.h"
+
+#include <core/str.h>
+
+#include <vector>
+
+//------------------------------------------------------------------------------
+TEST_CASE("Bulk match ingestion")
+{
+    matches_impl matches;
+    match_builder builder(matches);
+
+    SECTION("Dedup")
+    {
+        match_desc descs[] = {
+            { "abc", nullptr, nullptr, match_type::word, false },
+            { "def", "DEF", "the def", match_type::word, false },
+            { "abc", nullptr, nullptr, match_type::word, false },
+            { "abc", nullptr, nullptr, match_type::arg, false },
+            { "", nullptr, nullptr, match_type::word, false },
+        };
+
+        REQUIRE(builder.add_matches(descs, sizeof_array(descs)) == 3);
+        REQUIRE(!builder.add_match("def", match_type::word));
+        matches.done_building();
+
+        REQUIRE(matches.get_match_count() == 3);
+
+        unsigned int found = 0;
+        for (unsigned int i = 0; i < matches.get_match_count(); ++i)
+        {
+            if (strcmp(matches.get_match(i), "def") == 0)
+            {
+                REQUIRE(strcmp(matches.get_match_display(i), "DEF") == 0);
+                REQUIRE(strcmp(matches.get_match_description(i), "the def") == 0);
+                ++found;
+            }
+        }
+        REQUIRE(found == 1);
+    }
+
+    SECTION("Many")
+    {
+        const unsigned int count = 20000;
+
+        std::vector<str_moveable> strings;
+        std::vector<match_desc> descs;
+        strings.reserve(count);
+        descs.reserve(count);
+        for (unsigned int i = 0; i < count; ++i)
+        {
+            str<32> tmp;
+            tmp.format("pkg%05u", i);
+            strings.emplace_back(tmp.c_str());
+            descs.push_back({ strings.back().c_str(), nullptr, nullptr, match_type::word, false });
+        }
+
+        REQUIRE(builder.add_matches(descs.data(), count) == count);
+        REQUIRE(builder.add_matches(descs.data(), count) == 0);
+        matches.done_building();
+
+        REQUIRE(matches.get_match_count() == count);
+    }
+}
@@ -0,0 +1,61 @@
+// Copyright (c) 2021 Christopher Antos
+// License: http://opensource.org/licenses/MIT
+
+#include "pch.h"
+#include "line_editor_tester.h"
+
+#include <lib/line_state.h>
+#include <lib/match_generator.h>
+#include <lib/matches.h>
+
+//------------------------------------------------------------------------------
+class paste_generator
+    : public match_generator
+{
+public:
+    virtual bool    generate(const line_state& line, match_builder& builder, bool old_filtering=false) override;
+    virtual void    get_word_break_info(const line_state& line, word_break_info& info) const override { info.clear(); }
+};
+
+//------------------------------------------------------------------------------
+bool paste_generator::generate(const line_state& line, match_builder& builder, bool old_filtering)
+{
+    builder.add_match("abcdef", match_type::word);
+    builder.add_match("abxyz", match_type::word);
+    builder.add_match("other", match_type::word);
+    return true;
+}
+
+
+
+//------------------------------------------------------------------------------
+TEST_CASE("Pasted completion")
+{
+    line_editor_tester tester;
+
+    paste_generator generator;
+    tester.get_editor()->add_generator(generator);
+
+    // Completing in the middle of a pasted batch must use the text pasted
+    // before it, not the line as it was before the batch.
+    SECTION("First word")
+    {
+        tester.set_input("abc" DO_COMPLETE, true/*paste*/);
+        tester.set_expected_output("abcdef ");
+        tester.run();
+    }
+
+    SECTION("Later word")
+    {
+        tester.set_input("other ab" DO_COMPLETE "c" DO_COMPLETE, true/*paste*/);
+        tester.set_expected_output("other abcdef ");
+        tester.run();
+    }
+
+    SECTION("Typed")
+    {
+        tester.set_input("abc" DO_COMPLETE);
+        tester.set_expected_output("abcdef ");
+        tester.run();
+    }
+}
@@ -0,0 +1,143 @@
+// Copyright (c) 2021 Christopher Antos
+// License: http://opensource.org/licenses/MIT
+
+#include "pch.h"
+#include "line_editor_impl.h"
+#include "line_editor_tester.h"
+
+#include <core/settings.h>
+#include <lib/line_state.h>
+#include <lib/match_generator.h>
+#include <lib/matches.h>
+
+//------------------------------------------------------------------------------
+class preload_generator
+    : public match_generator
+{
+public:
+    virtual bool    generate(const line_state& line, match_builder& builder, bool old_filtering=false) override;
+    virtual void    get_word_break_info(const line_state& line, word_break_info& info) const override { info.clear(); }
+    virtual bool    can_preload(const line_state& line) override { return m_can_preload; }
+
+    unsigned int    m_generated = 0;
+    unsigned int    m_word_count = 0;
+    bool            m_can_preload = true;
+};
+
+//------------------------------------------------------------------------------
+bool preload_generator::generate(const line_state& line, match_builder& builder, bool old_filtering)
+{
+    ++m_generated;
+    m_word_count = line.get_word_count();
+    builder.add_match("abc", match_type::word);
+    return true;
+}
+
+//------------------------------------------------------------------------------
+static void type_input(line_editor_impl& editor, test_terminal_in& terminal_in, const char* input)
+{
+    terminal_in.set_input(input);
+    do
+    {
+        REQUIRE(editor.update());
+    }
+    while (terminal_in.has_input());
+}
+
+
+
+//------------------------------------------------------------------------------
+TEST_CASE("Match preload")
+{
+    test_terminal_in terminal_in;
+    test_terminal_out terminal_out;
+    printer printer(terminal_out);
+    printer_context printer_context(&terminal_out, &printer);
+
+    line_editor::desc desc(nullptr, nullptr, nullptr, nullptr);
+    desc.input = &terminal_in;
+    desc.output = &terminal_out;
+    desc.printer = &printer;
+
+    preload_generator generator;
+    line_editor_impl editor(desc);
+    editor.add_generator(generator);
+
+    settings::find("match.preload")->set("true");
+    settings::find("match.preload_delay")->set("0");
+
+    // First update starts the line without reading input.
+    REQUIRE(editor.update());
+    type_input(editor, terminal_in, "cmd ");
+    REQUIRE(generator.m_generated == 0);
+
+    SECTION("Consumed")
+    {
+        editor.select_input(nullptr);
+        REQUIRE(generator.m_generated == 1);
+        REQUIRE(generator.m_word_count == 2);
+
+        // Editing the end word reuses the preloaded matches.
+        type_input(editor, terminal_in, "ab");
+        editor.update_matches();
+        REQUIRE(generator.m_generated == 1);
+
+        // Already preloaded; idle doesn't generate again.
+        editor.select_input(nullptr);
+        REQUIRE(generator.m_generated == 1);
+    }
+
+    SECTION("Line changed")
+    {
+        editor.select_input(nullptr);
+        REQUIRE(generator.m_generated == 1);
+
+        // A different end word discards the preloaded matches.
+        type_input(editor, terminal_in, "xyz ");
+        editor.update_matches();
+        REQUIRE(generator.m_generated == 2);
+        REQUIRE(generator.m_word_count == 3);
+    }
+
+    SECTION("Line changed then idle")
+    {
+        editor.select_input(nullptr);
+        REQUIRE(generator.m_generated == 1);
+
+        // Preloading again after the line changes generates for the new end
+        // word, and completion uses that.
+        type_input(editor, terminal_in, "xyz ");
+        editor.select_input(nullptr);
+        REQUIRE(generator.m_generated == 2);
+        REQUIRE(generator.m_word_count == 3);
+
+        editor.update_matches();
+        REQUIRE(generator.m_generated == 2);
+    }
+
+    SECTION("Generator opts out")
+    {
+        generator.m_can_preload = false;
+        editor.select_input(nullptr);
+        REQUIRE(generator.m_generated == 0);
+
+        editor.update_matches();
+        REQUIRE(generator.m_generated == 1);
+    }
+
+    SECTION("Disabled by default")
+    {
+        settings::find("match.preload")->set();
+        editor.select_input(nullptr);
+        REQUIRE(generator.m_generated == 0);
+
+        editor.update_matches();
+        REQUIRE(generator.m_generated == 1);
+    }
+
+    str<> line;
+    editor.get_line(line);
+
+    settings::find("match.preload_delay")->set();
+    settings::find("match.preload")->set();
+}
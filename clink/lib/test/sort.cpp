@@ -0,0 +1,93 @@
+// Copyright (c) 2021 Christopher Antos
+// License: http://opensource.org/licenses/MIT
+
+#include "pch.h"
+#include "matches_impl.h"
+#include "match_pipeline.h"
+
+#include <core/str.h>
+
+//------------------------------------------------------------------------------
+TEST_CASE("Lazy match ordering")
+{
+    // More than fit in an unsigned short.
+    const unsigned int count = 70000;
+
+    matches_impl matches;
+    match_pipeline pipeline(matches);
+    pipeline.reset();
+
+    {
+        // Add the matches in a scrambled order.
+        match_builder builder(matches);
+        str<32> tmp;
+        for (unsigned int i = 0; i < count; ++i)
+        {
+            tmp.format("match%05u", (i * 7919) % count);
+            REQUIRE(builder.add_match(tmp.c_str(), match_type::word));
+        }
+    }
+    matches.done_building();
+
+    pipeline.select("");
+    REQUIRE(matches.get_match_count() == count);
+
+    pipeline.sort();
+    REQUIRE(matches.get_ordered_count() == 0);
+
+    SECTION("First page")
+    {
+        REQUIRE(strcmp(matches.get_match(0), "match00000") == 0);
+        REQUIRE(strcmp(matches.get_match(1), "match00001") == 0);
+        REQUIRE(matches.get_ordered_count() > 1);
+        REQUIRE(matches.get_ordered_count() < count / 16);
+    }
+
+    SECTION("On demand")
+    {
+        REQUIRE(strcmp(matches.get_match(12345), "match12345") == 0);
+        REQUIRE(strcmp(matches.get_match(count - 1), "match69999") == 0);
+        REQUIRE(strcmp(matches.get_match(100), "match00100") == 0);
+        REQUIRE(strcmp(matches.get_match(12344), "match12344") == 0);
+        REQUIRE(matches.get_ordered_count() < count / 16);
+    }
+
+    SECTION("Any order")
+    {
+        // Visits every match without ordering any of them.
+        matches.set_any_order(true);
+        unsigned long long sum = 0;
+        for (unsigned int i = 0; i < count; ++i)
+            sum += atoi(matches.get_match(i) + 5);
+        REQUIRE(sum == (unsigned long long)count * (count - 1) / 2);
+        REQUIRE(matches.get_ordered_count() == 0);
+        matches.set_any_order(false);
+
+        REQUIRE(strcmp(matches.get_match(54321), "match54321") == 0);
+    }
+
+    SECTION("Scrolling")
+    {
+        str<32> tmp;
+        for (unsigned int i = 0; i < count; ++i)
+        {
+            tmp.format("match%05u", i);
+            REQUIRE(strcmp(matches.get_match(i), tmp.c_str()) == 0);
+        }
+        REQUIRE(matches.get_ordered_count() == count);
+    }
+
+    SECTION("Full iteration")
+    {
+        str<32> tmp;
+        unsigned int i = 0;
+        matches_iter iter = matches.get_iter();
+        while (iter.next())
+        {
+            tmp.format("match%05u", i++);
+            REQUIRE(strcmp(iter.get_match(), tmp.c_str()) == 0);
+        }
+        REQUIRE(i == count);
+        REQUIRE(matches.get_ordered_count() == count);
+    }
+}
@@ -26,5 +26,7 @@ private:
     lua_state&      m_state;
     void*           m_event = 0;
     unsigned        m_iterations = 0;
+    long            m_io_completions = 0;
     bool            m_enabled = true;
+    bool            m_gc_pending = false;
 };
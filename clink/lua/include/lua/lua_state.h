@@ -23,6 +23,18 @@ lua_Number optnumber(lua_State* state, int index, lua_Number default_value, bool
 const char* checkstring(lua_State* state, int index);
 const char* optstring(lua_State* state, int index, const char* default_value);
 
+//------------------------------------------------------------------------------
+struct lua_gc_stats
+{
+    unsigned int    steps = 0;          // Idle collection steps.
+    unsigned int    cycles = 0;         // Cycles finished by idle steps.
+    double          total_time = 0;     // Seconds spent in idle steps.
+    double          max_time = 0;       // Longest idle step, in seconds.
+    unsigned int    peak_kb = 0;
+    unsigned int    baseline_kb = 0;    // Heap size after the last idle cycle.
+    unsigned int    deferred = 0;       // Latency-critical calls that paused the collector.
+};
+
 //------------------------------------------------------------------------------
 class lua_state
 {
@@ -32,10 +44,11 @@ public:
     void            initialise();
     void            shutdown();
     bool            do_string(const char* string, int length=-1);
-    bool            do_file(const char* path);
+    bool            do_file(const char* path, const char* cache_dir=nullptr);
     lua_State*      get_state() const;
 
     static bool     push_named_function(lua_State* L, const char* func_name, str_base* error=nullptr);
+    static int      load_file(lua_State* L, const char* path, const char* cache_dir=nullptr);
 
     static int      pcall(lua_State* L, int nargs, int nresults);
     int             pcall(int nargs, int nresults) { return pcall(m_state, nargs, nresults); }
@@ -47,6 +60,12 @@ public:
 
     void            print_error(const char* error);
 
+    bool            is_gc_pending() const;
+    void            gc_step();
+    void            begin_latency_critical();
+    void            end_latency_critical();
+    const lua_gc_stats& get_gc_stats() const { return m_gc_stats; }
+
 #ifdef DEBUG
     void            dump_stack(int pos);
 #endif
@@ -56,6 +75,11 @@ public:
 private:
     bool            send_event_internal(const char* event_name, const char* event_mechanism, int nargs=0, int nret=0);
     lua_State*      m_state;
+    lua_gc_stats    m_gc_stats;
+    int             m_latency_depth = 0;
+    int             m_saved_gc_pause = 0;
+    int             m_saved_gc_stepmul = 0;
+    bool            m_gc_throttled = false;
 
     static bool     s_in_luafunc;
 };
@@ -77,6 +101,19 @@ private:
     int const m_top;
 };
 
+//------------------------------------------------------------------------------
+// Throttles the Lua collector during a latency-critical call, such as
+// generating matches or classifying words while typing.  The input idle loop
+// catches up on the deferred collection work.
+class gc_latency_scope
+{
+public:
+    gc_latency_scope(lua_state& state) : m_state(state) { m_state.begin_latency_critical(); }
+    ~gc_latency_scope() { m_state.end_latency_critical(); }
+private:
+    lua_state& m_state;
+};
+
 //------------------------------------------------------------------------------
 // Dumps from pos to top of stack (use negative pos for relative position, use
 // positive pos for absolute position, or use 0 for entire stack).
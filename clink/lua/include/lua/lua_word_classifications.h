@@ -21,6 +21,8 @@ public:
     int                     classify_word(lua_State* state);
     int                     apply_color(lua_State* state);
 
+    bool                    classify(unsigned int word_index_zero_based, char wc, bool overwrite);
+
     bool                    get_word_class(int word_index_zero_based, word_class& wc) const;
 
 private:
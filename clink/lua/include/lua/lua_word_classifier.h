@@ -15,7 +15,9 @@ class lua_word_classifier
 {
 public:
                     lua_word_classifier(lua_state& state);
-    virtual void    classify(const std::vector<line_state>& commands, word_classifications& classifications) override;
+    virtual void    classify(const std::vector<line_state>& commands, const std::vector<unsigned int>& word_indices, word_classifications& classifications) override;
+    virtual unsigned int get_generation() override;
+    virtual bool    can_skip_unchanged() override;
 
 private:
     lua_state&      m_state;
@@ -24,6 +24,7 @@ local function make_dummy_builder()
     local dummy = {}
     function dummy:addmatch() end
     function dummy:addmatches() end
+    function dummy:addmatcharrays() end
     function dummy:setappendcharacter() end
     function dummy:setsuppressappend() end
     function dummy:setsuppressquoting() end
@@ -158,8 +159,8 @@ function _argreader:update(word, word_index)
                         if arg._links and arg._links[word] then
                             t = arg_match_type
                         else
-                            local this_info = line_state:getwordinfo(word_index)
-                            local next_info = line_state:getwordinfo(word_index + 1)
+                            local this_info = line_state:getwordview(word_index)
+                            local next_info = line_state:getwordview(word_index + 1)
                             if this_info and next_info and this_info.offset + this_info.length == next_info.offset then
                                 local combined_word = word..line_state:getword(word_index + 1)
                                 for _, i in ipairs(arg) do
@@ -195,7 +196,7 @@ function _argreader:update(word, word_index)
         linked = arg._links[word]
         if linked then
             if is_flag and word:match("[:=]$") and word_index >= 0 then
-                local info = line_state:getwordinfo(word_index)
+                local info = line_state:getwordview(word_index)
                 if info and
                         line_state:getcursor() ~= info.offset + info.length and
                         line_state:getline():sub(info.offset + info.length, info.offset + info.length) == " " then
@@ -285,6 +286,78 @@ end
 
 
 
+--------------------------------------------------------------------------------
+-- The generation changes whenever any argmatcher changes, so that saved word
+-- classifications can tell when they need to be discarded.
+local function argmatchers_changed()
+    if clink._argmatchers_changed then
+        clink._argmatcher_generation = clink._argmatchers_changed()
+    else
+        clink._argmatcher_generation = (clink._argmatcher_generation or 0) + 1
+    end
+end
+
+--------------------------------------------------------------------------------
+-- Returns the native compiled form of the argmatcher (see argmatcher_lua.cpp),
+-- recompiling it if any argmatcher has changed since it was last compiled.
+local function _get_compiled(argmatcher)
+    if not clink._compile_argmatcher then
+        return
+    end
+
+    local generation = clink._argmatcher_generation
+    if not argmatcher._compiled or argmatcher._compiled_generation ~= generation then
+        argmatcher._compiled = clink._compile_argmatcher(argmatcher)
+        argmatcher._compiled_generation = generation
+    end
+    return argmatcher._compiled
+end
+
+--------------------------------------------------------------------------------
+-- Walks the words of the command through the argmatcher, and returns the
+-- matcher and arg index that apply to the end word (plus the compiled
+-- argmatcher, if any).  When word_classifier is provided, the words are
+-- classified along the way and the end word is included.
+local function _parse_words(argmatcher, line_state, extra_words, word_classifier)
+    local compiled = _get_compiled(argmatcher)
+    if compiled then
+        local matcher, arg_index = clink._parse_argmatcher_words(compiled, line_state, extra_words, word_classifier)
+        if matcher then
+            return matcher, arg_index, compiled
+        end
+    end
+
+    local reader = _argreader(argmatcher, line_state)
+    reader._word_classifier = word_classifier
+
+    --[[
+    reader:starttracing(line_state:getword(1))
+    --]]
+
+    -- Consume extra words from expanded doskey alias.
+    if extra_words then
+        for word_index = 2, #extra_words do
+            reader:update(extra_words[word_index], -1)
+        end
+    end
+
+    -- Consume words and use them to move through matchers' arguments.
+    local word_count = line_state:getwordcount()
+    local command_word_index = line_state:getcommandwordindex()
+    local last_word_index = word_classifier and word_count or (word_count - 1)
+    for word_index = command_word_index + 1, last_word_index do
+        local info = line_state:getwordview(word_index)
+        if not info.redir then
+            local word = line_state:getword(word_index)
+            reader:update(word, word_index)
+        end
+    end
+
+    return reader._matcher, reader._arg_index
+end
+
+
+
 --------------------------------------------------------------------------------
 local _argmatcher = {}
 _argmatcher.__index = _argmatcher
@@ -409,6 +482,7 @@ end
 --- -show:  :loop(2)    -- fourth arg loops back to position 2, for one or uno, and so on
 function _argmatcher:loop(index)
     self._loop = index or -1
+    argmatchers_changed()
     return self
 end
 
@@ -510,6 +584,7 @@ function _argmatcher:adddescriptions(...)
             end
         end
     end
+    argmatchers_changed()
     return self
 end
 
@@ -522,6 +597,7 @@ end
 --- completions.
 function _argmatcher:nofiles()
     self._no_file_generation = true
+    argmatchers_changed()
     return self
 end
 
@@ -535,6 +611,7 @@ end
 --- <a href="#classifywords">Coloring The Input Text</a> for more information.
 function _argmatcher:setclassifier(func)
     self._classify_func = func
+    argmatchers_changed()
     return self
 end
 
@@ -634,6 +711,8 @@ end
 
 --------------------------------------------------------------------------------
 function _argmatcher:_add(list, addee, prefixes)
+    argmatchers_changed()
+
     -- If addee is a flag like --foo= and is not linked, then link it to a
     -- default parser so its argument doesn't get confused as an arg for its
     -- parent argmatcher.
@@ -682,34 +761,10 @@ end
 
 --------------------------------------------------------------------------------
 function _argmatcher:_generate(line_state, match_builder, extra_words)
-    local reader = _argreader(self, line_state)
-
-    --[[
-    reader:starttracing(line_state:getword(1))
-    --]]
-
-    -- Consume extra words from expanded doskey alias.
-    if extra_words then
-        for word_index = 2, #extra_words do
-            reader:update(extra_words[word_index], -1)
-        end
-    end
-
-    -- Consume words and use them to move through matchers' arguments.
-    local word_count = line_state:getwordcount()
-    local command_word_index = line_state:getcommandwordindex()
-    for word_index = command_word_index + 1, (word_count - 1) do
-        local info = line_state:getwordinfo(word_index)
-        if not info.redir then
-            local word = line_state:getword(word_index)
-            reader:update(word, word_index)
-        end
-    end
-
     -- There should always be a matcher left on the stack, but the arg_index
     -- could be well out of range.
-    local matcher = reader._matcher
-    local arg_index = reader._arg_index
+    local matcher, arg_index, compiled = _parse_words(self, line_state, extra_words)
+    local word_count = line_state:getwordcount()
     local match_type = ((not matcher._deprecated) and "arg") or nil
 
     local endword
@@ -722,6 +777,11 @@ function _argmatcher:_generate(line_state, match_builder, extra_words)
 
     -- Are we left with a valid argument that can provide matches?
     local add_matches = function(arg, match_type)
+        -- Args that are only strings and links are added natively.
+        if compiled and clink._add_argmatcher_matches(compiled, matcher, arg, match_builder, match_type) then
+            return true
+        end
+
         local descs = matcher._descriptions
         local make_match = function(key)
             if not descs then
@@ -743,12 +803,23 @@ function _argmatcher:_generate(line_state, match_builder, extra_words)
             return m
         end
 
+        -- Collect matches and add them in batches, rather than crossing into
+        -- native code once per match.
+        local pending = {}
+        local flush = function()
+            if #pending > 0 then
+                match_builder:addmatches(pending, match_type)
+                pending = {}
+            end
+        end
+
         for key, _ in pairs(arg._links) do
-            match_builder:addmatch(make_match(key), match_type)
+            table.insert(pending, make_match(key))
         end
 
         for _, i in ipairs(arg) do
             if type(i) == "function" then
+                flush()
                 local j = i(endword, word_count, line_state, match_builder)
                 if type(j) ~= "table" then
                     return j or false
@@ -756,10 +827,11 @@ function _argmatcher:_generate(line_state, match_builder, extra_words)
 
                 match_builder:addmatches(j, match_type)
             else
-                match_builder:addmatch(make_match(i), match_type)
+                table.insert(pending, make_match(i))
             end
         end
 
+        flush()
         return true
     end
 
@@ -968,6 +1040,7 @@ function clink.argmatcher(...)
         end
     end
 
+    argmatchers_changed()
     return matcher
 end
 
@@ -1038,19 +1111,95 @@ end
 
 
 
+--------------------------------------------------------------------------------
+-- Scripts in a "completions" subdirectory of a script directory are loaded on
+-- demand:  "completions\foo.lua" is loaded the first time an argmatcher is
+-- needed for "foo".  The directories are scanned the first time a command is
+-- looked up that has no argmatcher, and again after the script directories
+-- change.
+local _completions_dirs = {}
+local _completions_manifest = nil
+local _completions_loaded = {}
+local _completions_cache_dir = nil
+
+--------------------------------------------------------------------------------
+-- The cache_dir is where compiled completion scripts are cached, the same as
+-- for scripts loaded at startup; nil or "" means not to cache them.
+function clink._add_completions_dir(dir, cache_dir)
+    table.insert(_completions_dirs, dir)
+    _completions_manifest = nil
+    _completions_cache_dir = cache_dir
+end
+
+--------------------------------------------------------------------------------
+local function build_completions_manifest()
+    _completions_manifest = {}
+
+    -- Earlier directories take precedence, the same as for scripts.
+    for _, dir in ipairs(_completions_dirs) do
+        for _, name in ipairs(os.globfiles(path.join(dir, "*.lua"))) do
+            local command = clink.lower(path.getbasename(name))
+            if not _completions_manifest[command] then
+                _completions_manifest[command] = path.join(dir, name)
+            end
+        end
+    end
+end
+
+--------------------------------------------------------------------------------
+local function load_completions(command)
+    if not _completions_dirs[1] then
+        return
+    end
+
+    if not _completions_manifest then
+        build_completions_manifest()
+    end
+
+    -- Each script is attempted only once, even if it fails or doesn't define
+    -- an argmatcher for the command.
+    local file = _completions_manifest[command]
+    if not file or _completions_loaded[file] then
+        return
+    end
+    _completions_loaded[file] = true
+
+    local func, err = clink._loadfile(file, _completions_cache_dir)
+    if func then
+        local ok
+        ok, err = xpcall(func, _error_handler_ret)
+        if ok then
+            return true
+        end
+    end
+
+    print("")
+    print("loading '"..file.."' failed:")
+    print(err)
+end
+
+--------------------------------------------------------------------------------
+local function _lookup_argmatcher(command)
+    local argmatcher = _argmatchers[command]
+    if not argmatcher and load_completions(command) then
+        argmatcher = _argmatchers[command]
+    end
+    return argmatcher
+end
+
 --------------------------------------------------------------------------------
 local function _has_argmatcher(command_word)
     command_word = clink.lower(command_word)
 
     -- Check for an exact match.
-    local argmatcher = _argmatchers[path.getname(command_word)]
+    local argmatcher = _lookup_argmatcher(path.getname(command_word))
     if argmatcher then
         return argmatcher
     end
 
     -- If the extension is in PATHEXT then try stripping the extension.
     if path.isexecext(command_word) then
-        argmatcher = _argmatchers[path.getbasename(command_word)]
+        argmatcher = _lookup_argmatcher(path.getbasename(command_word))
         if argmatcher then
             return argmatcher
         end
@@ -1108,6 +1257,7 @@ end
 clink.argmatcher_generator_priority = 24
 local argmatcher_generator = clink.generator(clink.argmatcher_generator_priority)
 local argmatcher_classifier = clink.classifier(clink.argmatcher_generator_priority)
+argmatcher_classifier.onlychanged = true
 
 --------------------------------------------------------------------------------
 function argmatcher_generator:generate(line_state, match_builder)
@@ -1120,32 +1270,40 @@ function argmatcher_generator:generate(line_state, match_builder)
 end
 
 --------------------------------------------------------------------------------
-function argmatcher_generator:getwordbreakinfo(line_state)
+-- Args provided by functions may be expensive or have side effects, so they
+-- aren't generated speculatively while the input is idle (see match.preload).
+function argmatcher_generator:nopreload(line_state)
     local argmatcher, has_argmatcher, extra_words = _find_argmatcher(line_state)
-    if argmatcher then
-        local reader = _argreader(argmatcher, line_state)
+    if not argmatcher then
+        return false
+    end
 
-        -- Consume extra words from expanded doskey alias.
-        if extra_words then
-            for word_index = 2, #extra_words do
-                reader:update(extra_words[word_index], -1)
-            end
-        end
+    local matcher, arg_index = _parse_words(argmatcher, line_state, extra_words)
+    local arg
+    if matcher._flags and matcher:_is_flag(line_state:getendword()) then
+        arg = matcher._flags._args[1]
+    else
+        arg = matcher._args[arg_index]
+    end
 
-        -- Consume words and use them to move through matchers' arguments.
-        local word_count = line_state:getwordcount()
-        local command_word_index = line_state:getcommandwordindex()
-        for word_index = command_word_index + 1, (word_count - 1) do
-            local info = line_state:getwordinfo(word_index)
-            if not info.redir then
-                local word = line_state:getword(word_index)
-                reader:update(word, word_index)
+    if arg then
+        for _, i in ipairs(arg) do
+            if type(i) == "function" then
+                return true
             end
         end
+    end
+
+    return false
+end
 
+--------------------------------------------------------------------------------
+function argmatcher_generator:getwordbreakinfo(line_state)
+    local argmatcher, has_argmatcher, extra_words = _find_argmatcher(line_state)
+    if argmatcher then
         -- There should always be a matcher left on the stack, but the arg_index
         -- could be well out of range.
-        argmatcher = reader._matcher
+        argmatcher = _parse_words(argmatcher, line_state, extra_words)
         if argmatcher and argmatcher._flags then
             local word = line_state:getendword()
             if argmatcher:_is_flag(word) then
@@ -1187,24 +1345,7 @@ function argmatcher_classifier:classify(commands)
         end
 
         if argmatcher then
-            local reader = _argreader(argmatcher, line_state)
-            reader._word_classifier = word_classifier
-
-            -- Consume extra words from expanded doskey alias.
-            if extra_words then
-                for word_index = 2, #extra_words do
-                    reader:update(extra_words[word_index], -1)
-                end
-            end
-
-            -- Consume words and use them to move through matchers' arguments.
-            for word_index = command_word_index + 1, word_count do
-                local info = line_state:getwordinfo(word_index)
-                if not info.redir then
-                    local word = line_state:getword(word_index)
-                    reader:update(word, word_index)
-                end
-            end
+            _parse_words(argmatcher, line_state, extra_words, word_classifier)
         end
     end
 
@@ -1327,5 +1468,6 @@ function clink.arg.register_parser(cmd, parser)
 
     -- Register the parser.
     _argmatchers[cmd] = parser
+    argmatchers_changed()
     return matcher
 end
@@ -8,6 +8,7 @@
 clink = clink or {}
 local _classifiers = {}
 local _classifiers_unsorted = false
+local _classifiers_onlychanged = nil
 
 --------------------------------------------------------------------------------
 -- This global variable tracks which generator function, if any, stopped the
@@ -34,6 +35,28 @@ local function prepare()
     end
 end
 
+--------------------------------------------------------------------------------
+-- Commands are only skipped while unchanged if every classifier has opted in
+-- by setting its onlychanged field; otherwise each classifier is given every
+-- command.  The field can be set after clink.classifier() returns, so this is
+-- rechecked after each pass.
+local function update_onlychanged()
+    local onlychanged = true
+    for _, classifier in ipairs(_classifiers) do
+        if not classifier.onlychanged then
+            onlychanged = false
+            break
+        end
+    end
+
+    if _classifiers_onlychanged ~= onlychanged then
+        _classifiers_onlychanged = onlychanged
+        if clink._set_classifiers_onlychanged then
+            clink._set_classifiers_onlychanged(onlychanged)
+        end
+    end
+end
+
 --------------------------------------------------------------------------------
 -- Receives a table of line_state_lua/lua_word_classifications pairs.
 function clink._classify(commands)
@@ -55,6 +78,7 @@ function clink._classify(commands)
     prepare()
 
     local ok, ret = xpcall(impl, _error_handler_ret)
+    update_onlychanged()
     if not ok then
         print("")
         print("word classifier failed:")
@@ -81,6 +105,20 @@ function clink.classifier(priority)
     local ret = { _priority = priority }
     table.insert(_classifiers, ret)
 
+    -- Saved word classifications are discarded when the argmatcher generation
+    -- changes; a new classifier needs that too.
+    if clink._argmatchers_changed then
+        clink._argmatcher_generation = clink._argmatchers_changed()
+    else
+        clink._argmatcher_generation = (clink._argmatcher_generation or 0) + 1
+    end
+
+    -- A new classifier hasn't had a chance to opt in yet.
+    _classifiers_onlychanged = false
+    if clink._set_classifiers_onlychanged then
+        clink._set_classifiers_onlychanged(false)
+    end
+
     _classifiers_unsorted = true
     return ret
 end
@@ -125,3 +125,29 @@ function clink.quote_split(str, ql, qr)
     _compat_warning("clink.quote_split() is not supported.")
     return {}
 end
+
+
+
+--------------------------------------------------------------------------------
+function clink._diag_gc()
+    local stats = clink._get_gc_stats()
+
+    local bold = "\x1b[1m"          -- Bold (bright).
+    local norm = "\x1b[m"           -- Normal.
+    local print = clink.print
+
+    clink.print(bold.."lua gc:"..norm)
+    print("  heap", string.format("%u KB (peak %u KB)", stats.heap_kb, stats.peak_kb))
+    if not settings.get("lua.idle_gc") then
+        print("  idle gc", "disabled")
+        return
+    end
+    print("  idle steps", string.format("%u steps, %u cycles", stats.steps, stats.cycles))
+    if stats.steps > 0 then
+        print("  idle pause", string.format("avg %.2f ms, max %.2f ms, total %.2f ms",
+                                           stats.total_time * 1000 / stats.steps,
+                                           stats.max_time * 1000,
+                                           stats.total_time * 1000))
+    end
+    print("  deferred", string.format("%u calls", stats.deferred))
+end
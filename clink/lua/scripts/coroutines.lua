@@ -6,8 +6,7 @@ clink = clink or {}
 local _coroutines = {}
 local _coroutines_created = {}          -- Remembers creation info for each coroutine, for use by clink.addcoroutine.
 local _after_coroutines = {}            -- Funcs to run after a pass resuming coroutines.
-local _coroutines_resumable = false     -- When false, coroutines will no longer run.
-local _coroutine_yieldguard = nil       -- Which coroutine is yielding inside popenyield.
+local _coroutine_yieldguards = {}       -- Which coroutines are yielding inside popenyield.
 local _coroutine_context = nil          -- Context for queuing io.popenyield calls from a same source.
 local _coroutine_canceled = false       -- Becomes true if an orphaned io.popenyield cancels the coroutine.
 local _coroutine_generation = 0         -- ID for current generation of coroutines.
@@ -28,49 +27,85 @@ local print = clink.print
 --
 --  Updated by the coroutine management system:
 --      resumed:        Number of times the coroutine has been resumed.
---      firstclock:     The os.clock() from the beginning of the first resume.
---      throttleclock:  The os.clock() from the end of the most recent yieldguard.
---      lastclock:      The os.clock() from the end of the last resume.
---      infinite:       Use INFINITE wait for this coroutine; it's actively inside popenyield.
---      queued:         Use INFINITE wait for this coroutine; it's queued inside popenyield.
+--      yieldguard:     The yieldguard while it's actively inside popenyield.
+--      queued:         True while it's queued inside popenyield.
+--
+-- When to resume each coroutine is decided by the native scheduler (see
+-- coroutine_scheduler.cpp), which tracks the clocks used for intervals and
+-- throttling.  Coroutines inside popenyield use an INFINITE wait there.
 
 --------------------------------------------------------------------------------
 local function clear_coroutines()
-    local preserve
-    if _coroutine_yieldguard then
-        -- Preserve the active popenyield entry so the system can tell when to
-        -- dequeue the next one.
-        preserve = _coroutines[_coroutine_yieldguard.coroutine]
+    -- Preserve the active popenyield entries so the system can tell when to
+    -- dequeue the next ones.
+    local preserve = {}
+    for t,entry in pairs(_coroutines) do
+        if _coroutine_yieldguards[t] then
+            table.insert(preserve, entry)
+        else
+            clink._unschedule_coroutine(t)
+        end
     end
 
     _coroutines = {}
     _coroutines_created = {}
     _after_coroutines = {}
-    _coroutines_resumable = false
-    -- Don't touch _coroutine_yieldguard; it only gets cleared when the thread finishes.
+    -- Don't touch _coroutine_yieldguards; they only get cleared when the threads finish.
     _coroutine_context = nil
     _coroutine_canceled = false
     _coroutine_generation = _coroutine_generation + 1
 
     _dead = (settings.get("lua.debug") or clink.DEBUG) and {} or nil
 
-    if preserve then
-        _coroutines[preserve.coroutine] = preserve
+    for _,entry in ipairs(preserve) do
+        _coroutines[entry.coroutine] = entry
     end
 end
 clink.onbeginedit(clear_coroutines)
 
 --------------------------------------------------------------------------------
-local function release_coroutine_yieldguard()
-    if _coroutine_yieldguard and _coroutine_yieldguard.yieldguard:ready() then
-        local entry = _coroutines[_coroutine_yieldguard.coroutine]
-        if entry and entry.yieldguard == _coroutine_yieldguard.yieldguard then
-            entry.throttleclock = os.clock()
-            entry.yieldguard = nil
-            _coroutine_yieldguard = nil
-            for _,entry in pairs(_coroutines) do
-                if entry.queued then
-                    entry.queued = nil
+local function get_max_concurrency()
+    local max = settings.get("prompt.async_concurrency")
+    if type(max) ~= "number" or max < 1 then
+        max = 1
+    end
+    return max
+end
+
+--------------------------------------------------------------------------------
+local function count_coroutine_yieldguards()
+    local count = 0
+    for _ in pairs(_coroutine_yieldguards) do
+        count = count + 1
+    end
+    return count
+end
+
+--------------------------------------------------------------------------------
+local function release_coroutine_yieldguards()
+    local released = 0
+    for t,yieldguard in pairs(_coroutine_yieldguards) do
+        if yieldguard:ready() then
+            local entry = _coroutines[t]
+            if entry and entry.yieldguard == yieldguard then
+                clink._set_coroutine_throttle(t)
+                entry.yieldguard = nil
+            end
+            _coroutine_yieldguards[t] = nil
+            clink._set_coroutine_waiting(t, false)
+            released = released + 1
+        end
+    end
+
+    -- Dequeue as many as were released; each rechecks the concurrency limit
+    -- when it resumes.
+    if released > 0 then
+        for _,entry in pairs(_coroutines) do
+            if entry.queued then
+                entry.queued = nil
+                clink._set_coroutine_waiting(entry.coroutine, false)
+                released = released - 1
+                if released <= 0 then
                     break
                 end
             end
@@ -90,9 +125,10 @@ end
 local function set_coroutine_yieldguard(yieldguard)
     local t = coroutine.running()
     if yieldguard then
-        _coroutine_yieldguard = { coroutine=t, yieldguard=yieldguard }
+        _coroutine_yieldguards[t] = yieldguard
+        clink._set_coroutine_waiting(t, true)
     else
-        release_coroutine_yieldguard()
+        release_coroutine_yieldguards()
     end
     if t and _coroutines[t] then
         _coroutines[t].yieldguard = yieldguard
@@ -104,6 +140,7 @@ local function set_coroutine_queued(queued)
     local t = coroutine.running()
     if t and _coroutines[t] then
         _coroutines[t].queued = queued and true or nil
+        clink._set_coroutine_waiting(t, queued)
     end
 end
 
@@ -113,30 +150,6 @@ local function cancel_coroutine(message)
     error(message.."canceling popenyield; coroutine is orphaned")
 end
 
---------------------------------------------------------------------------------
-local function next_entry_target(entry, now)
-    if not entry.lastclock then
-        return 0
-    else
-        -- Multiple kinds of throttling for coroutines that want to run more
-        -- frequently than every 5 seconds:
-        --  1.  Throttle if running for 5 or more seconds, but reset the elapsed
-        --      timer every time io.popenyield() finishes.
-        --  2.  Throttle if running for more than 30 seconds total.
-        -- Throttled coroutines can only run once every 5 seconds.
-        local interval = entry.interval
-        local throttleclock = entry.throttleclock or entry.firstclock
-        if now and interval < 5 then
-            if throttleclock and now - throttleclock > 5 then
-                interval = 5
-            elseif entry.firstclock and now - entry.firstclock > 30 then
-                interval = 5
-            end
-        end
-        return entry.lastclock + interval
-    end
-end
-
 --------------------------------------------------------------------------------
 function clink._after_coroutines(func)
     if type(func) ~= "function" then
@@ -147,27 +160,13 @@ end
 
 --------------------------------------------------------------------------------
 function clink._has_coroutines()
-    return _coroutines_resumable
+    return clink._has_scheduled_coroutines()
 end
 
 --------------------------------------------------------------------------------
 function clink._wait_duration()
-    if _coroutines_resumable then
-        local target
-        local now = os.clock()
-        release_coroutine_yieldguard()  -- Dequeue next if necessary.
-        for _,entry in pairs(_coroutines) do
-            local this_target = next_entry_target(entry, now)
-            if entry.yieldguard or entry.queued then
-                -- Yield until output is ready; don't influence the timeout.
-            elseif not target or target > this_target then
-                target = this_target
-            end
-        end
-        if target then
-            return target - now
-        end
-    end
+    release_coroutine_yieldguards() -- Dequeue next if necessary.
+    return clink._coroutine_wait_duration()
 end
 
 --------------------------------------------------------------------------------
@@ -178,48 +177,47 @@ end
 
 --------------------------------------------------------------------------------
 function clink._resume_coroutines()
-    if not _coroutines_resumable then
+    if not clink._has_scheduled_coroutines() then
         return
     end
 
-    -- Protected call to resume coroutines.
-    local remove = {}
+    -- Protected call to resume coroutines.  Only the coroutines that are due
+    -- (or whose popenyield finished) are visited.
     local impl = function()
-        for _,entry in pairs(_coroutines) do
-            if coroutine.status(entry.coroutine) == "dead" then
-                table.insert(remove, _)
+        release_coroutine_yieldguards()
+        clink._begin_coroutine_pass()
+        while true do
+            local c = clink._next_due_coroutine()
+            if not c then
+                break
+            end
+            local entry = _coroutines[c]
+            if not entry or coroutine.status(c) == "dead" then
+                clink.removecoroutine(c)
             else
-                _coroutines_resumable = true
-                local now = os.clock()
-                if next_entry_target(entry, now) <= now then
-                    if not entry.firstclock then
-                        entry.firstclock = now
-                    end
-                    entry.resumed = entry.resumed + 1
-                    clink._set_coroutine_context(entry.context)
-                    local ok, ret = coroutine.resume(entry.coroutine, true--[[async]])
-                    if ok then
-                        -- Use live clock so the interval excludes the execution
-                        -- time of the coroutine.
-                        entry.lastclock = os.clock()
+                entry.resumed = entry.resumed + 1
+                clink._set_coroutine_context(entry.context)
+                local ok, ret = coroutine.resume(c, true--[[async]])
+                if ok then
+                    -- Reschedule relative to the live clock so the interval
+                    -- excludes the execution time of the coroutine.
+                    clink._coroutine_resumed(c)
+                else
+                    if _coroutine_canceled then
+                        entry.canceled = true
                     else
-                        if _coroutine_canceled then
-                            entry.canceled = true
-                        else
-                            print("")
-                            print("coroutine failed:")
-                            print(ret)
-                            entry.error = ret
-                        end
-                        table.insert(remove, _)
+                        print("")
+                        print("coroutine failed:")
+                        print(ret)
+                        entry.error = ret
                     end
+                    clink.removecoroutine(c)
                 end
             end
         end
     end
 
     -- Prepare.
-    _coroutines_resumable = false
     clink._set_coroutine_context(nil)
 
     -- Protected call.
@@ -233,9 +231,6 @@ function clink._resume_coroutines()
 
     -- Cleanup.
     clink._set_coroutine_context(nil)
-    for _,c in ipairs(remove) do
-        clink.removecoroutine(c)
-    end
     for _,func in pairs(_after_coroutines) do
         func()
     end
@@ -330,15 +325,15 @@ function clink._diag_coroutines()
     end
 
     -- Only list coroutines if there are any, or if there's unfinished state.
-    if table_has_elements(threads) or _coroutines_resumable or _coroutine_yieldguard then
+    if table_has_elements(threads) or clink._has_coroutines() or table_has_elements(_coroutine_yieldguards) then
         clink.print(bold.."coroutines:"..norm)
         if show_gen then
             print("  generation", (mixed_gen and yellow or norm).."gen ".._coroutine_generation..norm)
         end
-        print("  resumable", _coroutines_resumable)
+        print("  resumable", clink._has_coroutines())
         print("  wait_duration", clink._wait_duration())
-        if _coroutine_yieldguard then
-            local yg = _coroutine_yieldguard.yieldguard
+        print("  concurrency", count_coroutine_yieldguards().." of "..get_max_concurrency())
+        for _,yg in pairs(_coroutine_yieldguards) do
             print("  yieldguard", (yg:ready() and green.."ready"..norm or yellow.."yield"..norm))
             print("  yieldcommand", '"'..yg:command()..'"')
         end
@@ -371,22 +366,18 @@ function clink.addcoroutine(coroutine, interval)
         src=created_info.src
     }
     _coroutines_created[coroutine] = nil
-    _coroutines_resumable = true
+    clink._schedule_coroutine(coroutine, interval or 0)
 end
 
 --------------------------------------------------------------------------------
 function clink.removecoroutine(coroutine)
     if type(coroutine) == "thread" then
-        release_coroutine_yieldguard()
+        release_coroutine_yieldguards()
         if _dead then
             table.insert(_dead, _coroutines[coroutine])
         end
         _coroutines[coroutine] = nil
-        _coroutines_resumable = false
-        for _ in pairs(_coroutines) do
-            _coroutines_resumable = true
-            break
-        end
+        clink._unschedule_coroutine(coroutine)
     elseif coroutine ~= nil then
         error("bad argument #1 (coroutine expected)")
     end
@@ -405,7 +396,9 @@ end
 ---
 --- Runs <span class="arg">command</span> and returns a read file handle for
 --- reading output from the command.  It yields until the command has finished
---- and the complete output is ready to be read without blocking.
+--- and the complete output is ready to be read without blocking.  Commands
+--- from different coroutines run concurrently, up to the limit set by the
+--- <code>prompt.async_concurrency</code> setting.
 ---
 --- The <span class="arg">mode</span> can contain "r" (read mode) and/or either
 --- "t" for text mode (the default if omitted) or "b" for binary mode.  Write
@@ -429,12 +422,13 @@ end
 function io.popenyield(command, mode)
     -- This outer wrapper is implemented in Lua so that it can yield.
     if settings.get("prompt.async") and not clink.istransientpromptfilter() then
-        -- Yield to ensure only one popenyield active at a time.
-        if _coroutine_yieldguard then
-            set_coroutine_queued(true)
-            while _coroutine_yieldguard do
+        -- Yield to ensure no more than prompt.async_concurrency popenyield
+        -- commands are active at a time.
+        if count_coroutine_yieldguards() >= get_max_concurrency() then
+            repeat
+                set_coroutine_queued(true)
                 coroutine.yield()
-            end
+            until count_coroutine_yieldguards() < get_max_concurrency()
             set_coroutine_queued(false)
         end
         -- Cancel if not from the current prompt filter generation.
@@ -457,6 +451,95 @@ function io.popenyield(command, mode)
     end
 end
 
+--------------------------------------------------------------------------------
+local _globiter_meta = {}
+_globiter_meta.__index = _globiter_meta
+
+function _globiter_meta:next()
+    local iter = self._iter
+    if not iter then
+        return
+    end
+
+    -- Give other coroutines (and input) a turn every so often while
+    -- enumerating large directories.
+    if self._yieldevery > 0 then
+        self._countdown = self._countdown - 1
+        if self._countdown <= 0 then
+            self._countdown = self._yieldevery
+            local t = coroutine.running()
+            if t and _coroutines[t] then
+                coroutine.yield()
+            end
+        end
+    end
+
+    local entry = iter:next()
+    if entry == nil then
+        self._iter = nil
+    end
+    return entry
+end
+
+function _globiter_meta:close()
+    if self._iter then
+        self._iter:close()
+        self._iter = nil
+    end
+end
+
+_globiter_meta.__call = _globiter_meta.next
+
+--------------------------------------------------------------------------------
+--- -name:  os.globiter
+--- -ver:   1.2.46
+--- -arg:   globpattern:string
+--- -arg:   [flags:table]
+--- -ret:   iterator
+--- Returns an iterator that enumerates files and/or directories matching
+--- <span class="arg">globpattern</span> one at a time, instead of collecting
+--- them all into a table first like
+--- <a href="#os.globfiles">os.globfiles()</a> does.  This keeps memory low for
+--- large directories, and stopping early avoids reading the rest of the
+--- directory.
+---
+--- The optional <span class="arg">flags</span> table can contain:
+--- -show:  -- flags.dirsonly     [boolean] Only directories, like os.globdirs().
+--- -show:  -- flags.extrainfo    [integer|boolean] Same as for os.globfiles().
+--- -show:  -- flags.yieldevery   [integer] Yield after this many entries (default 100, 0 to never yield).
+---
+--- When called from a coroutine that was added by
+--- <a href="#clink.addcoroutine">clink.addcoroutine()</a> (such as inside a
+--- <a href="#clink.promptcoroutine">clink.promptcoroutine()</a> function), the
+--- iterator yields periodically so that enumerating a large directory doesn't
+--- starve other coroutines or delay input.
+---
+--- The iterator can be used in a <code>for</code> loop.  It also has a
+--- <code>close()</code> method, which releases the directory handle
+--- immediately when stopping early; otherwise it's released when the
+--- enumeration finishes or when the iterator is garbage collected.
+--- -show:  local iter = os.globiter("*.txt", { extrainfo=true })
+--- -show:  for entry in iter do
+--- -show:  &nbsp;   if not do_things_with(entry.name, entry.type) then
+--- -show:  &nbsp;       break
+--- -show:  &nbsp;   end
+--- -show:  end
+--- -show:  iter:close()
+---
+--- Note: any quotation marks (<code>"</code>) in
+--- <span class="arg">globpattern</span> are stripped.
+function os.globiter(pattern, flags)
+    if flags ~= nil and type(flags) ~= "table" then
+        error("bad argument #2 (table expected)")
+    end
+    flags = flags or {}
+
+    local yieldevery = math.max(math.floor(tonumber(flags.yieldevery) or 100), 0)
+
+    local iter = os.globiter_internal(pattern, flags.dirsonly, flags.extrainfo)
+    return setmetatable({ _iter=iter, _yieldevery=yieldevery, _countdown=yieldevery }, _globiter_meta)
+end
+
 --------------------------------------------------------------------------------
 local override_coroutine_src_func = nil
 function coroutine.override_src(func)
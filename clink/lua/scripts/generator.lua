@@ -44,6 +44,179 @@ end
 clink.onbeginedit(generator_onbeginedit)
 
 
+--------------------------------------------------------------------------------
+-- Bounded LRU cache of match sets produced by generators that opt in by
+-- setting a `cache` field (see clink.generator).  Entries survive across edit
+-- lines, and a hit skips running the generator entirely.
+local _cache = {}
+local _cache_count = 0
+local _cache_capacity = 64
+local _cache_tick = 0
+local _cache_stats = { hits=0, misses=0, expired=0, evicted=0 }
+local _next_generator_id = 1
+
+--------------------------------------------------------------------------------
+local function make_cache_key(generator, line_state)
+    local cache = generator.cache
+    if type(cache) ~= "table" then
+        return
+    end
+
+    -- The end word itself is not part of the key, since filtering the matches
+    -- against the typed text happens after generating.
+    local line = line_state:getline()
+    local command_offset = line_state:getcommandoffset()
+    local endword = line_state:getwordinfo(line_state:getwordcount())
+    local key = { generator._id, line:sub(command_offset, endword.offset - 1), os.getcwd() or "" }
+
+    if cache.envvars then
+        for _,name in ipairs(cache.envvars) do
+            table.insert(key, name.."="..(os.getenv(name) or ""))
+        end
+    end
+
+    if generator.cachetoken then
+        local token = generator:cachetoken(line_state)
+        if token == nil then
+            return
+        end
+        table.insert(key, tostring(token))
+    end
+
+    return table.concat(key, "\0")
+end
+
+--------------------------------------------------------------------------------
+local function cache_lookup(key)
+    local entry = _cache[key]
+    if entry and entry.expires and entry.expires <= os.clock() then
+        _cache[key] = nil
+        _cache_count = _cache_count - 1
+        _cache_stats.expired = _cache_stats.expired + 1
+        entry = nil
+    end
+
+    if entry then
+        _cache_tick = _cache_tick + 1
+        entry.tick = _cache_tick
+        _cache_stats.hits = _cache_stats.hits + 1
+    else
+        _cache_stats.misses = _cache_stats.misses + 1
+    end
+
+    return entry
+end
+
+--------------------------------------------------------------------------------
+local function cache_store(key, generator, calls, ret)
+    if not _cache[key] then
+        if _cache_count >= _cache_capacity then
+            local oldest_key, oldest_tick
+            for k,e in pairs(_cache) do
+                if not oldest_tick or e.tick < oldest_tick then
+                    oldest_key, oldest_tick = k, e.tick
+                end
+            end
+            _cache[oldest_key] = nil
+            _cache_count = _cache_count - 1
+            _cache_stats.evicted = _cache_stats.evicted + 1
+        end
+        _cache_count = _cache_count + 1
+    end
+
+    local ttl = tonumber(generator.cache.ttl)
+    _cache_tick = _cache_tick + 1
+    _cache[key] = {
+        calls=calls,
+        ret=ret,
+        tick=_cache_tick,
+        expires=(ttl and ttl > 0) and (os.clock() + ttl) or nil,
+    }
+end
+
+--------------------------------------------------------------------------------
+local function copy_arg(arg)
+    if type(arg) == "table" then
+        local t = {}
+        for k,v in pairs(arg) do
+            t[k] = copy_arg(v)
+        end
+        return t
+    end
+    return arg
+end
+
+--------------------------------------------------------------------------------
+local _recorded_methods = {
+    "addmatch", "addmatches", "addmatcharrays", "setappendcharacter",
+    "setsuppressappend", "setsuppressquoting", "deprecated_addmatch",
+    "setmatchesarefiles",
+}
+
+--------------------------------------------------------------------------------
+-- Returns a proxy for match_builder that forwards calls and records them, so
+-- they can be replayed from the cache later.
+local function make_recording_builder(match_builder, calls)
+    local recorder = {}
+    for _,name in ipairs(_recorded_methods) do
+        recorder[name] = function(self, ...)
+            table.insert(calls, { name, copy_arg(table.pack(...)) })
+            return match_builder[name](match_builder, ...)
+        end
+    end
+    return recorder
+end
+
+--------------------------------------------------------------------------------
+local function replay_calls(match_builder, calls)
+    for _,call in ipairs(calls) do
+        local args = call[2]
+        match_builder[call[1]](match_builder, table.unpack(args, 1, args.n))
+    end
+end
+
+--------------------------------------------------------------------------------
+local function run_generator(generator, line_state, match_builder)
+    local key = make_cache_key(generator, line_state)
+    if not key then
+        return generator:generate(line_state, match_builder)
+    end
+
+    local entry = cache_lookup(key)
+    if entry then
+        replay_calls(match_builder, entry.calls)
+        return entry.ret
+    end
+
+    local calls = {}
+    local recorder = make_recording_builder(match_builder, calls)
+    _current_builder = recorder
+    local ret = generator:generate(line_state, recorder)
+    _current_builder = match_builder
+    cache_store(key, generator, calls, ret)
+    return ret
+end
+
+--------------------------------------------------------------------------------
+function clink._diag_generator_cache()
+    if _cache_stats.hits + _cache_stats.misses == 0 then
+        return
+    end
+
+    local bold = "\x1b[1m"          -- Bold (bright).
+    local norm = "\x1b[m"           -- Normal.
+    local print = clink.print
+
+    clink.print(bold.."generator cache:"..norm)
+    print("  entries", _cache_count.."/".._cache_capacity)
+    print("  hits", _cache_stats.hits)
+    print("  misses", _cache_stats.misses)
+    print("  expired", _cache_stats.expired)
+    print("  evicted", _cache_stats.evicted)
+end
+
+
+
 --------------------------------------------------------------------------------
 local function prepare()
     -- Sort generators by priority if required.
@@ -68,7 +241,7 @@ function clink._generate(line_state, match_builder, old_filtering)
         clink.generator_stopped = nil
 
         for _, generator in ipairs(_generators) do
-            local ret = generator:generate(line_state, match_builder)
+            local ret = run_generator(generator, line_state, match_builder)
             if ret == true then
                 -- Remember the generator function that stopped.
                 clink.generator_stopped = generator.generate
@@ -100,6 +273,32 @@ function clink._generate(line_state, match_builder, old_filtering)
     return ret or false
 end
 
+--------------------------------------------------------------------------------
+-- Returns whether matches may be generated speculatively for line_state while
+-- the input is idle (see match.preload).  A generator opts out by setting a
+-- nopreload field to true, or to a function that receives line_state.
+function clink._can_preload(line_state)
+    local impl = function ()
+        for _, generator in ipairs(_generators) do
+            local nopreload = generator.nopreload
+            if type(nopreload) == "function" then
+                nopreload = nopreload(generator, line_state)
+            end
+            if nopreload then
+                return false
+            end
+        end
+
+        return true
+    end
+
+    prepare()
+
+    -- Errors are reported when generating for real; just don't preload.
+    local ok, ret = xpcall(impl, _error_handler_ret)
+    return ok and ret or false
+end
+
 --------------------------------------------------------------------------------
 function clink._get_word_break_info(line_state)
     local impl = function ()
@@ -143,10 +342,33 @@ end
 --- <span class="arg">priority</span> order (low values to high values) when
 --- generating matches for completion.  See
 --- <a href="#matchgenerators">Match Generators</a> for more information.
+---
+--- A generator whose matches depend only on the text before the end word, the
+--- current directory, and optionally some environment variables can opt into
+--- caching by setting a <code>cache</code> table field.  Cached matches are
+--- reused across input lines, and the generator is not called again until the
+--- cache entry expires.  The <code>cache</code> table may contain
+--- <code>ttl</code> (seconds until the entry expires; omit for no expiry) and
+--- <code>envvars</code> (a table of environment variable names that are part of
+--- the cache key).  The generator may also define a
+--- <code>:cachetoken(line_state)</code> function that returns a value which is
+--- added to the cache key, or nil to bypass the cache.
+---
+--- When the <code>match.preload</code> setting is enabled, generators may also
+--- run while the input is idle, before completion is requested.  A generator
+--- that is expensive or has side effects should set a <code>nopreload</code>
+--- field to true, or to a function that receives <span class="arg">line_state</span>
+--- and returns true when the generator shouldn't run speculatively.
+--- -show:  local g = clink.generator(20)
+--- -show:  g.cache = { ttl=60, envvars={ "PATH" } }
+--- -show:  function g:generate(line_state, match_builder)
+--- -show:  &nbsp; -- ...
+--- -show:  end
 function clink.generator(priority)
     if priority == nil then priority = 999 end
 
-    local ret = { _priority = priority }
+    local ret = { _priority = priority, _id = _next_generator_id }
+    _next_generator_id = _next_generator_id + 1
     table.insert(_generators, ret)
 
     _generators_unsorted = true
@@ -265,14 +487,18 @@ end
 
 --------------------------------------------------------------------------------
 --- -name:  clink.compute_lcd
---- -deprecated:
+--- -deprecated: string.commonprefix
 --- -arg:   text:string
 --- -arg:   matches:table
 --- -ret:   string
---- This is no longer supported, and always returns an empty string.
-function clink.compute_lcd()
-    _compat_warning("clink.compute_lcd() is no longer supported.")
-    return ""
+--- Returns the longest common prefix of the matches, or
+--- <span class="arg">text</span> if they have no common prefix.
+function clink.compute_lcd(text, matches)
+    local lcd = string.commonprefix(matches or {}) or ""
+    if lcd == "" then
+        return text or ""
+    end
+    return lcd
 end
 
 --------------------------------------------------------------------------------
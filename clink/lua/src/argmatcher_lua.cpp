@@ -0,0 +1,895 @@
+// Copyright (c) 2021 Christopher Antos
+// License: http://opensource.org/licenses/MIT
+
+#include "pch.h"
+#include "lua_state.h"
+#include "line_state_lua.h"
+#include "match_builder_lua.h"
+#include "lua_word_classifications.h"
+
+#include <core/base.h>
+#include <core/str.h>
+#include <core/str_unordered_set.h>
+#include <lib/line_state.h>
+#include <lib/matches.h>
+
+#include <new>
+#include <unordered_map>
+#include <vector>
+
+extern int get_slash_translation();
+
+//------------------------------------------------------------------------------
+// arguments.lua declares argmatchers as a graph of Lua tables (args, flags,
+// links, loops, descriptions).  Walking that graph in Lua for every word on
+// every generate and classify pass is expensive, so the graph is compiled into
+// flat native tables that the parser below walks instead.  The parser only
+// calls back into Lua for :setclassifier() functions; args that are functions
+// (or other non-string values) are still handled by arguments.lua.
+//
+// The compiled argmatcher keeps references to the Lua tables and strings it
+// was compiled from, so the string pointers it holds stay valid.  arguments.lua
+// recompiles whenever clink._argmatcher_generation changes.
+
+//------------------------------------------------------------------------------
+// The generation is also kept natively, so that the word classifier can check
+// it without entering Lua on every classify pass.
+static unsigned int s_argmatcher_generation = 0;
+
+//------------------------------------------------------------------------------
+unsigned int get_argmatcher_generation()
+{
+    return s_argmatcher_generation;
+}
+
+//------------------------------------------------------------------------------
+// Whether every classifier has set its onlychanged field, so that the word
+// classifier can be given only the commands that changed.  classifier.lua
+// keeps it up to date.
+static bool s_classifiers_only_changed = false;
+
+//------------------------------------------------------------------------------
+bool get_classifiers_only_changed()
+{
+    return s_classifiers_only_changed;
+}
+
+#define LUA_COMPILEDARGMATCHER "clink_compiled_argmatcher"
+
+//------------------------------------------------------------------------------
+typedef std::unordered_map<const char*, int, match_hasher, match_comparator> link_map;
+
+//------------------------------------------------------------------------------
+struct arg_description
+{
+    const char*             display;
+    const char*             description;
+    bool                    append_display;
+};
+typedef std::unordered_map<const char*, arg_description, match_hasher, match_comparator> description_map;
+
+//------------------------------------------------------------------------------
+struct arg_slot
+{
+    std::vector<const char*> strings;
+    str_unordered_set       string_set;
+    link_map                links;
+    bool                    has_other = false;  // Functions, tables, etc.
+};
+
+//------------------------------------------------------------------------------
+struct matcher_node
+{
+    const arg_slot*         get_arg(int arg_index) const;
+    bool                    is_flag(const char* word, int slash_mode) const;
+
+    std::vector<arg_slot>   args;
+    description_map         descriptions;
+    int                     flags = -1;
+    int                     loop = 0;
+    bool                    has_loop = false;
+    bool                    no_files = false;
+    bool                    deprecated = false;
+    bool                    is_flag_matcher = false;
+    bool                    has_classifier = false;
+    bool                    flag_prefix[256] = {};
+};
+
+//------------------------------------------------------------------------------
+const arg_slot* matcher_node::get_arg(int arg_index) const
+{
+    if (arg_index < 1 || arg_index > int(args.size()))
+        return nullptr;
+    return &args[arg_index - 1];
+}
+
+//------------------------------------------------------------------------------
+bool matcher_node::is_flag(const char* word, int slash_mode) const
+{
+    const unsigned char first_char = *word;
+    if (!first_char)
+        return false;
+
+    // When slash translation is set to forward slashes, then disable
+    // recognizing forward slash as a flag character so that path completion
+    // can work.  See https://github.com/chrisant996/clink/issues/114.
+    if (first_char == '/' && slash_mode == 2)
+        return false;
+
+    return flag_prefix[first_char];
+}
+
+
+
+//------------------------------------------------------------------------------
+class compiled_argmatcher
+{
+public:
+    static compiled_argmatcher* make_new(lua_State* state);
+    static compiled_argmatcher* test(lua_State* state, int index);
+
+    bool                    compile(lua_State* state, int root);
+    const matcher_node&     get_node(int index) const { return m_nodes[index]; }
+    bool                    push_node(lua_State* state, int self, int index) const;
+    int                     find_node(const void* table) const;
+    const arg_slot*         find_slot(const void* table) const;
+
+private:
+    int                     compile_node(lua_State* state, int index);
+    void                    compile_slot(lua_State* state, int index, int node_index, int slot_index);
+    void                    compile_descriptions(lua_State* state, int index, int node_index);
+    const char*             anchor_string(lua_State* state, int index);
+    void                    anchor(lua_State* state, int index);
+    static int              __gc(lua_State* state);
+
+    std::vector<matcher_node> m_nodes;
+    std::unordered_map<const void*, int> m_node_map;
+    std::unordered_map<const void*, std::pair<int, int>> m_slot_map;
+    int                     m_nodes_table = 0;      // Stack index while compiling.
+    int                     m_anchors_table = 0;    // Stack index while compiling.
+    int                     m_num_anchors = 0;
+};
+
+//------------------------------------------------------------------------------
+compiled_argmatcher* compiled_argmatcher::make_new(lua_State* state)
+{
+    compiled_argmatcher* self = (compiled_argmatcher*)lua_newuserdata(state, sizeof(compiled_argmatcher));
+    new (self) compiled_argmatcher();
+
+    static const luaL_Reg methods[] =
+    {
+        {"__gc", __gc},
+        {nullptr, nullptr}
+    };
+
+    if (luaL_newmetatable(state, LUA_COMPILEDARGMATCHER))
+        luaL_setfuncs(state, methods, 0);
+    lua_setmetatable(state, -2);
+
+    return self;
+}
+
+//------------------------------------------------------------------------------
+compiled_argmatcher* compiled_argmatcher::test(lua_State* state, int index)
+{
+    return (compiled_argmatcher*)luaL_testudata(state, index, LUA_COMPILEDARGMATCHER);
+}
+
+//------------------------------------------------------------------------------
+int compiled_argmatcher::__gc(lua_State* state)
+{
+    compiled_argmatcher* self = (compiled_argmatcher*)luaL_checkudata(state, 1, LUA_COMPILEDARGMATCHER);
+    self->~compiled_argmatcher();
+    return 0;
+}
+
+//------------------------------------------------------------------------------
+// Expects the userdata on the top of the stack; root is the absolute index of
+// the root matcher table.  Sets the userdata's user value to { nodes, anchors }
+// so that it keeps the compiled tables and strings alive.
+bool compiled_argmatcher::compile(lua_State* state, int root)
+{
+    const int self = lua_gettop(state);
+
+    lua_createtable(state, 2, 0);
+    lua_createtable(state, 8, 0);
+    m_nodes_table = lua_gettop(state);
+    lua_createtable(state, 64, 0);
+    m_anchors_table = lua_gettop(state);
+
+    compile_node(state, root);
+
+    lua_rawseti(state, self + 1, 2);
+    lua_rawseti(state, self + 1, 1);
+    lua_setuservalue(state, self);
+
+    m_nodes_table = 0;
+    m_anchors_table = 0;
+    return true;
+}
+
+//------------------------------------------------------------------------------
+bool compiled_argmatcher::push_node(lua_State* state, int self, int index) const
+{
+    lua_getuservalue(state, self);
+    if (!lua_istable(state, -1))
+    {
+        lua_pop(state, 1);
+        return false;
+    }
+
+    lua_rawgeti(state, -1, 1);
+    lua_rawgeti(state, -1, index + 1);
+    lua_replace(state, -3);
+    lua_pop(state, 1);
+    return true;
+}
+
+//------------------------------------------------------------------------------
+int compiled_argmatcher::find_node(const void* table) const
+{
+    const auto it = m_node_map.find(table);
+    return (it == m_node_map.end()) ? -1 : it->second;
+}
+
+//------------------------------------------------------------------------------
+const arg_slot* compiled_argmatcher::find_slot(const void* table) const
+{
+    const auto it = m_slot_map.find(table);
+    if (it == m_slot_map.end())
+        return nullptr;
+    return &m_nodes[it->second.first].args[it->second.second];
+}
+
+//------------------------------------------------------------------------------
+void compiled_argmatcher::anchor(lua_State* state, int index)
+{
+    lua_pushvalue(state, index);
+    lua_rawseti(state, m_anchors_table, ++m_num_anchors);
+}
+
+//------------------------------------------------------------------------------
+const char* compiled_argmatcher::anchor_string(lua_State* state, int index)
+{
+    anchor(state, index);
+    return lua_tostring(state, index);
+}
+
+//------------------------------------------------------------------------------
+int compiled_argmatcher::compile_node(lua_State* state, int index)
+{
+    const void* table = lua_topointer(state, index);
+    const auto it = m_node_map.find(table);
+    if (it != m_node_map.end())
+        return it->second;
+
+    luaL_checkstack(state, 8, "argmatcher links too deep");
+
+    const int node_index = int(m_nodes.size());
+    m_nodes.emplace_back();
+    m_node_map.emplace(table, node_index);
+
+    lua_pushvalue(state, index);
+    lua_rawseti(state, m_nodes_table, node_index + 1);
+
+    // Fields are read with rawget because matchers have a metatable whose
+    // __index is the _argmatcher class table.
+
+    lua_pushliteral(state, "_args");
+    lua_rawget(state, index);
+    if (lua_istable(state, -1))
+    {
+        const int args = lua_gettop(state);
+        const int num_args = int(lua_rawlen(state, args));
+        m_nodes[node_index].args.resize(num_args);
+        for (int i = 1; i <= num_args; ++i)
+        {
+            lua_rawgeti(state, args, i);
+            if (lua_istable(state, -1))
+                compile_slot(state, lua_gettop(state), node_index, i - 1);
+            lua_pop(state, 1);
+        }
+    }
+    lua_pop(state, 1);
+
+    lua_pushliteral(state, "_flags");
+    lua_rawget(state, index);
+    if (lua_istable(state, -1))
+    {
+        const int flags = compile_node(state, lua_gettop(state));
+        m_nodes[node_index].flags = flags;
+    }
+    lua_pop(state, 1);
+
+    lua_pushliteral(state, "_loop");
+    lua_rawget(state, index);
+    if (lua_toboolean(state, -1))
+    {
+        m_nodes[node_index].has_loop = true;
+        m_nodes[node_index].loop = int(lua_tointeger(state, -1));
+    }
+    lua_pop(state, 1);
+
+    lua_pushliteral(state, "_flagprefix");
+    lua_rawget(state, index);
+    if (lua_istable(state, -1))
+    {
+        lua_pushnil(state);
+        while (lua_next(state, -2))
+        {
+            // Only single character prefixes can ever match the first char.
+            size_t len;
+            if (lua_type(state, -2) == LUA_TSTRING)
+            {
+                const char* prefix = lua_tolstring(state, -2, &len);
+                if (len == 1)
+                    m_nodes[node_index].flag_prefix[(unsigned char)(*prefix)] = (lua_tonumber(state, -1) > 0);
+            }
+            lua_pop(state, 1);
+        }
+    }
+    lua_pop(state, 1);
+
+    lua_pushliteral(state, "_descriptions");
+    lua_rawget(state, index);
+    if (lua_istable(state, -1))
+        compile_descriptions(state, lua_gettop(state), node_index);
+    lua_pop(state, 1);
+
+    struct { const char* name; bool matcher_node::* field; } bools[] =
+    {
+        { "_no_file_generation",    &matcher_node::no_files },
+        { "_deprecated",            &matcher_node::deprecated },
+        { "_is_flag_matcher",       &matcher_node::is_flag_matcher },
+        { "_classify_func",         &matcher_node::has_classifier },
+    };
+
+    for (const auto& b : bools)
+    {
+        lua_pushstring(state, b.name);
+        lua_rawget(state, index);
+        m_nodes[node_index].*b.field = !!lua_toboolean(state, -1);
+        lua_pop(state, 1);
+    }
+
+    return node_index;
+}
+
+//------------------------------------------------------------------------------
+void compiled_argmatcher::compile_slot(lua_State* state, int index, int node_index, int slot_index)
+{
+    anchor(state, index);
+    m_slot_map.emplace(lua_topointer(state, index), std::pair<int, int>(node_index, slot_index));
+
+    const int num = int(lua_rawlen(state, index));
+    for (int i = 1; i <= num; ++i)
+    {
+        lua_rawgeti(state, index, i);
+        if (lua_type(state, -1) == LUA_TSTRING)
+        {
+            const char* s = anchor_string(state, lua_gettop(state));
+            arg_slot& slot = m_nodes[node_index].args[slot_index];
+            slot.strings.push_back(s);
+            slot.string_set.insert(s);
+        }
+        else
+        {
+            m_nodes[node_index].args[slot_index].has_other = true;
+        }
+        lua_pop(state, 1);
+    }
+
+    lua_pushliteral(state, "_links");
+    lua_rawget(state, index);
+    if (lua_istable(state, -1))
+    {
+        const int links = lua_gettop(state);
+        lua_pushnil(state);
+        while (lua_next(state, links))
+        {
+            if (lua_type(state, -2) == LUA_TSTRING && lua_istable(state, -1))
+            {
+                const char* key = anchor_string(state, lua_gettop(state) - 1);
+                const int linked = compile_node(state, lua_gettop(state));
+                m_nodes[node_index].args[slot_index].links.emplace(key, linked);
+            }
+            else
+            {
+                m_nodes[node_index].args[slot_index].has_other = true;
+            }
+            lua_pop(state, 1);
+        }
+    }
+    lua_pop(state, 1);
+}
+
+//------------------------------------------------------------------------------
+void compiled_argmatcher::compile_descriptions(lua_State* state, int index, int node_index)
+{
+    lua_pushnil(state);
+    while (lua_next(state, index))
+    {
+        if (lua_type(state, -2) == LUA_TSTRING)
+        {
+            arg_description desc = {};
+            const int value = lua_gettop(state);
+            if (lua_istable(state, value))
+            {
+                // Same rules as make_match() in arguments.lua.
+                if (lua_rawlen(state, value) > 1)
+                {
+                    lua_rawgeti(state, value, 1);
+                    if (lua_isstring(state, -1))
+                        desc.display = anchor_string(state, lua_gettop(state));
+                    lua_rawgeti(state, value, 2);
+                    if (lua_isstring(state, -1))
+                        desc.description = anchor_string(state, lua_gettop(state));
+                    lua_pop(state, 2);
+                    desc.append_display = true;
+                }
+                else
+                {
+                    lua_rawgeti(state, value, 1);
+                    if (lua_isstring(state, -1))
+                        desc.description = anchor_string(state, lua_gettop(state));
+                    lua_pop(state, 1);
+                }
+            }
+            else if (lua_isstring(state, value))
+            {
+                // anchor_string() may convert a number in place, so copy it.
+                lua_pushvalue(state, value);
+                desc.description = anchor_string(state, lua_gettop(state));
+                lua_pop(state, 1);
+            }
+
+            const char* key = anchor_string(state, value - 1);
+            m_nodes[node_index].descriptions.emplace(key, desc);
+        }
+        lua_pop(state, 1);
+    }
+}
+
+
+
+//------------------------------------------------------------------------------
+// Native port of _argreader in arguments.lua; see there for commentary on the
+// rules.  Word indices are 1-based like in Lua, and negative for extra words
+// from an expanded doskey alias.
+class argmatcher_parser
+{
+public:
+                            argmatcher_parser(lua_State* state, const compiled_argmatcher& compiled, int compiled_index,
+                                              const line_state& line, int line_state_index,
+                                              lua_word_classifications* classifier, int classifier_index);
+    bool                    update(const char* word, int word_index);
+    int                     get_matcher() const { return m_matcher; }
+    int                     get_arg_index() const { return m_arg_index; }
+
+private:
+    void                    push(int matcher);
+    bool                    pop(bool next_is_flag);
+    void                    get_word(int word_index, str_base& out) const;
+    const word*             get_info(int word_index) const;
+    bool                    classify(int word_index, char wc);
+    bool                    call_classifier(int matcher, int arg_index, const char* word, int word_index, bool& handled);
+
+    lua_State* const        m_state;
+    const compiled_argmatcher& m_compiled;
+    const int               m_compiled_index;
+    const line_state&       m_line;
+    const int               m_line_state_index;
+    lua_word_classifications* const m_classifier;
+    const int               m_classifier_index;
+    const int               m_slash_mode;
+    int                     m_matcher = 0;
+    int                     m_arg_index = 1;
+    std::vector<std::pair<int, int>> m_stack;
+};
+
+//------------------------------------------------------------------------------
+argmatcher_parser::argmatcher_parser(lua_State* state, const compiled_argmatcher& compiled, int compiled_index,
+                                     const line_state& line, int line_state_index,
+                                     lua_word_classifications* classifier, int classifier_index)
+: m_state(state)
+, m_compiled(compiled)
+, m_compiled_index(compiled_index)
+, m_line(line)
+, m_line_state_index(line_state_index)
+, m_classifier(classifier)
+, m_classifier_index(classifier_index)
+, m_slash_mode(get_slash_translation())
+{
+}
+
+//------------------------------------------------------------------------------
+bool argmatcher_parser::update(const char* word, int word_index)
+{
+    char arg_match_type = 'a';
+
+    // Check for flags and switch matcher if the word is a flag.
+    str<32> next_word;
+    get_word(word_index + 1, next_word);
+    const matcher_node* matcher = &m_compiled.get_node(m_matcher);
+    const bool is_flag = matcher->is_flag(word, m_slash_mode);
+    const bool next_is_flag = matcher->is_flag(next_word.c_str(), m_slash_mode);
+    bool pushed_flags = false;
+    if (is_flag)
+    {
+        if (matcher->flags < 0)
+            return true;
+        push(matcher->flags);
+        arg_match_type = 'f';
+        pushed_flags = true;
+    }
+
+    const int matcher_index = m_matcher;
+    matcher = &m_compiled.get_node(matcher_index);
+    const int arg_index = m_arg_index;
+    const arg_slot* arg = matcher->get_arg(arg_index);
+    const int next_arg_index = arg_index + 1;
+    const int num_args = int(matcher->args.size());
+
+    if (next_arg_index > num_args)
+    {
+        if (matcher->has_loop)
+            m_arg_index = min<int>(max<int>(matcher->loop, 1), num_args);
+        else if (is_flag)
+            m_arg_index = next_arg_index;
+        else if (!pushed_flags && next_is_flag)
+            m_arg_index = next_arg_index;
+        else if (!pop(next_is_flag))
+            m_arg_index = next_arg_index;
+    }
+    else
+    {
+        m_arg_index = next_arg_index;
+    }
+
+    // Some matchers have no args at all.  Or ran out of args.
+    if (!arg)
+    {
+        if (m_classifier && word_index >= 0)
+            return classify(word_index, matcher->no_files ? 'n' : 'o');
+        return true;
+    }
+
+    const size_t word_len = strlen(word);
+    const bool ends_with_sep = (word_len && strchr(":=", word[word_len - 1]));
+
+    // Parse the word type.
+    if (m_classifier && word_index >= 0)
+    {
+        bool handled = false;
+        if (matcher->has_classifier && !call_classifier(matcher_index, arg_index, word, word_index, handled))
+            return false;
+
+        if (!handled)
+        {
+            char t = 'o';
+            if (arg->links.find(word) != arg->links.end())
+            {
+                t = arg_match_type;
+            }
+            else
+            {
+                bool matched = false;
+                if (arg_match_type == 'f' && ends_with_sep)
+                {
+                    const ::word* this_info = get_info(word_index);
+                    const ::word* next_info = get_info(word_index + 1);
+                    if (this_info && next_info && this_info->offset + this_info->length == next_info->offset)
+                    {
+                        str<> combined_word;
+                        combined_word << word << next_word.c_str();
+                        if (arg->string_set.find(combined_word.c_str()) != arg->string_set.end())
+                        {
+                            t = arg_match_type;
+                            if (!classify(word_index + 1, t))
+                                return false;
+                            matched = true;
+                        }
+                    }
+                }
+                if (!matched && arg->string_set.find(word) != arg->string_set.end())
+                    t = arg_match_type;
+            }
+
+            if (!classify(word_index, t))
+                return false;
+        }
+    }
+
+    // Does the word lead to another matcher?
+    int linked = -1;
+    const auto it = arg->links.find(word);
+    if (it != arg->links.end())
+    {
+        linked = it->second;
+        if (is_flag && ends_with_sep && word_index >= 0)
+        {
+            // Don't follow linked parser on `--foo=` flag if there's a space
+            // after the `:` or `=` unless the cursor is on the space.
+            if (const ::word* info = get_info(word_index))
+            {
+                const unsigned int end = info->offset + info->length;
+                if (m_line.get_cursor() != end && m_line.get_line()[end] == ' ')
+                    linked = -1;
+            }
+        }
+        if (linked >= 0)
+            push(linked);
+    }
+
+    // If it's a flag and doesn't have a linked matcher, then pop to restore the
+    // matcher that should be active for the next word.
+    if (linked < 0 && is_flag)
+        pop(next_is_flag);
+
+    return true;
+}
+
+//------------------------------------------------------------------------------
+void argmatcher_parser::push(int matcher)
+{
+    const matcher_node& node = m_compiled.get_node(matcher);
+    if (!node.deprecated || node.is_flag_matcher)
+        m_stack.emplace_back(m_matcher, m_arg_index);
+
+    m_matcher = matcher;
+    m_arg_index = 1;
+}
+
+//------------------------------------------------------------------------------
+bool argmatcher_parser::pop(bool next_is_flag)
+{
+    if (m_stack.empty())
+        return false;
+
+    while (!m_stack.empty())
+    {
+        // :nofiles() dead-ends the parser.
+        if (m_compiled.get_node(m_matcher).no_files)
+            return false;
+
+        m_matcher = m_stack.back().first;
+        m_arg_index = m_stack.back().second;
+        m_stack.pop_back();
+
+        const matcher_node& node = m_compiled.get_node(m_matcher);
+        const int num_args = int(node.args.size());
+        if (node.has_loop)
+            break;
+        if (next_is_flag && node.flags >= 0)
+            break;
+        if (m_arg_index <= num_args)
+            break;
+        if (num_args == 0 && node.flags >= 0 && (next_is_flag || m_arg_index == 1))
+            break;
+    }
+
+    return true;
+}
+
+//------------------------------------------------------------------------------
+void argmatcher_parser::get_word(int word_index, str_base& out) const
+{
+    out.clear();
+    if (word_index > 0)
+        m_line.get_word(word_index - 1, out);
+}
+
+//------------------------------------------------------------------------------
+const word* argmatcher_parser::get_info(int word_index) const
+{
+    const std::vector<word>& words = m_line.get_words();
+    if (word_index < 1 || word_index > int(words.size()))
+        return nullptr;
+    return &words[word_index - 1];
+}
+
+//------------------------------------------------------------------------------
+bool argmatcher_parser::classify(int word_index, char wc)
+{
+    if (m_classifier->classify(word_index - 1, wc, false))
+        return true;
+
+    lua_pushliteral(m_state, "word_index out of bounds");
+    return false;
+}
+
+//------------------------------------------------------------------------------
+bool argmatcher_parser::call_classifier(int matcher, int arg_index, const char* word, int word_index, bool& handled)
+{
+    if (!m_compiled.push_node(m_state, m_compiled_index, matcher))
+        return true;
+
+    lua_getfield(m_state, -1, "_classify_func");
+    lua_remove(m_state, -2);
+    lua_pushinteger(m_state, arg_index);
+    lua_pushstring(m_state, word);
+    lua_pushinteger(m_state, word_index);
+    lua_pushvalue(m_state, m_line_state_index);
+    lua_pushvalue(m_state, m_classifier_index);
+    if (lua_pcall(m_state, 5, 1, 0) != LUA_OK)
+        return false;
+
+    handled = !!lua_toboolean(m_state, -1);
+    lua_pop(m_state, 1);
+    return true;
+}
+
+
+
+//------------------------------------------------------------------------------
+// UNDOCUMENTED; internal use only.
+// clink._compile_argmatcher(matcher) returns a compiled argmatcher.
+static int compile_argmatcher(lua_State* state)
+{
+    luaL_checktype(state, 1, LUA_TTABLE);
+
+    compiled_argmatcher* compiled = compiled_argmatcher::make_new(state);
+    compiled->compile(state, 1);
+    return 1;
+}
+
+//------------------------------------------------------------------------------
+// UNDOCUMENTED; internal use only.
+// clink._argmatchers_changed() advances the argmatcher generation and returns
+// the new generation.
+static int argmatchers_changed(lua_State* state)
+{
+    lua_pushinteger(state, ++s_argmatcher_generation);
+    return 1;
+}
+
+//------------------------------------------------------------------------------
+// UNDOCUMENTED; internal use only.
+// clink._set_classifiers_onlychanged(bool) records whether every classifier
+// accepts being given only the commands that changed.
+static int set_classifiers_only_changed(lua_State* state)
+{
+    s_classifiers_only_changed = lua_toboolean(state, 1);
+    return 0;
+}
+
+//------------------------------------------------------------------------------
+// UNDOCUMENTED; internal use only.
+// clink._parse_argmatcher_words(compiled, line_state, extra_words, classifier)
+// walks the words in line_state and returns the matcher table and arg index
+// that apply to the end word, or nil if line_state or classifier aren't native
+// objects (so the caller can fall back to the Lua parser).  When classifier is
+// provided, the words are classified and the end word is included.
+static int parse_argmatcher_words(lua_State* state)
+{
+    enum { arg_compiled = 1, arg_line_state, arg_extra_words, arg_classifier };
+
+    const compiled_argmatcher* compiled = compiled_argmatcher::test(state, arg_compiled);
+    const line_state_lua* line_lua = line_state_lua::test(state, arg_line_state);
+    lua_word_classifications* classifier = nullptr;
+    if (!lua_isnoneornil(state, arg_classifier))
+    {
+        classifier = lua_word_classifications::test(state, arg_classifier);
+        if (!classifier)
+            return 0;
+    }
+    if (!compiled || !line_lua)
+        return 0;
+
+    bool ok = true;
+    {
+        const line_state& line = line_lua->get_line_state();
+        argmatcher_parser parser(state, *compiled, arg_compiled, line, arg_line_state, classifier, arg_classifier);
+
+        // Consume extra words from expanded doskey alias.
+        if (lua_istable(state, arg_extra_words))
+        {
+            const int num = int(lua_rawlen(state, arg_extra_words));
+            for (int i = 2; ok && i <= num; ++i)
+            {
+                lua_rawgeti(state, arg_extra_words, i);
+                if (const char* word = lua_tostring(state, -1))
+                    ok = parser.update(word, -1);
+                if (ok)
+                    lua_pop(state, 1);
+            }
+        }
+
+        // Consume words and use them to move through matchers' arguments.
+        const std::vector<word>& words = line.get_words();
+        const int word_count = int(words.size());
+        const int last = classifier ? word_count : word_count - 1;
+        str<> word;
+        for (int word_index = line.get_command_word_index() + 2; ok && word_index <= last; ++word_index)
+        {
+            if (!words[word_index - 1].is_redir_arg)
+            {
+                word.clear();
+                line.get_word(word_index - 1, word);
+                ok = parser.update(word.c_str(), word_index);
+            }
+        }
+
+        if (ok)
+        {
+            compiled->push_node(state, arg_compiled, parser.get_matcher());
+            lua_pushinteger(state, parser.get_arg_index());
+            return 2;
+        }
+    }
+
+    // Raise the error only after the C++ objects above are destroyed.
+    return lua_error(state);
+}
+
+//------------------------------------------------------------------------------
+// UNDOCUMENTED; internal use only.
+// clink._add_argmatcher_matches(compiled, matcher, arg, builder, [type]) adds
+// the matches for arg, using the descriptions from matcher.  Returns false
+// without adding anything if arg contains anything other than strings and
+// links (for example functions), so the caller can fall back to Lua.
+static int add_argmatcher_matches(lua_State* state)
+{
+    const compiled_argmatcher* compiled = compiled_argmatcher::test(state, 1);
+    match_builder_lua* builder_lua = match_builder_lua::test(state, 4);
+    const char* type_name = optstring(state, 5, "");
+    if (!compiled || !builder_lua || !type_name || !lua_istable(state, 2) || !lua_istable(state, 3))
+        return 0;
+
+    const int node_index = compiled->find_node(lua_topointer(state, 2));
+    const arg_slot* slot = compiled->find_slot(lua_topointer(state, 3));
+    if (node_index < 0 || !slot || slot->has_other)
+        return 0;
+
+    const description_map& descriptions = compiled->get_node(node_index).descriptions;
+    match_builder& builder = builder_lua->get_builder();
+    const match_type type = to_match_type(type_name);
+
+    auto add = [&] (const char* match) {
+        match_desc desc = { match, nullptr, nullptr, type, false };
+        const auto d = descriptions.find(match);
+        if (d != descriptions.end())
+        {
+            desc.display = d->second.display;
+            desc.description = d->second.description;
+            desc.append_display = d->second.append_display;
+        }
+        builder.add_match(desc);
+    };
+
+    for (const auto& link : slot->links)
+        add(link.first);
+    for (const char* match : slot->strings)
+        add(match);
+
+    lua_pushboolean(state, true);
+    return 1;
+}
+
+//------------------------------------------------------------------------------
+void argmatcher_lua_initialise(lua_state& lua)
+{
+    struct {
+        const char* name;
+        int         (*method)(lua_State*);
+    } methods[] = {
+        { "_compile_argmatcher",            &compile_argmatcher },
+        { "_argmatchers_changed",           &argmatchers_changed },
+        { "_set_classifiers_onlychanged",   &set_classifiers_only_changed },
+        { "_parse_argmatcher_words",        &parse_argmatcher_words },
+        { "_add_argmatcher_matches",        &add_argmatcher_matches },
+    };
+
+    lua_State* state = lua.get_state();
+
+    lua_getglobal(state, "clink");
+
+    for (const auto& method : methods)
+    {
+        lua_pushstring(state, method.name);
+        lua_pushcfunction(state, method.method);
+        lua_rawset(state, -3);
+    }
+
+    lua_pop(state, 1);
+}
@@ -0,0 +1,170 @@
+// Copyright (c) 2021 Christopher Antos
+// License: http://opensource.org/licenses/MIT
+
+#include "pch.h"
+#include "lua_state.h"
+
+#include <core/base.h>
+#include <core/os.h>
+#include <core/path.h>
+#include <core/str.h>
+#include <core/str_hash.h>
+
+extern "C" {
+#include <lua.h>
+#include <lauxlib.h>
+}
+
+#include <memory>
+
+//------------------------------------------------------------------------------
+// Entries written by clink.cache() are stored one per file in this directory,
+// so that concurrent Clink instances can share them without coordinating.
+// When empty, clink.cache() only caches in memory.
+static str_moveable s_cache_dir;
+
+//------------------------------------------------------------------------------
+void set_prompt_cache_dir(const char* dir)
+{
+    s_cache_dir = dir ? dir : "";
+}
+
+//------------------------------------------------------------------------------
+static bool get_cache_file(const char* key, str_base& out)
+{
+    if (s_cache_dir.empty())
+        return false;
+
+    str<16> name;
+    name.format("%08x.txt", str_hash(key));
+    out = s_cache_dir.c_str();
+    return path::append(out, name.c_str());
+}
+
+
+
+//------------------------------------------------------------------------------
+// UNDOCUMENTED; internal use only.
+// Returns the serialized data saved for the key, or nil.  The file begins with
+// the key followed by a newline, so hash collisions are detected.
+static int cache_load(lua_State* state)
+{
+    size_t key_len;
+    const char* key = luaL_checklstring(state, 1, &key_len);
+
+    str<280> cache_file;
+    if (!get_cache_file(key, cache_file))
+        return 0;
+
+    wstr<280> wcache_file(cache_file.c_str());
+    FILE* file = _wfopen(wcache_file.c_str(), L"rb");
+    if (!file)
+        return 0;
+
+    int ret = 0;
+    fseek(file, 0, SEEK_END);
+    const long total = ftell(file);
+    const long offset = long(key_len + 1);
+    if (total > offset && total < 1024 * 1024)
+    {
+        std::unique_ptr<char[]> data(new char[total]);
+        fseek(file, 0, SEEK_SET);
+        if (fread(data.get(), total, 1, file) == 1 &&
+            memcmp(data.get(), key, key_len) == 0 &&
+            data.get()[key_len] == '\n')
+        {
+            lua_pushlstring(state, data.get() + offset, total - offset);
+            ret = 1;
+        }
+    }
+
+    fclose(file);
+    return ret;
+}
+
+//------------------------------------------------------------------------------
+struct cache_entry
+{
+    const char*     key;
+    size_t          key_len;
+    const char*     data;
+    size_t          data_len;
+};
+
+//------------------------------------------------------------------------------
+static bool write_cache_entry(FILE* file, void* param)
+{
+    const cache_entry& entry = *(const cache_entry*)param;
+    return (fwrite(entry.key, entry.key_len, 1, file) == 1 &&
+            fwrite("\n", 1, 1, file) == 1 &&
+            (!entry.data_len || fwrite(entry.data, entry.data_len, 1, file) == 1));
+}
+
+//------------------------------------------------------------------------------
+// UNDOCUMENTED; internal use only.
+// Saves the serialized data for the key.  Returns true on success.
+static int cache_save(lua_State* state)
+{
+    size_t key_len;
+    size_t data_len;
+    const char* key = luaL_checklstring(state, 1, &key_len);
+    const char* data = luaL_checklstring(state, 2, &data_len);
+
+    str<280> cache_file;
+    if (!get_cache_file(key, cache_file) || !os::make_dir(s_cache_dir.c_str()))
+        return 0;
+
+    cache_entry entry = { key, key_len, data, data_len };
+    if (!os::atomic_write_file(cache_file.c_str(), &write_cache_entry, &entry))
+        return 0;
+
+    lua_pushboolean(state, true);
+    return 1;
+}
+
+//------------------------------------------------------------------------------
+// UNDOCUMENTED; internal use only.
+// Returns a string identifying the size and last write time of the file, or
+// nil if the file doesn't exist.  Used for clink.cache() validators.
+static int cache_file_stamp(lua_State* state)
+{
+    const char* path = luaL_checkstring(state, 1);
+
+    unsigned long long size;
+    unsigned long long mtime;
+    if (!os::get_file_stamp(path, size, mtime))
+        return 0;
+
+    str<64> stamp;
+    stamp.format("%llx:%llx", mtime, size);
+    lua_pushlstring(state, stamp.c_str(), stamp.length());
+    return 1;
+}
+
+
+
+//------------------------------------------------------------------------------
+void cache_lua_initialise(lua_state& lua)
+{
+    struct {
+        const char* name;
+        int         (*method)(lua_State*);
+    } methods[] = {
+        { "_cache_load",            &cache_load },
+        { "_cache_save",            &cache_save },
+        { "_cache_file_stamp",      &cache_file_stamp },
+    };
+
+    lua_State* state = lua.get_state();
+
+    lua_getglobal(state, "clink");
+
+    for (const auto& method : methods)
+    {
+        lua_pushstring(state, method.name);
+        lua_pushcfunction(state, method.method);
+        lua_rawset(state, -3);
+    }
+
+    lua_pop(state, 1);
+}
@@ -7,6 +7,7 @@
 #include "../../app/src/version.h" // Ugh.
 
 #include <core/base.h>
+#include <core/latency.h>
 #include <core/log.h>
 #include <core/os.h>
 #include <core/path.h>
@@ -679,6 +680,89 @@ static int reload(lua_State* state)
     return 0;
 }
 
+//------------------------------------------------------------------------------
+/// -name:  clink.getlatency
+/// -ver:   1.2.46
+/// -arg:   [reset:boolean]
+/// -ret:   table
+/// Returns the input latency histograms recorded while the
+/// <code>clink.latency</code> setting is enabled.  The table has a field for
+/// each phase that has been recorded (<code>"input"</code>,
+/// <code>"dispatch"</code>, <code>"update"</code>, <code>"generate"</code>,
+/// <code>"restrict"</code>, <code>"select"</code>, <code>"sort"</code>,
+/// <code>"classify"</code>, <code>"prompt"</code>, <code>"redisplay"</code>,
+/// and <code>"gc"</code>).  Each is a table with these fields:
+///
+/// <table>
+/// <tr><th>Field</th><th>Description</th></tr>
+/// <tr><td><code>count</code></td><td>The number of spans recorded.</td></tr>
+/// <tr><td><code>total</code></td><td>The total duration, in milliseconds.</td></tr>
+/// <tr><td><code>max</code></td><td>The longest duration, in milliseconds.</td></tr>
+/// <tr><td><code>buckets</code></td><td>A table of <code>{ limit=integer, count=integer }</code> tables, in increasing order.  A span is counted in the first bucket whose <code>limit</code> (in microseconds) is greater than its duration.  The last bucket has no <code>limit</code>.</td></tr>
+/// </table>
+///
+/// Spans are inclusive, so a phase that happens during another phase (e.g.
+/// <code>"classify"</code> during <code>"redisplay"</code>) counts toward both.
+///
+/// If <span class="arg">reset</span> is true, the histograms are cleared after
+/// being returned.
+static int get_latency(lua_State* state)
+{
+    const bool reset = lua_toboolean(state, 1);
+
+    lua_createtable(state, 0, int(latency_phase::max));
+
+    for (unsigned int phase = 0; phase < (unsigned int)(latency_phase::max); ++phase)
+    {
+        latency_histogram h;
+        if (!latency::get_histogram(latency_phase(phase), h) || !h.count)
+            continue;
+
+        lua_pushstring(state, latency::get_phase_name(latency_phase(phase)));
+        lua_createtable(state, 0, 4);
+
+        lua_pushliteral(state, "count");
+        lua_pushinteger(state, h.count);
+        lua_rawset(state, -3);
+
+        lua_pushliteral(state, "total");
+        lua_pushnumber(state, double(h.total_us) / 1000);
+        lua_rawset(state, -3);
+
+        lua_pushliteral(state, "max");
+        lua_pushnumber(state, double(h.max_us) / 1000);
+        lua_rawset(state, -3);
+
+        lua_pushliteral(state, "buckets");
+        lua_createtable(state, latency_histogram::num_buckets, 0);
+        for (unsigned int bucket = 0; bucket < latency_histogram::num_buckets; ++bucket)
+        {
+            lua_createtable(state, 0, 2);
+
+            if (const unsigned int limit = latency::get_bucket_limit(bucket))
+            {
+                lua_pushliteral(state, "limit");
+                lua_pushinteger(state, limit);
+                lua_rawset(state, -3);
+            }
+
+            lua_pushliteral(state, "count");
+            lua_pushinteger(state, h.buckets[bucket]);
+            lua_rawset(state, -3);
+
+            lua_rawseti(state, -2, bucket + 1);
+        }
+        lua_rawset(state, -3);
+
+        lua_rawset(state, -3);
+    }
+
+    if (reset)
+        latency::reset();
+
+    return 1;
+}
+
 //------------------------------------------------------------------------------
 // UNDOCUMENTED; internal use only.
 int g_prompt_refilter = 0;
@@ -708,6 +792,25 @@ static int is_transient_prompt_filter(lua_State* state)
     return 1;
 }
 
+//------------------------------------------------------------------------------
+// UNDOCUMENTED; internal use only.
+// clink._loadfile(path, cache_dir) is like loadfile(path), but uses the
+// bytecode cache in cache_dir when cache_dir is given.
+static int load_file(lua_State* state)
+{
+    const char* path = checkstring(state, 1);
+    const char* cache_dir = optstring(state, 2, nullptr);
+    if (!path)
+        return 0;
+
+    if (lua_state::load_file(state, path, cache_dir) == LUA_OK)
+        return 1;
+
+    lua_pushnil(state);
+    lua_insert(state, -2);
+    return 2;
+}
+
 
 
 //------------------------------------------------------------------------------
@@ -736,6 +839,7 @@ void clink_lua_initialise(lua_state& lua)
         { "getansihost",            &get_ansi_host },
         { "translateslashes",       &translate_slashes },
         { "reload",                 &reload },
+        { "getlatency",             &get_latency },
         // Backward compatibility with the Clink 0.4.8 API.  Clink 1.0.0a1 had
         // moved these APIs away from "clink.", but backward compatibility
         // requires them here as well.
@@ -760,6 +864,7 @@ void clink_lua_initialise(lua_state& lua)
         { "refilterprompt",         &refilter_prompt },
         { "istransientpromptfilter", &is_transient_prompt_filter },
         { "get_refilter_redisplay_count", &get_refilter_redisplay_count },
+        { "_loadfile",              &load_file },
     };
 
     lua_State* state = lua.get_state();
@@ -0,0 +1,511 @@
+// Copyright (c) 2021 Christopher Antos
+// License: http://opensource.org/licenses/MIT
+
+#include "pch.h"
+#include "coroutine_scheduler.h"
+#include "lua_state.h"
+
+#include <core/base.h>
+#include <core/os.h>
+
+#include <new>
+
+extern "C" {
+#include <lua.h>
+#include <lauxlib.h>
+}
+
+//------------------------------------------------------------------------------
+#define LUA_COROUTINESCHEDULER "clink_coroutine_scheduler"
+
+
+
+//------------------------------------------------------------------------------
+coroutine_scheduler* coroutine_scheduler::get(lua_State* state)
+{
+    lua_getfield(state, LUA_REGISTRYINDEX, LUA_COROUTINESCHEDULER);
+    coroutine_scheduler* self = (coroutine_scheduler*)luaL_testudata(state, -1, LUA_COROUTINESCHEDULER);
+    lua_pop(state, 1);
+    return self;
+}
+
+//------------------------------------------------------------------------------
+bool coroutine_scheduler::has_due(double now)
+{
+    if (!m_ready.empty() || !m_due.empty())
+        return true;
+
+    refresh_top(now);
+    return !m_heap.empty() && m_heap[0]->target <= now;
+}
+
+//------------------------------------------------------------------------------
+double coroutine_scheduler::get_wait_duration(double now)
+{
+    if (!m_ready.empty() || !m_due.empty())
+        return 0;
+
+    refresh_top(now);
+    if (m_heap.empty())
+        return -1;
+
+    return max<double>(m_heap[0]->target - now, 0);
+}
+
+//------------------------------------------------------------------------------
+unsigned int coroutine_scheduler::add(double interval)
+{
+    const unsigned int id = m_next_id++;
+    entry& e = m_entries[id];
+    e.id = id;
+    e.interval = interval;
+    heap_push(e);
+    return id;
+}
+
+//------------------------------------------------------------------------------
+void coroutine_scheduler::remove(unsigned int id)
+{
+    // Ids are never reused, so stale ids left in m_ready or m_due are skipped.
+    const auto it = m_entries.find(id);
+    if (it == m_entries.end())
+        return;
+
+    if (it->second.heap_index >= 0)
+        heap_remove(it->second);
+    m_entries.erase(it);
+}
+
+//------------------------------------------------------------------------------
+void coroutine_scheduler::set_waiting(unsigned int id, bool waiting)
+{
+    const auto it = m_entries.find(id);
+    if (it == m_entries.end())
+        return;
+
+    entry& e = it->second;
+    if (e.waiting == waiting)
+        return;
+
+    e.waiting = waiting;
+    if (waiting)
+    {
+        // Waiting for a popenyield command (or a slot to start one) uses an
+        // infinite wait; the entry becomes ready when the wait ends.
+        if (e.heap_index >= 0)
+            heap_remove(e);
+    }
+    else if (!e.queued)
+    {
+        e.queued = true;
+        m_ready.push_back(id);
+    }
+}
+
+//------------------------------------------------------------------------------
+void coroutine_scheduler::set_throttle(unsigned int id, double now)
+{
+    const auto it = m_entries.find(id);
+    if (it == m_entries.end())
+        return;
+
+    entry& e = it->second;
+    e.throttleclock = now;
+    if (e.heap_index >= 0)
+    {
+        e.target = next_target(e, now);
+        heap_update(e);
+    }
+}
+
+//------------------------------------------------------------------------------
+// Collects the entries that are due, so that entries rescheduled while the
+// pass is running can't run a second time in the same pass.
+void coroutine_scheduler::begin_pass(double now)
+{
+    while (!m_ready.empty())
+    {
+        m_due.push_back(m_ready.front());
+        m_ready.pop_front();
+    }
+
+    for (refresh_top(now); !m_heap.empty() && m_heap[0]->target <= now; refresh_top(now))
+    {
+        entry& e = *m_heap[0];
+        heap_remove(e);
+        if (!e.queued)
+        {
+            e.queued = true;
+            m_due.push_back(e.id);
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+unsigned int coroutine_scheduler::next_due(double now)
+{
+    while (!m_due.empty())
+    {
+        const unsigned int id = m_due.front();
+        m_due.pop_front();
+
+        const auto it = m_entries.find(id);
+        if (it == m_entries.end())
+            continue;
+
+        entry& e = it->second;
+        e.queued = false;
+        if (e.waiting)
+            continue;
+
+        if (e.firstclock < 0)
+            e.firstclock = now;
+
+        // Keep it scheduled even if resumed() never gets called.  It can't be
+        // collected again until the next pass.
+        if (e.heap_index < 0)
+            heap_push(e);
+        return id;
+    }
+
+    return 0;
+}
+
+//------------------------------------------------------------------------------
+void coroutine_scheduler::resumed(unsigned int id, double now)
+{
+    const auto it = m_entries.find(id);
+    if (it == m_entries.end())
+        return;
+
+    entry& e = it->second;
+    e.lastclock = now;
+    if (e.heap_index >= 0)
+    {
+        e.target = next_target(e, now);
+        heap_update(e);
+    }
+}
+
+//------------------------------------------------------------------------------
+double coroutine_scheduler::next_target(const entry& e, double now) const
+{
+    if (e.lastclock < 0)
+        return 0;
+
+    // Multiple kinds of throttling for coroutines that want to run more
+    // frequently than every 5 seconds:
+    //  1.  Throttle if running for 5 or more seconds, but reset the elapsed
+    //      timer every time io.popenyield() finishes.
+    //  2.  Throttle if running for more than 30 seconds total.
+    // Throttled coroutines can only run once every 5 seconds.
+    double interval = e.interval;
+    const double throttleclock = (e.throttleclock >= 0) ? e.throttleclock : e.firstclock;
+    if (interval < 5)
+    {
+        if (throttleclock >= 0 && now - throttleclock > 5)
+            interval = 5;
+        else if (e.firstclock >= 0 && now - e.firstclock > 30)
+            interval = 5;
+    }
+    return e.lastclock + interval;
+}
+
+//------------------------------------------------------------------------------
+// Throttling depends on the current time, so the top entry's target can move
+// later as time passes.  Targets never move earlier on their own, so once the
+// top entry is up to date it's the true minimum.
+void coroutine_scheduler::refresh_top(double now)
+{
+    while (!m_heap.empty())
+    {
+        entry& e = *m_heap[0];
+        const double target = next_target(e, now);
+        if (target <= e.target)
+            break;
+        e.target = target;
+        heap_down(0);
+    }
+}
+
+//------------------------------------------------------------------------------
+void coroutine_scheduler::heap_push(entry& e)
+{
+    e.heap_index = int(m_heap.size());
+    m_heap.push_back(&e);
+    heap_up(e.heap_index);
+}
+
+//------------------------------------------------------------------------------
+void coroutine_scheduler::heap_remove(entry& e)
+{
+    const int index = e.heap_index;
+    const int last = int(m_heap.size()) - 1;
+    if (index != last)
+        heap_swap(index, last);
+    m_heap.pop_back();
+    e.heap_index = -1;
+    if (index != last)
+        heap_down(heap_up(index));
+}
+
+//------------------------------------------------------------------------------
+void coroutine_scheduler::heap_update(entry& e)
+{
+    heap_down(heap_up(e.heap_index));
+}
+
+//------------------------------------------------------------------------------
+int coroutine_scheduler::heap_up(int index)
+{
+    while (index > 0)
+    {
+        const int parent = (index - 1) / 2;
+        if (m_heap[parent]->target <= m_heap[index]->target)
+            break;
+        heap_swap(index, parent);
+        index = parent;
+    }
+    return index;
+}
+
+//------------------------------------------------------------------------------
+void coroutine_scheduler::heap_down(int index)
+{
+    const int count = int(m_heap.size());
+    while (true)
+    {
+        int smallest = index;
+        const int left = index * 2 + 1;
+        const int right = left + 1;
+        if (left < count && m_heap[left]->target < m_heap[smallest]->target)
+            smallest = left;
+        if (right < count && m_heap[right]->target < m_heap[smallest]->target)
+            smallest = right;
+        if (smallest == index)
+            break;
+        heap_swap(index, smallest);
+        index = smallest;
+    }
+}
+
+//------------------------------------------------------------------------------
+void coroutine_scheduler::heap_swap(int a, int b)
+{
+    entry* tmp = m_heap[a];
+    m_heap[a] = m_heap[b];
+    m_heap[b] = tmp;
+    m_heap[a]->heap_index = a;
+    m_heap[b]->heap_index = b;
+}
+
+
+
+//------------------------------------------------------------------------------
+// The scheduler userdata is upvalue 1 of each function below.  Its user value
+// is a table that maps each scheduled thread to its id, and each id back to
+// its thread.
+static coroutine_scheduler* get_self(lua_State* state)
+{
+    return (coroutine_scheduler*)lua_touserdata(state, lua_upvalueindex(1));
+}
+
+//------------------------------------------------------------------------------
+static unsigned int get_id(lua_State* state, int index)
+{
+    if (lua_type(state, index) != LUA_TTHREAD)
+        return 0;
+
+    lua_getuservalue(state, lua_upvalueindex(1));
+    lua_pushvalue(state, index);
+    lua_rawget(state, -2);
+    const unsigned int id = (unsigned int)(lua_tointeger(state, -1));
+    lua_pop(state, 2);
+    return id;
+}
+
+//------------------------------------------------------------------------------
+static void set_id(lua_State* state, int index, unsigned int id, bool set)
+{
+    lua_getuservalue(state, lua_upvalueindex(1));
+    lua_pushvalue(state, index);
+    if (set)
+        lua_pushinteger(state, id);
+    else
+        lua_pushnil(state);
+    lua_rawset(state, -3);
+    if (set)
+        lua_pushvalue(state, index);
+    else
+        lua_pushnil(state);
+    lua_rawseti(state, -2, id);
+    lua_pop(state, 1);
+}
+
+//------------------------------------------------------------------------------
+static int __gc(lua_State* state)
+{
+    coroutine_scheduler* self = (coroutine_scheduler*)luaL_checkudata(state, 1, LUA_COROUTINESCHEDULER);
+    self->~coroutine_scheduler();
+    return 0;
+}
+
+//------------------------------------------------------------------------------
+// UNDOCUMENTED; internal use only.
+// clink._schedule_coroutine(thread, interval) adds (or re-adds) the thread to
+// the scheduler; it's due immediately.
+static int schedule_coroutine(lua_State* state)
+{
+    luaL_checktype(state, 1, LUA_TTHREAD);
+    const double interval = optnumber(state, 2, 0);
+
+    coroutine_scheduler* self = get_self(state);
+    if (unsigned int id = get_id(state, 1))
+    {
+        self->remove(id);
+        set_id(state, 1, id, false);
+    }
+
+    set_id(state, 1, self->add(interval), true);
+    return 0;
+}
+
+//------------------------------------------------------------------------------
+// UNDOCUMENTED; internal use only.
+static int unschedule_coroutine(lua_State* state)
+{
+    if (unsigned int id = get_id(state, 1))
+    {
+        get_self(state)->remove(id);
+        set_id(state, 1, id, false);
+    }
+    return 0;
+}
+
+//------------------------------------------------------------------------------
+// UNDOCUMENTED; internal use only.
+// clink._set_coroutine_waiting(thread, waiting) puts the thread into (or takes
+// it out of) an infinite wait.  Taking it out of the wait makes it ready to be
+// resumed in the next pass.
+static int set_coroutine_waiting(lua_State* state)
+{
+    if (unsigned int id = get_id(state, 1))
+        get_self(state)->set_waiting(id, !!lua_toboolean(state, 2));
+    return 0;
+}
+
+//------------------------------------------------------------------------------
+// UNDOCUMENTED; internal use only.
+// clink._set_coroutine_throttle(thread) resets the throttling timer; it's
+// called when an io.popenyield() command finishes.
+static int set_coroutine_throttle(lua_State* state)
+{
+    if (unsigned int id = get_id(state, 1))
+        get_self(state)->set_throttle(id, os::clock());
+    return 0;
+}
+
+//------------------------------------------------------------------------------
+// UNDOCUMENTED; internal use only.
+static int begin_coroutine_pass(lua_State* state)
+{
+    get_self(state)->begin_pass(os::clock());
+    return 0;
+}
+
+//------------------------------------------------------------------------------
+// UNDOCUMENTED; internal use only.
+// clink._next_due_coroutine() returns the next thread collected by
+// clink._begin_coroutine_pass(), or nil when there are no more.
+static int next_due_coroutine(lua_State* state)
+{
+    const unsigned int id = get_self(state)->next_due(os::clock());
+    if (!id)
+        return 0;
+
+    lua_getuservalue(state, lua_upvalueindex(1));
+    lua_rawgeti(state, -1, id);
+    return 1;
+}
+
+//------------------------------------------------------------------------------
+// UNDOCUMENTED; internal use only.
+// clink._coroutine_resumed(thread) schedules the thread's next run relative to
+// the end of the resume that just finished.
+static int coroutine_resumed(lua_State* state)
+{
+    if (unsigned int id = get_id(state, 1))
+        get_self(state)->resumed(id, os::clock());
+    return 0;
+}
+
+//------------------------------------------------------------------------------
+// UNDOCUMENTED; internal use only.
+// clink._coroutine_wait_duration() returns the number of seconds until the
+// next coroutine is due, or nil if none are waiting on a timer.
+static int coroutine_wait_duration(lua_State* state)
+{
+    const double duration = get_self(state)->get_wait_duration(os::clock());
+    if (duration < 0)
+        return 0;
+
+    lua_pushnumber(state, duration);
+    return 1;
+}
+
+//------------------------------------------------------------------------------
+// UNDOCUMENTED; internal use only.
+static int has_scheduled_coroutines(lua_State* state)
+{
+    lua_pushboolean(state, get_self(state)->has_coroutines());
+    return 1;
+}
+
+//------------------------------------------------------------------------------
+void scheduler_lua_initialise(lua_state& lua)
+{
+    struct {
+        const char* name;
+        int         (*method)(lua_State*);
+    } methods[] = {
+        { "_schedule_coroutine",        &schedule_coroutine },
+        { "_unschedule_coroutine",      &unschedule_coroutine },
+        { "_set_coroutine_waiting",     &set_coroutine_waiting },
+        { "_set_coroutine_throttle",    &set_coroutine_throttle },
+        { "_begin_coroutine_pass",      &begin_coroutine_pass },
+        { "_next_due_coroutine",        &next_due_coroutine },
+        { "_coroutine_resumed",         &coroutine_resumed },
+        { "_coroutine_wait_duration",   &coroutine_wait_duration },
+        { "_has_scheduled_coroutines",  &has_scheduled_coroutines },
+    };
+
+    lua_State* state = lua.get_state();
+
+    coroutine_scheduler* self = (coroutine_scheduler*)lua_newuserdata(state, sizeof(coroutine_scheduler));
+    new (self) coroutine_scheduler();
+
+    if (luaL_newmetatable(state, LUA_COROUTINESCHEDULER))
+    {
+        lua_pushcfunction(state, __gc);
+        lua_setfield(state, -2, "__gc");
+    }
+    lua_setmetatable(state, -2);
+
+    lua_newtable(state);
+    lua_setuservalue(state, -2);
+
+    lua_pushvalue(state, -1);
+    lua_setfield(state, LUA_REGISTRYINDEX, LUA_COROUTINESCHEDULER);
+
+    lua_getglobal(state, "clink");
+
+    for (const auto& method : methods)
+    {
+        lua_pushstring(state, method.name);
+        lua_pushvalue(state, -3);
+        lua_pushcclosure(state, method.method, 1);
+        lua_rawset(state, -3);
+    }
+
+    lua_pop(state, 2);
+}
@@ -0,0 +1,64 @@
+// Copyright (c) 2021 Christopher Antos
+// License: http://opensource.org/licenses/MIT
+
+#pragma once
+
+#include <deque>
+#include <unordered_map>
+#include <vector>
+
+struct lua_State;
+
+//------------------------------------------------------------------------------
+// Tracks when each coroutine added by clink.addcoroutine() next wants to run.
+// Deadlines are kept in a min-heap, and coroutines that become runnable
+// because their io.popenyield() command finished go in a ready queue.  That
+// lets the input idle loop compute its timeout and decide whether anything is
+// due without entering Lua; coroutines.lua only resumes the ones that are due.
+class coroutine_scheduler
+{
+public:
+    static coroutine_scheduler* get(lua_State* state);
+
+    bool                has_coroutines() const { return !m_entries.empty(); }
+    bool                has_due(double now);
+    double              get_wait_duration(double now);  // Negative means none.
+
+    unsigned int        add(double interval);
+    void                remove(unsigned int id);
+    void                set_waiting(unsigned int id, bool waiting);
+    void                set_throttle(unsigned int id, double now);
+    void                begin_pass(double now);
+    unsigned int        next_due(double now);
+    void                resumed(unsigned int id, double now);
+
+private:
+    struct entry
+    {
+        unsigned int    id = 0;
+        double          target = 0;
+        double          interval = 0;
+        double          firstclock = -1;
+        double          lastclock = -1;
+        double          throttleclock = -1;
+        int             heap_index = -1;
+        bool            waiting = false;
+        bool            queued = false;     // In m_ready or m_due.
+    };
+
+    double              next_target(const entry& e, double now) const;
+    void                refresh_top(double now);
+    void                heap_push(entry& e);
+    void                heap_remove(entry& e);
+    void                heap_update(entry& e);
+    int                 heap_up(int index);
+    void                heap_down(int index);
+    void                heap_swap(int a, int b);
+
+    // Entries are never moved by rehashing, so the heap can point at them.
+    std::unordered_map<unsigned int, entry> m_entries;
+    std::vector<entry*> m_heap;
+    std::deque<unsigned int> m_ready;
+    std::deque<unsigned int> m_due;
+    unsigned int        m_next_id = 1;
+};
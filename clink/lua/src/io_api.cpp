@@ -25,6 +25,7 @@
 struct popenrw_info;
 static popenrw_info* s_head = nullptr;
 static HANDLE s_wake_event = nullptr;
+static volatile long s_io_completions = 0;
 
 //------------------------------------------------------------------------------
 void set_io_wake_event(HANDLE event)
@@ -33,6 +34,20 @@ void set_io_wake_event(HANDLE event)
     s_wake_event = event;
 }
 
+//------------------------------------------------------------------------------
+// Changes each time an io.popenyield() command finishes, so the idle loop can
+// tell whether a wakeup means some yield guard may be ready.
+long get_io_completion_count()
+{
+    return s_io_completions;
+}
+
+//------------------------------------------------------------------------------
+void add_io_completion()
+{
+    InterlockedIncrement(&s_io_completions);
+}
+
 //------------------------------------------------------------------------------
 struct popenrw_info
 {
@@ -486,6 +501,7 @@ TODO("COROUTINES: could use overlapped IO to enable cancelling even a blocking c
 
         // Signal completion events.
         SetEvent(_this->m_ready_event);
+        add_io_completion();
         if (_this->m_wake_event)
             SetEvent(_this->m_wake_event);
 
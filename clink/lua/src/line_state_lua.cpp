@@ -7,6 +7,78 @@
 #include <core/array.h>
 #include <lib/line_state.h>
 
+//------------------------------------------------------------------------------
+#define LUA_WORDVIEW "line_state_word_view"
+
+//------------------------------------------------------------------------------
+// A read-only copy of a word's info.  Unlike the table from getwordinfo(), a
+// view can be cached and shared because scripts can't modify it, and it stays
+// valid after the line_state is gone.
+struct word_view
+{
+    unsigned int        offset;
+    unsigned int        length;
+    char                delim;
+    bool                quoted;
+    bool                alias;
+    bool                redir;
+};
+
+//------------------------------------------------------------------------------
+static int word_view_index(lua_State* state)
+{
+    const word_view* view = (const word_view*)luaL_checkudata(state, 1, LUA_WORDVIEW);
+    const char* key = lua_tostring(state, 2);
+    if (!key)
+        return 0;
+
+    if (strcmp(key, "offset") == 0)
+        lua_pushinteger(state, view->offset + 1);
+    else if (strcmp(key, "length") == 0)
+        lua_pushinteger(state, view->length);
+    else if (strcmp(key, "quoted") == 0)
+        lua_pushboolean(state, view->quoted);
+    else if (strcmp(key, "delim") == 0)
+        lua_pushlstring(state, &view->delim, view->delim ? 1 : 0);
+    else if (strcmp(key, "alias") == 0 && view->alias)
+        lua_pushboolean(state, true);
+    else if (strcmp(key, "redir") == 0 && view->redir)
+        lua_pushboolean(state, true);
+    else
+        return 0;
+
+    return 1;
+}
+
+//------------------------------------------------------------------------------
+static int word_view_newindex(lua_State* state)
+{
+    return luaL_error(state, "word view is read-only");
+}
+
+//------------------------------------------------------------------------------
+static void push_new_word_view(lua_State* state, const word& word)
+{
+    word_view* view = (word_view*)lua_newuserdata(state, sizeof(word_view));
+    view->offset = word.offset;
+    view->length = word.length;
+    view->delim = char(word.delim);
+    view->quoted = word.quoted;
+    view->alias = word.is_alias;
+    view->redir = word.is_redir_arg;
+
+    if (luaL_newmetatable(state, LUA_WORDVIEW))
+    {
+        lua_pushcfunction(state, word_view_index);
+        lua_setfield(state, -2, "__index");
+        lua_pushcfunction(state, word_view_newindex);
+        lua_setfield(state, -2, "__newindex");
+    }
+    lua_setmetatable(state, -2);
+}
+
+
+
 //------------------------------------------------------------------------------
 static line_state_lua::method g_methods[] = {
     { "getline",                &line_state_lua::get_line },
@@ -17,6 +89,9 @@ static line_state_lua::method g_methods[] = {
     { "getwordinfo",            &line_state_lua::get_word_info },
     { "getword",                &line_state_lua::get_word },
     { "getendword",             &line_state_lua::get_end_word },
+    { "getwordview",            &line_state_lua::get_word_view },
+    { "getwordviews",           &line_state_lua::get_word_views },
+    { "getwords",               &line_state_lua::get_words },
     {}
 };
 
@@ -29,6 +104,102 @@ line_state_lua::line_state_lua(const line_state& line)
 {
 }
 
+//------------------------------------------------------------------------------
+// The new object is not bound to Lua yet, but takes over the cache so that
+// only one object unrefs it.
+line_state_lua::line_state_lua(line_state_lua&& other)
+: lua_bindable("line_state", g_methods)
+, m_line(other.m_line)
+, m_cache_state(other.m_cache_state)
+, m_cache_ref(other.m_cache_ref)
+{
+    other.m_cache_state = nullptr;
+    other.m_cache_ref = LUA_NOREF;
+}
+
+//------------------------------------------------------------------------------
+line_state_lua::~line_state_lua()
+{
+    if (m_cache_state)
+        luaL_unref(m_cache_state, LUA_REGISTRYINDEX, m_cache_ref);
+}
+
+//------------------------------------------------------------------------------
+// Pushes the table where strings and views are cached for reuse, so repeated
+// calls don't create new Lua objects.  If field is not null, pushes that
+// subtable of the cache instead.
+void line_state_lua::push_cache(lua_State* state, const char* field)
+{
+    if (m_cache_ref == LUA_NOREF)
+    {
+        lua_createtable(state, 0, 4);
+        lua_pushvalue(state, -1);
+        m_cache_ref = luaL_ref(state, LUA_REGISTRYINDEX);
+
+        // The calling thread might be a coroutine that gets collected before
+        // this object is destroyed, so unref from the main thread.
+        lua_rawgeti(state, LUA_REGISTRYINDEX, LUA_RIDX_MAINTHREAD);
+        m_cache_state = lua_tothread(state, -1);
+        lua_pop(state, 1);
+    }
+    else
+    {
+        lua_rawgeti(state, LUA_REGISTRYINDEX, m_cache_ref);
+    }
+
+    if (field)
+    {
+        lua_getfield(state, -1, field);
+        if (lua_isnil(state, -1))
+        {
+            lua_pop(state, 1);
+            lua_createtable(state, int(m_line.get_word_count()), 0);
+            lua_pushvalue(state, -1);
+            lua_setfield(state, -3, field);
+        }
+        lua_remove(state, -2);
+    }
+}
+
+//------------------------------------------------------------------------------
+void line_state_lua::push_word(lua_State* state, unsigned int index)
+{
+    if (index >= m_line.get_word_count())
+    {
+        lua_pushliteral(state, "");
+        return;
+    }
+
+    push_cache(state, "words");
+    lua_rawgeti(state, -1, index + 1);
+    if (lua_isnil(state, -1))
+    {
+        lua_pop(state, 1);
+
+        str<32> word;
+        m_line.get_word(index, word);
+        lua_pushlstring(state, word.c_str(), word.length());
+        lua_pushvalue(state, -1);
+        lua_rawseti(state, -3, index + 1);
+    }
+    lua_remove(state, -2);
+}
+
+//------------------------------------------------------------------------------
+void line_state_lua::push_word_view(lua_State* state, unsigned int index)
+{
+    push_cache(state, "views");
+    lua_rawgeti(state, -1, index + 1);
+    if (lua_isnil(state, -1))
+    {
+        lua_pop(state, 1);
+        push_new_word_view(state, m_line.get_words()[index]);
+        lua_pushvalue(state, -1);
+        lua_rawseti(state, -3, index + 1);
+    }
+    lua_remove(state, -2);
+}
+
 //------------------------------------------------------------------------------
 /// -name:  line_state:getline
 /// -ver:   1.0.0
@@ -36,7 +207,15 @@ line_state_lua::line_state_lua(const line_state& line)
 /// Returns the current line in its entirety.
 int line_state_lua::get_line(lua_State* state)
 {
-    lua_pushstring(state, m_line.get_line());
+    push_cache(state, nullptr);
+    lua_getfield(state, -1, "line");
+    if (lua_isnil(state, -1))
+    {
+        lua_pop(state, 1);
+        lua_pushstring(state, m_line.get_line());
+        lua_pushvalue(state, -1);
+        lua_setfield(state, -3, "line");
+    }
     return 1;
 }
 
@@ -183,10 +362,8 @@ int line_state_lua::get_word(lua_State* state)
     if (!lua_isnumber(state, 1))
         return 0;
 
-    str<32> word;
     unsigned int index = int(lua_tointeger(state, 1)) - 1;
-    m_line.get_word(index, word);
-    lua_pushlstring(state, word.c_str(), word.length());
+    push_word(state, index);
     return 1;
 }
 
@@ -207,8 +384,74 @@ int line_state_lua::get_word(lua_State* state)
 /// -show:  line_state:getword(line_state:getwordcount()) == line_state:getendword()
 int line_state_lua::get_end_word(lua_State* state)
 {
-    str<32> word;
-    m_line.get_end_word(word);
-    lua_pushlstring(state, word.c_str(), word.length());
+    push_word(state, m_line.get_word_count() - 1);
+    return 1;
+}
+
+//------------------------------------------------------------------------------
+/// -name:  line_state:getwordview
+/// -ver:   1.2.46
+/// -arg:   index:integer
+/// -ret:   userdata
+/// Returns a read-only view of information about the Nth word in the line.  It
+/// has the same fields as the table returned by
+/// <a href="#line_state:getwordinfo">line_state:getwordinfo()</a>, but the
+/// same view is returned each time, so it's cheaper when called repeatedly
+/// (e.g. once per word while parsing the line).  The view cannot be modified.
+/// -show:  local info = line_state:getwordview(word_index)
+/// -show:  local raw = line_state:getline():sub(info.offset, info.offset + info.length - 1)
+int line_state_lua::get_word_view(lua_State* state)
+{
+    if (!lua_isnumber(state, 1))
+        return 0;
+
+    unsigned int index = int(lua_tointeger(state, 1)) - 1;
+    if (index >= m_line.get_word_count())
+        return 0;
+
+    push_word_view(state, index);
+    return 1;
+}
+
+//------------------------------------------------------------------------------
+/// -name:  line_state:getwordviews
+/// -ver:   1.2.46
+/// -ret:   table
+/// Returns a table containing a read-only view for each word in the line, as
+/// returned by <a href="#line_state:getwordview">line_state:getwordview()</a>.
+/// -show:  for i, info in ipairs(line_state:getwordviews()) do
+/// -show:  &nbsp;   print(i, info.offset, info.length, info.quoted)
+/// -show:  end
+int line_state_lua::get_word_views(lua_State* state)
+{
+    const unsigned int count = m_line.get_word_count();
+    lua_createtable(state, count, 0);
+
+    for (unsigned int i = 0; i < count; ++i)
+    {
+        push_word_view(state, i);
+        lua_rawseti(state, -2, i + 1);
+    }
+
+    return 1;
+}
+
+//------------------------------------------------------------------------------
+/// -name:  line_state:getwords
+/// -ver:   1.2.46
+/// -ret:   table
+/// Returns a table containing each word in the line, the same as calling
+/// <a href="#line_state:getword">line_state:getword()</a> for each word.
+int line_state_lua::get_words(lua_State* state)
+{
+    const unsigned int count = m_line.get_word_count();
+    lua_createtable(state, count, 0);
+
+    for (unsigned int i = 0; i < count; ++i)
+    {
+        push_word(state, i);
+        lua_rawseti(state, -2, i + 1);
+    }
+
     return 1;
 }
@@ -14,6 +14,11 @@ class line_state_lua
 {
 public:
                         line_state_lua(const line_state& line);
+                        line_state_lua(line_state_lua&& other);
+                        ~line_state_lua();
+                        line_state_lua(const line_state_lua&) = delete;
+    line_state_lua&     operator = (const line_state_lua&) = delete;
+    const line_state&   get_line_state() const { return m_line; }
     int                 get_line(lua_State* state);
     int                 get_cursor(lua_State* state);
     int                 get_command_offset(lua_State* state);
@@ -22,7 +27,15 @@ public:
     int                 get_word_info(lua_State* state);
     int                 get_word(lua_State* state);
     int                 get_end_word(lua_State* state);
+    int                 get_word_view(lua_State* state);
+    int                 get_word_views(lua_State* state);
+    int                 get_words(lua_State* state);
 
 private:
+    void                push_cache(lua_State* state, const char* field);
+    void                push_word(lua_State* state, unsigned int index);
+    void                push_word_view(lua_State* state, unsigned int index);
     const line_state&   m_line;
+    lua_State*          m_cache_state = nullptr;
+    int                 m_cache_ref = LUA_NOREF;
 };
@@ -28,6 +28,7 @@ public:
                         lua_bindable(const char* name, const method* methods);
                         ~lua_bindable();
     void                push(lua_State* state);
+    static T*           test(lua_State* state, int index);
 
 private:
     static int          call(lua_State* state);
@@ -89,6 +90,10 @@ void lua_bindable<T>::bind()
         }
 
         lua_setfield(m_state, -2, "__index");
+
+        // Tag the metatable so test() can tell which T the userdata binds.
+        lua_pushlightuserdata(m_state, (void*)&lua_bindable<T>::call);
+        lua_setfield(m_state, -2, "__bindable");
     }
 
     lua_setmetatable(m_state, -2);
@@ -132,6 +137,23 @@ void lua_bindable<T>::push(lua_State* state)
 #endif
 }
 
+//------------------------------------------------------------------------------
+// Returns the object bound to the userdata at index, or nullptr if the value
+// isn't a bound T (or the object has been unbound).
+template <class T>
+T* lua_bindable<T>::test(lua_State* state, int index)
+{
+    auto* const* self = (T* const*)lua_touserdata(state, index);
+    if (self == nullptr || !lua_getmetatable(state, index))
+        return nullptr;
+
+    lua_getfield(state, -1, "__bindable");
+    const bool match = (lua_touserdata(state, -1) == (void*)&lua_bindable<T>::call);
+    lua_pop(state, 2);
+
+    return match ? *self : nullptr;
+}
+
 //------------------------------------------------------------------------------
 template <class T>
 int lua_bindable<T>::call(lua_State* state)
@@ -4,8 +4,10 @@
 #include "pch.h"
 #include "lua_input_idle.h"
 #include "lua_state.h"
+#include "coroutine_scheduler.h"
 
 #include <core/base.h>
+#include <core/os.h>
 
 #include <assert.h>
 
@@ -17,6 +19,11 @@ extern "C" {
 
 //------------------------------------------------------------------------------
 extern void set_io_wake_event(HANDLE event);
+extern long get_io_completion_count();
+
+//------------------------------------------------------------------------------
+// Milliseconds between idle garbage collection steps.
+static const unsigned c_gc_step_interval = 5;
 
 //------------------------------------------------------------------------------
 lua_input_idle::lua_input_idle(lua_state& state)
@@ -39,6 +46,7 @@ void lua_input_idle::reset()
     // reusing the same event handle after it's closed.
     m_enabled = true;
     m_iterations = 0;
+    m_io_completions = get_io_completion_count() - 1; // Check on first idle.
     m_event = CreateEvent(nullptr, false, false, nullptr);
     set_io_wake_event(m_event);
 
@@ -49,13 +57,13 @@ void lua_input_idle::reset()
 //------------------------------------------------------------------------------
 bool lua_input_idle::is_enabled()
 {
-    if (!m_enabled)
-        return false;
-
-    if (!has_coroutines())
+    if (m_enabled && !has_coroutines())
         m_enabled = false;
 
-    return m_enabled;
+    // Garbage collection keeps the idle loop running until it catches up.
+    m_gc_pending = m_state.is_gc_pending();
+
+    return m_enabled || m_gc_pending;
 }
 
 //------------------------------------------------------------------------------
@@ -63,28 +71,21 @@ unsigned lua_input_idle::get_timeout()
 {
     m_iterations++;
 
-    lua_State* state = m_state.get_state();
-    save_stack_top ss(state);
-
-    // Call to Lua to check for coroutines.
-    lua_getglobal(state, "clink");
-    lua_pushliteral(state, "_wait_duration");
-    lua_rawget(state, -2);
-
-    if (m_state.pcall(state, 0, 1) != 0)
-    {
-        if (const char* error = lua_tostring(state, -1))
-            m_state.print_error(error);
+    // Collect garbage in small steps while no input is waiting, with a short
+    // pause between steps so the idle loop doesn't spin.
+    const unsigned gc_timeout = m_gc_pending ? c_gc_step_interval : INFINITE;
 
-        return INFINITE;
-    }
+    // Coroutines waiting in io.popenyield() don't influence the timeout; the
+    // wait event wakes up the idle loop when their commands finish.
+    coroutine_scheduler* scheduler = m_enabled ? coroutine_scheduler::get(m_state.get_state()) : nullptr;
+    if (!scheduler)
+        return gc_timeout;
 
-    int isnum;
-    double sec = lua_tonumberx(state, -1, &isnum);
-    if (!isnum)
-        return INFINITE;
+    double sec = scheduler->get_wait_duration(os::clock());
+    if (sec < 0)
+        return gc_timeout;
 
-    return (sec > 0) ? unsigned(sec * 1000) : 0;
+    return min<unsigned>(gc_timeout, (sec > 0) ? unsigned(sec * 1000) : 0);
 }
 
 //------------------------------------------------------------------------------
@@ -99,32 +100,30 @@ void* lua_input_idle::get_waitevent()
 //------------------------------------------------------------------------------
 void lua_input_idle::on_idle()
 {
-    assert(m_enabled);
+    assert(m_enabled || m_gc_pending);
 
-    resume_coroutines();
+    if (m_enabled)
+    {
+        // Only enter Lua when a coroutine is due, or when a popenyield command
+        // has finished and its coroutine needs to be made ready.
+        const long io_completions = get_io_completion_count();
+        const bool io_completed = (io_completions != m_io_completions);
+        m_io_completions = io_completions;
+
+        coroutine_scheduler* scheduler = coroutine_scheduler::get(m_state.get_state());
+        if (io_completed || !scheduler || scheduler->has_due(os::clock()))
+            resume_coroutines();
+    }
+
+    if (m_gc_pending)
+        m_state.gc_step();
 }
 
 //------------------------------------------------------------------------------
 bool lua_input_idle::has_coroutines()
 {
-    lua_State* state = m_state.get_state();
-    save_stack_top ss(state);
-
-    // Call to Lua to check for coroutines.
-    lua_getglobal(state, "clink");
-    lua_pushliteral(state, "_has_coroutines");
-    lua_rawget(state, -2);
-
-    if (m_state.pcall(state, 0, 1) != 0)
-    {
-        if (const char* error = lua_tostring(state, -1))
-            m_state.print_error(error);
-
-        return false;
-    }
-
-    bool has = lua_toboolean(state, -1);
-    return has;
+    coroutine_scheduler* scheduler = coroutine_scheduler::get(m_state.get_state());
+    return scheduler && scheduler->has_coroutines();
 }
 
 //------------------------------------------------------------------------------
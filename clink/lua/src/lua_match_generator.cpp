@@ -49,6 +49,7 @@ bool lua_match_generator::generate(const line_state& line, match_builder& builde
 {
     lua_State* state = m_state.get_state();
     save_stack_top ss(state);
+    gc_latency_scope gc(m_state);
 
     // Backward compatibility shim.
     if (true)
@@ -92,6 +93,31 @@ bool lua_match_generator::generate(const line_state& line, match_builder& builde
     return !!use_matches;
 }
 
+//------------------------------------------------------------------------------
+bool lua_match_generator::can_preload(const line_state& line)
+{
+    lua_State* state = m_state.get_state();
+    save_stack_top ss(state);
+
+    // Call to Lua to check whether any generator opts out of preloading.
+    lua_getglobal(state, "clink");
+    lua_pushliteral(state, "_can_preload");
+    lua_rawget(state, -2);
+
+    line_state_lua line_lua(line);
+    line_lua.push(state);
+
+    if (m_state.pcall(state, 1, 1) != 0)
+    {
+        if (const char* error = lua_tostring(state, -1))
+            m_state.print_error(error);
+
+        return false;
+    }
+
+    return !!lua_toboolean(state, -1);
+}
+
 //------------------------------------------------------------------------------
 void lua_match_generator::get_word_break_info(const line_state& line, word_break_info& info) const
 {
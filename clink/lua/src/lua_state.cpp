@@ -7,10 +7,14 @@
 #include "rl_buffer_lua.h"
 #include "line_state_lua.h"
 
+#include <core/base.h>
+#include <core/latency.h>
 #include <core/settings.h>
 #include <core/str.h>
 #include <core/str_tokeniser.h>
 #include <core/os.h>
+#include <core/path.h>
+#include <core/str_hash.h>
 
 #include <memory>
 #include <assert.h>
@@ -45,6 +49,14 @@ static setting_str g_lua_path(
     "in require() statements.",
     "");
 
+static setting_bool g_lua_idle_gc(
+    "lua.idle_gc",
+    "Collect Lua garbage while idle",
+    "When enabled, the Lua garbage collector is throttled while generating\n"
+    "matches and classifying words, and collection work is done in small steps\n"
+    "while waiting for input instead.  This avoids latency spikes while typing.",
+    true);
+
 static setting_bool g_lua_tracebackonerror(
     "lua.traceback_on_error",
     "Prints stack trace on Lua errors",
@@ -83,6 +95,9 @@ void rl_lua_initialise(lua_state&);
 void settings_lua_initialise(lua_state&);
 void string_lua_initialise(lua_state&);
 void log_lua_initialise(lua_state&);
+void argmatcher_lua_initialise(lua_state&);
+void scheduler_lua_initialise(lua_state&);
+void cache_lua_initialise(lua_state&);
 
 
 
@@ -170,6 +185,39 @@ const char* optstring(lua_State* state, int index, const char* default_value)
 
 
 
+//------------------------------------------------------------------------------
+// UNDOCUMENTED; internal use only.
+static int get_lua_gc_stats(lua_State* state)
+{
+    const lua_state* self = (const lua_state*)lua_touserdata(state, lua_upvalueindex(1));
+    const lua_gc_stats& stats = self->get_gc_stats();
+
+    struct {
+        const char* name;
+        lua_Number  value;
+    } fields[] = {
+        { "heap_kb",        lua_Number(lua_gc(state, LUA_GCCOUNT, 0)) },
+        { "peak_kb",        lua_Number(stats.peak_kb) },
+        { "baseline_kb",    lua_Number(stats.baseline_kb) },
+        { "steps",          lua_Number(stats.steps) },
+        { "cycles",         lua_Number(stats.cycles) },
+        { "total_time",     stats.total_time },
+        { "max_time",       stats.max_time },
+        { "deferred",       lua_Number(stats.deferred) },
+    };
+
+    lua_createtable(state, 0, sizeof_array(fields));
+    for (const auto& field : fields)
+    {
+        lua_pushnumber(state, field.value);
+        lua_setfield(state, -2, field.name);
+    }
+
+    return 1;
+}
+
+
+
 //------------------------------------------------------------------------------
 bool lua_state::s_in_luafunc = false;
 
@@ -195,6 +243,13 @@ void lua_state::initialise()
     m_state = luaL_newstate();
     luaL_openlibs(m_state);
 
+    // Lua 5.2's generational mode is experimental (and was removed in 5.3), so
+    // use the incremental collector; gc_step() does most of the work while
+    // waiting for input.
+    lua_gc(m_state, LUA_GCINC, 0);
+    m_gc_stats = lua_gc_stats();
+    m_gc_throttled = false;
+
     // Set up the package.path value for require() statements.
     str<280> path;
     if (!os::get_env("lua_path_" LUA_VERSION_MAJOR "_" LUA_VERSION_MINOR, path))
@@ -229,6 +284,15 @@ void lua_state::initialise()
     settings_lua_initialise(self);
     string_lua_initialise(self);
     log_lua_initialise(self);
+    argmatcher_lua_initialise(self);
+    scheduler_lua_initialise(self);
+    cache_lua_initialise(self);
+
+    lua_getglobal(m_state, "clink");
+    lua_pushlightuserdata(m_state, this);
+    lua_pushcclosure(m_state, get_lua_gc_stats, 1);
+    lua_setfield(m_state, -2, "_get_gc_stats");
+    lua_pop(m_state, 1);
 
     // Load the debugger.
     if (g_force_load_debugger || g_lua_debug.get())
@@ -269,11 +333,151 @@ bool lua_state::do_string(const char* string, int length)
 }
 
 //------------------------------------------------------------------------------
-bool lua_state::do_file(const char* path)
+// A cached chunk is a header, the script's path, and then the chunk as written
+// by lua_dump().  The size and last write time of the script must match for
+// the chunk to be used.  Chunks aren't portable between architectures (e.g.
+// x86 and x64 builds of Clink sharing a profile directory), so the sizes that
+// lua_dump() bakes into the chunk are part of the header as well.
+struct bytecode_cache_header
+{
+    enum { c_magic = 0x634c6263 };  // 'cbLc'
+
+    unsigned int        magic;
+    unsigned int        lua_version;
+    unsigned int        lua_abi;
+    unsigned long long  size;
+    unsigned long long  mtime;
+    unsigned int        path_len;
+};
+
+//------------------------------------------------------------------------------
+static unsigned int get_bytecode_abi()
+{
+    return ((unsigned int)(sizeof(void*)) << 24 |
+            (unsigned int)(sizeof(size_t)) << 16 |
+            (unsigned int)(sizeof(lua_Number)) << 8 |
+            (unsigned int)(sizeof(int)));
+}
+
+//------------------------------------------------------------------------------
+static bool get_bytecode_cache_key(const char* path, const char* cache_dir, bytecode_cache_header& header, str_base& cache_file)
+{
+    memset(&header, 0, sizeof(header));
+    if (!os::get_file_stamp(path, header.size, header.mtime))
+        return false;
+
+    header.magic = bytecode_cache_header::c_magic;
+    header.lua_version = LUA_VERSION_NUM;
+    header.lua_abi = get_bytecode_abi();
+    header.path_len = (unsigned int)(strlen(path));
+
+    // Separate names per architecture, so x86 and x64 don't keep replacing
+    // each other's cache entries.
+    str<32> name;
+    name.format("%08x_%u.luac", str_hash(path), (unsigned int)(sizeof(void*) * 8));
+    cache_file = cache_dir;
+    return path::append(cache_file, name.c_str());
+}
+
+//------------------------------------------------------------------------------
+static bool load_bytecode_cache(lua_State* state, const char* path, const char* cache_file, const bytecode_cache_header& key)
+{
+    wstr<280> wcache_file(cache_file);
+    FILE* file = _wfopen(wcache_file.c_str(), L"rb");
+    if (!file)
+        return false;
+
+    bool ok = false;
+    bytecode_cache_header header;
+    if (fread(&header, sizeof(header), 1, file) == 1 &&
+        memcmp(&header, &key, sizeof(header)) == 0)
+    {
+        fseek(file, 0, SEEK_END);
+        const long total = ftell(file);
+        const long offset = long(sizeof(header) + header.path_len);
+        if (total > offset)
+        {
+            std::unique_ptr<char[]> data(new char[total - offset + header.path_len]);
+            char* cached_path = data.get();
+            char* chunk = data.get() + header.path_len;
+            fseek(file, long(sizeof(header)), SEEK_SET);
+            if (fread(data.get(), total - sizeof(header), 1, file) == 1 &&
+                memcmp(cached_path, path, header.path_len) == 0)
+            {
+                // Use the same chunk name as luaL_loadfile() so error messages
+                // and debug info are unaffected by the cache.
+                str<280> chunkname;
+                chunkname << "@" << path;
+                ok = !luaL_loadbufferx(state, chunk, total - offset, chunkname.c_str(), "b");
+                if (!ok)
+                    lua_pop(state, 1);
+            }
+        }
+    }
+
+    fclose(file);
+    return ok;
+}
+
+//------------------------------------------------------------------------------
+static int write_bytecode_chunk(lua_State* state, const void* p, size_t size, void* ud)
+{
+    return fwrite(p, size, 1, (FILE*)ud) == 1 ? 0 : 1;
+}
+
+//------------------------------------------------------------------------------
+struct bytecode_cache_entry
+{
+    lua_State*                      state;
+    const char*                     path;
+    const bytecode_cache_header&    header;
+};
+
+//------------------------------------------------------------------------------
+static bool write_bytecode_cache(FILE* file, void* param)
+{
+    const bytecode_cache_entry& entry = *(const bytecode_cache_entry*)param;
+    return (fwrite(&entry.header, sizeof(entry.header), 1, file) == 1 &&
+            fwrite(entry.path, entry.header.path_len, 1, file) == 1 &&
+            lua_dump(entry.state, write_bytecode_chunk, file) == 0);
+}
+
+//------------------------------------------------------------------------------
+static void save_bytecode_cache(lua_State* state, const char* path, const char* cache_file, const bytecode_cache_header& header)
+{
+    bytecode_cache_entry entry = { state, path, header };
+    os::atomic_write_file(cache_file, &write_bytecode_cache, &entry);
+}
+
+//------------------------------------------------------------------------------
+// Pushes the compiled chunk for the script, or an error message.  Returns the
+// status from loading the chunk, the same as luaL_loadfile().
+int lua_state::load_file(lua_State* state, const char* path, const char* cache_dir)
+{
+    bytecode_cache_header key;
+    str<280> cache_file;
+    if (cache_dir && *cache_dir && get_bytecode_cache_key(path, cache_dir, key, cache_file))
+    {
+        if (load_bytecode_cache(state, path, cache_file.c_str(), key))
+            return LUA_OK;
+
+        // Cache the chunk before running it; lua_dump() needs the function
+        // on the top of the stack.
+        const int status = luaL_loadfile(state, path);
+        if (status == LUA_OK && os::make_dir(cache_dir))
+            save_bytecode_cache(state, path, cache_file.c_str(), key);
+        return status;
+    }
+
+    return luaL_loadfile(state, path);
+}
+
+//------------------------------------------------------------------------------
+bool lua_state::do_file(const char* path, const char* cache_dir)
 {
     save_stack_top ss(m_state);
 
-    bool ok = !luaL_loadfile(m_state, path);
+    bool ok = (load_file(m_state, path, cache_dir) == LUA_OK);
     if (ok)
         ok = !pcall(0, LUA_MULTRET);
     else if (const char* error = lua_tostring(m_state, -1))
@@ -581,6 +785,89 @@ void lua_state::print_error(const char* error)
     puts(error);
 }
 
+//------------------------------------------------------------------------------
+// The collector has work to do when the heap has grown noticeably since the
+// last cycle that an idle step finished.
+bool lua_state::is_gc_pending() const
+{
+    if (!g_lua_idle_gc.get() || m_latency_depth)
+        return false;
+
+    const unsigned int kb = (unsigned int)(lua_gc(m_state, LUA_GCCOUNT, 0));
+    const unsigned int baseline = m_gc_stats.baseline_kb;
+    return kb > baseline + max<unsigned int>(baseline / 8, 64);
+}
+
+//------------------------------------------------------------------------------
+void lua_state::gc_step()
+{
+    latency_span span(latency_phase::gc);
+
+    // Scale the step to the heap size so that a cycle finishes within a bounded
+    // number of idle wakeups, no matter how large the heap has grown.
+    const unsigned int step = max<unsigned int>(unsigned(lua_gc(m_state, LUA_GCCOUNT, 0)) / 16, 64);
+
+    const double start = os::clock();
+    const bool finished = !!lua_gc(m_state, LUA_GCSTEP, int(step));
+    const double elapsed = os::clock() - start;
+
+    const unsigned int kb = (unsigned int)(lua_gc(m_state, LUA_GCCOUNT, 0));
+    m_gc_stats.steps++;
+    m_gc_stats.total_time += elapsed;
+    if (m_gc_stats.max_time < elapsed)
+        m_gc_stats.max_time = elapsed;
+    if (m_gc_stats.peak_kb < kb)
+        m_gc_stats.peak_kb = kb;
+    if (finished)
+    {
+        m_gc_stats.cycles++;
+        m_gc_stats.baseline_kb = kb;
+    }
+}
+
+//------------------------------------------------------------------------------
+// While latency-critical, a new cycle doesn't start until the heap has grown to
+// 4x its size after the last cycle, and each step does half the usual work.
+static const int c_latency_gc_pause = 400;
+static const int c_latency_gc_stepmul = 100;
+
+//------------------------------------------------------------------------------
+void lua_state::begin_latency_critical()
+{
+    if (m_latency_depth++)
+        return;
+
+    const unsigned int kb = (unsigned int)(lua_gc(m_state, LUA_GCCOUNT, 0));
+    if (m_gc_stats.peak_kb < kb)
+        m_gc_stats.peak_kb = kb;
+
+    // Throttle the collector rather than stopping it, so the heap growth stays
+    // bounded even if a latency-critical call allocates heavily.  Leave it
+    // alone if a script has stopped it.
+    if (g_lua_idle_gc.get() && lua_gc(m_state, LUA_GCISRUNNING, 0))
+    {
+        m_saved_gc_pause = lua_gc(m_state, LUA_GCSETPAUSE, c_latency_gc_pause);
+        m_saved_gc_stepmul = lua_gc(m_state, LUA_GCSETSTEPMUL, c_latency_gc_stepmul);
+        m_gc_throttled = true;
+        m_gc_stats.deferred++;
+    }
+}
+
+//------------------------------------------------------------------------------
+void lua_state::end_latency_critical()
+{
+    assert(m_latency_depth > 0);
+    if (--m_latency_depth)
+        return;
+
+    if (m_gc_throttled)
+    {
+        lua_gc(m_state, LUA_GCSETPAUSE, m_saved_gc_pause);
+        lua_gc(m_state, LUA_GCSETSTEPMUL, m_saved_gc_stepmul);
+        m_gc_throttled = false;
+    }
+}
+
 //------------------------------------------------------------------------------
 #ifdef DEBUG
 void lua_state::dump_stack(int pos)
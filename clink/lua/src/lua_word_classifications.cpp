@@ -103,6 +103,18 @@ int lua_word_classifications::classify_word(lua_State* state)
     return 0;
 }
 
+//------------------------------------------------------------------------------
+// Native counterpart of classifyword, for callers that already validated the
+// word class code.  Returns false if the index is out of bounds.
+bool lua_word_classifications::classify(unsigned int index, char wc, bool overwrite)
+{
+    if (index >= m_num_words)
+        return false;
+
+    m_classifications.classify_word(m_index_offset + index, wc, overwrite);
+    return true;
+}
+
 //------------------------------------------------------------------------------
 /// -name:  word_classifications:applycolor
 /// -ver:   1.1.49
@@ -146,5 +158,6 @@ int lua_word_classifications::apply_color(lua_State* state)
         return 0;
 
     m_classifications.apply_face(start, length, face, overwrite);
+    m_classifications.set_command_extent(m_index_offset, start, start + length);
     return 0;
 }
@@ -19,6 +19,10 @@ extern "C" {
 #include <lualib.h>
 }
 
+//------------------------------------------------------------------------------
+extern unsigned int get_argmatcher_generation();
+extern bool get_classifiers_only_changed();
+
 //------------------------------------------------------------------------------
 word_class to_word_class(char wc)
 {
@@ -40,10 +44,11 @@ lua_word_classifier::lua_word_classifier(lua_state& state)
 }
 
 //------------------------------------------------------------------------------
-void lua_word_classifier::classify(const std::vector<line_state>& commands, word_classifications& classifications)
+void lua_word_classifier::classify(const std::vector<line_state>& commands, const std::vector<unsigned int>& word_indices, word_classifications& classifications)
 {
     lua_State* state = m_state.get_state();
     save_stack_top ss(state);
+    gc_latency_scope gc(m_state);
 
     // Call to Lua to generate matches.
     lua_getglobal(state, "clink");
@@ -56,10 +61,12 @@ void lua_word_classifier::classify(const std::vector<line_state>& commands, word
     std::vector<lua_word_classifications> wordclassifications;
     linestates.reserve(commands.size());
     wordclassifications.reserve(commands.size());
-    for (const auto& line : commands)
+    assert(commands.size() == word_indices.size());
+    for (size_t ii = 0; ii < commands.size(); ++ii)
     {
+        const line_state& line = commands[ii];
         linestates.emplace_back(line);
-        wordclassifications.emplace_back(classifications, classifications.add_command(line), line.get_command_word_index(), line.get_word_count());
+        wordclassifications.emplace_back(classifications, word_indices[ii], line.get_command_word_index(), line.get_word_count());
     }
 
     // Package the lua objects into a table.
@@ -86,3 +93,15 @@ void lua_word_classifier::classify(const std::vector<line_state>& commands, word
         return;
     }
 }
+
+//------------------------------------------------------------------------------
+unsigned int lua_word_classifier::get_generation()
+{
+    return get_argmatcher_generation();
+}
+
+//------------------------------------------------------------------------------
+bool lua_word_classifier::can_skip_unchanged()
+{
+    return get_classifiers_only_changed();
+}
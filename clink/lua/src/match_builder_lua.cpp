@@ -13,6 +13,7 @@
 static match_builder_lua::method g_methods[] = {
     { "addmatch",           &match_builder_lua::add_match },
     { "addmatches",         &match_builder_lua::add_matches },
+    { "addmatcharrays",     &match_builder_lua::add_match_arrays },
     { "setappendcharacter", &match_builder_lua::set_append_character },
     { "setsuppressappend",  &match_builder_lua::set_suppress_append },
     { "setsuppressquoting", &match_builder_lua::set_suppress_quoting },
@@ -24,6 +25,93 @@ static match_builder_lua::method g_methods[] = {
 
 
 
+//------------------------------------------------------------------------------
+// Lua interns short strings, so matches that use the same type string usually
+// share the same pointer and can reuse the parsed type.
+class match_type_cache
+{
+public:
+    match_type get(const char* str)
+    {
+        if (str != m_str)
+        {
+            m_str = str;
+            m_type = to_match_type(str);
+        }
+        return m_type;
+    }
+
+private:
+    const char* m_str = nullptr;
+    match_type  m_type = match_type::none;
+};
+
+//------------------------------------------------------------------------------
+// Returns the string at index if it's really a string.  Numbers return nullptr
+// and set convert, because lua_tostring() converts them in place on the stack,
+// and the result doesn't stay valid after the value is popped.
+static const char* get_anchored_string(lua_State* state, int index, bool& convert)
+{
+    switch (lua_type(state, index))
+    {
+    case LUA_TSTRING:   return lua_tostring(state, index);
+    case LUA_TNUMBER:   convert = true; break;
+    }
+    return nullptr;
+}
+
+//------------------------------------------------------------------------------
+// Fills desc from the string or table at index (which must be absolute).
+// Returns 1 on success, 0 if the value isn't a match, or -1 if a value must be
+// converted and the match must be added while it's still on the stack.
+static int get_match_desc(lua_State* state, int index, match_type type, match_type_cache& types, match_desc& desc)
+{
+    bool convert = false;
+    desc = {};
+    desc.type = type;
+
+    if (lua_istable(state, index))
+    {
+        lua_pushliteral(state, "match");
+        lua_rawget(state, index);
+        desc.match = get_anchored_string(state, -1, convert);
+        lua_pop(state, 1);
+
+        lua_pushliteral(state, "type");
+        lua_rawget(state, index);
+        if (const char* type_str = get_anchored_string(state, -1, convert))
+            desc.type = types.get(type_str);
+        lua_pop(state, 1);
+
+        lua_pushliteral(state, "display");
+        lua_rawget(state, index);
+        desc.display = get_anchored_string(state, -1, convert);
+        lua_pop(state, 1);
+
+        lua_pushliteral(state, "description");
+        lua_rawget(state, index);
+        desc.description = get_anchored_string(state, -1, convert);
+        lua_pop(state, 1);
+
+        // Undocumented; for internal use only.
+        lua_pushliteral(state, "appenddisplay");
+        lua_rawget(state, index);
+        if (lua_isboolean(state, -1))
+            desc.append_display = lua_toboolean(state, -1);
+        lua_pop(state, 1);
+    }
+    else
+    {
+        desc.match = get_anchored_string(state, index, convert);
+    }
+
+    if (convert)
+        return -1;
+    return desc.match ? 1 : 0;
+}
+
+
+
 //------------------------------------------------------------------------------
 match_builder_lua::match_builder_lua(match_builder& builder)
 : lua_bindable<match_builder_lua>("match_builder_lua", g_methods)
@@ -237,20 +325,179 @@ int match_builder_lua::add_matches(lua_State* state)
 
     match_type type = to_match_type(type_str);
 
+    // Collect the matches and add them in one batch.  The strings stay valid
+    // because the table on the stack anchors them.
     int count = 0;
     int total = int(lua_rawlen(state, 1));
+    std::vector<match_desc> descs;
+    descs.reserve(total);
+    match_type_cache types;
     for (int i = 1; i <= total; ++i)
     {
         lua_rawgeti(state, 1, i);
-        count += !!add_match_impl(state, -1, type);
+
+        match_desc desc;
+        switch (get_match_desc(state, lua_gettop(state), type, types, desc))
+        {
+        case 1:
+            descs.emplace_back(desc);
+            break;
+        case -1:
+            count += flush_matches(descs);
+            count += !!add_match_impl(state, -1, type);
+            break;
+        }
+
         lua_pop(state, 1);
     }
+    count += flush_matches(descs);
+
+    lua_pushinteger(state, count);
+    lua_pushboolean(state, count == total);
+    return 2;
+}
+
+//------------------------------------------------------------------------------
+/// -name:  builder:addmatcharrays
+/// -ver:   1.2.46
+/// -arg:   arrays:table
+/// -arg:   [type:string]
+/// -ret:   integer, boolean
+/// Adds many matches at once, from parallel arrays.  This is faster than
+/// <a href="#builder:addmatches">builder:addmatches()</a> for generators that
+/// produce very many matches, because it avoids creating a table per match.
+/// Returns the number of matches added and a boolean indicating if all matches
+/// were added successfully.
+///
+/// The <span class="arg">arrays</span> argument is a table with the following
+/// scheme:
+/// -show:  {
+/// -show:  &nbsp;   match       = {...}    -- [table] The match strings.
+/// -show:  &nbsp;   display     = {...}    -- [table] OPTIONAL; display strings for the matches.
+/// -show:  &nbsp;   description = {...}    -- [table] OPTIONAL; descriptions for the matches.
+/// -show:  &nbsp;   type        = {...}    -- [table] OPTIONAL; match types for the matches.
+/// -show:  }
+///
+/// The Nth element of each optional table applies to the Nth match; the
+/// optional tables can be shorter than <code>match</code>, or have gaps.  The
+/// <span class="arg">type</span> argument is used as the type when a match
+/// doesn't have a type in <code>arrays.type</code>, and is "none" if omitted.
+/// -show:  builder:addmatcharrays({ match=package_names }, "word")
+/// -show:  builder:addmatcharrays({
+/// -show:  &nbsp;   match       = { "--help", "--version" },
+/// -show:  &nbsp;   description = { "Show help", "Show version" },
+/// -show:  }, "arg")
+int match_builder_lua::add_match_arrays(lua_State* state)
+{
+    if (lua_gettop(state) <= 0 || !lua_istable(state, 1))
+    {
+        lua_pushinteger(state, 0);
+        lua_pushboolean(state, 0);
+        return 2;
+    }
+
+    const char* type_str = optstring(state, 2, "");
+    if (!type_str)
+        return 0;
+
+    match_type type = to_match_type(type_str);
 
+    // Push the arrays in a fixed order; missing ones are nil.
+    static const char* const c_fields[] = { "match", "display", "description", "type" };
+    const int base = lua_gettop(state);
+    for (const char* field : c_fields)
+    {
+        lua_pushstring(state, field);
+        lua_rawget(state, 1);
+        if (!lua_istable(state, -1))
+        {
+            lua_pop(state, 1);
+            lua_pushnil(state);
+        }
+    }
+    const int matches = base + 1;
+    const int displays = base + 2;
+    const int descriptions = base + 3;
+    const int match_types = base + 4;
+
+    if (lua_isnil(state, matches))
+    {
+        lua_settop(state, base);
+        lua_pushinteger(state, 0);
+        lua_pushboolean(state, 0);
+        return 2;
+    }
+
+    int count = 0;
+    int total = int(lua_rawlen(state, matches));
+    std::vector<match_desc> descs;
+    descs.reserve(total);
+    match_type_cache types;
+    for (int i = 1; i <= total; ++i)
+    {
+        bool convert = false;
+        match_desc desc = {};
+        desc.type = type;
+
+        lua_rawgeti(state, matches, i);
+        desc.match = get_anchored_string(state, -1, convert);
+        if (!lua_isnil(state, displays))
+        {
+            lua_rawgeti(state, displays, i);
+            desc.display = get_anchored_string(state, -1, convert);
+        }
+        if (!lua_isnil(state, descriptions))
+        {
+            lua_rawgeti(state, descriptions, i);
+            desc.description = get_anchored_string(state, -1, convert);
+        }
+        if (!lua_isnil(state, match_types))
+        {
+            lua_rawgeti(state, match_types, i);
+            if (const char* t = get_anchored_string(state, -1, convert))
+                desc.type = types.get(t);
+        }
+
+        if (convert)
+        {
+            // Convert while the values are still on the stack, and add the
+            // match before popping them.
+            count += flush_matches(descs);
+            int index = match_types + 1;
+            desc.match = lua_tostring(state, index++);
+            if (!lua_isnil(state, displays))
+                desc.display = lua_tostring(state, index++);
+            if (!lua_isnil(state, descriptions))
+                desc.description = lua_tostring(state, index++);
+            if (desc.match)
+                count += !!m_builder.add_match(desc);
+        }
+        else if (desc.match)
+        {
+            descs.emplace_back(desc);
+        }
+
+        lua_settop(state, match_types);
+    }
+    count += flush_matches(descs);
+
+    lua_settop(state, base);
     lua_pushinteger(state, count);
     lua_pushboolean(state, count == total);
     return 2;
 }
 
+//------------------------------------------------------------------------------
+unsigned int match_builder_lua::flush_matches(std::vector<match_desc>& descs)
+{
+    if (descs.empty())
+        return 0;
+
+    const unsigned int added = m_builder.add_matches(descs.data(), (unsigned int)(descs.size()));
+    descs.clear();
+    return added;
+}
+
 //------------------------------------------------------------------------------
 bool match_builder_lua::add_match_impl(lua_State* state, int stack_index, match_type type)
 {
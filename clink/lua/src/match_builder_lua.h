@@ -5,8 +5,11 @@
 
 #include "lua_bindable.h"
 
+#include <vector>
+
 class match_builder;
 struct lua_State;
+struct match_desc;
 enum class match_type : unsigned char;
 
 //------------------------------------------------------------------------------
@@ -16,8 +19,10 @@ class match_builder_lua
 public:
                     match_builder_lua(match_builder& builder);
                     ~match_builder_lua();
+    match_builder&  get_builder() const { return m_builder; }
     int             add_match(lua_State* state);
     int             add_matches(lua_State* state);
+    int             add_match_arrays(lua_State* state);
     int             set_append_character(lua_State* state);
     int             set_suppress_append(lua_State* state);
     int             set_suppress_quoting(lua_State* state);
@@ -27,5 +32,6 @@ public:
 
 private:
     bool            add_match_impl(lua_State* state, int stack_index, match_type type);
+    unsigned int    flush_matches(std::vector<match_desc>& descs);
     match_builder&  m_builder;
 };
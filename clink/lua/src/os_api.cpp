@@ -3,24 +3,29 @@
 
 #include "pch.h"
 #include "lua_state.h"
+#include "match_builder_lua.h"
 
 #include <core/base.h>
+#include <core/exec_index.h>
 #include <core/globber.h>
 #include <core/os.h>
 #include <core/path.h>
 #include <core/settings.h>
 #include <core/str.h>
 #include <core/str_iter.h>
+#include <lib/matches.h>
 #include <process/process.h>
 #include <sys/utime.h>
 #include <ntverp.h> // for VER_PRODUCTMAJORVERSION to deduce SDK version
 #include <assert.h>
 
 #include <memory>
+#include <vector>
 
 //------------------------------------------------------------------------------
 extern setting_bool g_glob_hidden;
 extern setting_bool g_glob_system;
+extern setting_bool g_glob_cache;
 
 //------------------------------------------------------------------------------
 extern "C" void __cdecl __acrt_errno_map_os_error(unsigned long const oserrno);
@@ -257,6 +262,62 @@ static void add_type_tag(str_base& out, const char* tag)
     out << tag;
 }
 
+//------------------------------------------------------------------------------
+static void push_glob_entry(lua_State* state, const str_base& file, const globber::extrainfo& info, int extrainfo)
+{
+    if (!extrainfo)
+    {
+        lua_pushlstring(state, file.c_str(), file.length());
+        return;
+    }
+
+    lua_createtable(state, 0, 2);
+
+    lua_pushliteral(state, "name");
+    lua_pushlstring(state, file.c_str(), file.length());
+    lua_rawset(state, -3);
+
+    str<16> type;
+    add_type_tag(type, (info.attr & FILE_ATTRIBUTE_DIRECTORY) ? "dir" : "file");
+#ifdef S_ISLNK
+    if (S_ISLNK(info.st_mode))
+    {
+        add_type_tag(type, "link");
+        wstr<288> wfile(file.c_str());
+        struct _stat64 st;
+        if (_wstat64(wfile.c_str(), &st) < 0)
+            add_type_tag(type, "orphaned");
+    }
+#endif
+    if (info.attr & FILE_ATTRIBUTE_HIDDEN)
+        add_type_tag(type, "hidden");
+    if (info.attr & FILE_ATTRIBUTE_READONLY)
+        add_type_tag(type, "readonly");
+
+    lua_pushliteral(state, "type");
+    lua_pushlstring(state, type.c_str(), type.length());
+    lua_rawset(state, -3);
+
+    if (extrainfo >= 2)
+    {
+        lua_pushliteral(state, "atime");
+        lua_pushnumber(state, lua_Number(os::filetime_to_time_t(info.accessed)));
+        lua_rawset(state, -3);
+
+        lua_pushliteral(state, "mtime");
+        lua_pushnumber(state, lua_Number(os::filetime_to_time_t(info.modified)));
+        lua_rawset(state, -3);
+
+        lua_pushliteral(state, "ctime");
+        lua_pushnumber(state, lua_Number(os::filetime_to_time_t(info.created)));
+        lua_rawset(state, -3);
+
+        lua_pushliteral(state, "size");
+        lua_pushnumber(state, lua_Number(info.size));
+        lua_rawset(state, -3);
+    }
+}
+
 //------------------------------------------------------------------------------
 int glob_impl(lua_State* state, bool dirs_only, bool back_compat=false)
 {
@@ -278,69 +339,17 @@ int glob_impl(lua_State* state, bool dirs_only, bool back_compat=false)
     globber.files(!dirs_only);
     globber.hidden(g_glob_hidden.get());
     globber.system(g_glob_system.get());
+    globber.cached(g_glob_cache.get() && extrainfo < 2);
     if (back_compat)
         globber.suffix_dirs(false);
 
     int i = 1;
     str<288> file;
-    str<16> type;
     globber::extrainfo info;
     globber::extrainfo* info_ptr = extrainfo ? &info : nullptr;
     while (globber.next(file, false, info_ptr))
     {
-        if (!extrainfo)
-        {
-            lua_pushlstring(state, file.c_str(), file.length());
-        }
-        else
-        {
-            lua_createtable(state, 0, 2);
-
-            lua_pushliteral(state, "name");
-            lua_pushlstring(state, file.c_str(), file.length());
-            lua_rawset(state, -3);
-
-            type.clear();
-            add_type_tag(type, (info.attr & FILE_ATTRIBUTE_DIRECTORY) ? "dir" : "file");
-#ifdef S_ISLNK
-            if (S_ISLNK(info.st_mode))
-            {
-                add_type_tag(type, "link");
-                wstr<288> wfile(file.c_str());
-                struct _stat64 st;
-                if (_wstat64(wfile.c_str(), &st) < 0)
-                    add_type_tag(type, "orphaned");
-            }
-#endif
-            if (info.attr & FILE_ATTRIBUTE_HIDDEN)
-                add_type_tag(type, "hidden");
-            if (info.attr & FILE_ATTRIBUTE_READONLY)
-                add_type_tag(type, "readonly");
-
-            lua_pushliteral(state, "type");
-            lua_pushlstring(state, type.c_str(), type.length());
-            lua_rawset(state, -3);
-
-            if (extrainfo >= 2)
-            {
-                lua_pushliteral(state, "atime");
-                lua_pushnumber(state, lua_Number(os::filetime_to_time_t(info.accessed)));
-                lua_rawset(state, -3);
-
-                lua_pushliteral(state, "mtime");
-                lua_pushnumber(state, lua_Number(os::filetime_to_time_t(info.modified)));
-                lua_rawset(state, -3);
-
-                lua_pushliteral(state, "ctime");
-                lua_pushnumber(state, lua_Number(os::filetime_to_time_t(info.created)));
-                lua_rawset(state, -3);
-
-                lua_pushliteral(state, "size");
-                lua_pushnumber(state, lua_Number(info.size));
-                lua_rawset(state, -3);
-            }
-        }
-
+        push_glob_entry(state, file, info, extrainfo);
         lua_rawseti(state, -2, i++);
     }
 
@@ -413,6 +422,262 @@ int glob_files(lua_State* state)
     return glob_impl(state, false);
 }
 
+//------------------------------------------------------------------------------
+// Iterator state for os.globiter().  The globber is released as soon as the
+// enumeration finishes or the iterator is closed, rather than waiting for the
+// garbage collector, so that early termination doesn't hold the directory
+// handle open.
+#define LUA_GLOBITER "clink_glob_iter"
+struct glob_iter
+{
+    static glob_iter* make_new(lua_State* state, const char* mask, bool dirs_only, int extrainfo);
+
+private:
+    static int next(lua_State* state);
+    static int close(lua_State* state);
+    static int __gc(lua_State* state);
+    static int __tostring(lua_State* state);
+
+    std::unique_ptr<globber> m_globber;
+    int m_extrainfo = 0;
+    unsigned int m_count = 0;
+};
+
+//------------------------------------------------------------------------------
+glob_iter* glob_iter::make_new(lua_State* state, const char* mask, bool dirs_only, int extrainfo)
+{
+    glob_iter* gi = (glob_iter*)lua_newuserdata(state, sizeof(glob_iter));
+    new (gi) glob_iter();
+
+    static const luaL_Reg gilib[] =
+    {
+        {"next", next},
+        {"close", close},
+        {"__gc", __gc},
+        {"__tostring", __tostring},
+        {nullptr, nullptr}
+    };
+
+    if (luaL_newmetatable(state, LUA_GLOBITER))
+    {
+        lua_pushvalue(state, -1);           // push metatable
+        lua_setfield(state, -2, "__index"); // metatable.__index = metatable
+        luaL_setfuncs(state, gilib, 0);     // add methods to new metatable
+    }
+    lua_setmetatable(state, -2);
+
+    gi->m_extrainfo = extrainfo;
+    gi->m_globber = std::make_unique<globber>(mask);
+    gi->m_globber->files(!dirs_only);
+    gi->m_globber->hidden(g_glob_hidden.get());
+    gi->m_globber->system(g_glob_system.get());
+    gi->m_globber->cached(g_glob_cache.get() && extrainfo < 2);
+    return gi;
+}
+
+//------------------------------------------------------------------------------
+// Returns the next entry, or nil when there are no more entries.
+int glob_iter::next(lua_State* state)
+{
+    glob_iter* gi = (glob_iter*)luaL_checkudata(state, 1, LUA_GLOBITER);
+    if (!gi->m_globber)
+        return 0;
+
+    str<288> file;
+    globber::extrainfo info;
+    if (!gi->m_globber->next(file, false, gi->m_extrainfo ? &info : nullptr))
+    {
+        gi->m_globber.reset();
+        return 0;
+    }
+
+    gi->m_count++;
+    push_glob_entry(state, file, info, gi->m_extrainfo);
+    return 1;
+}
+
+//------------------------------------------------------------------------------
+int glob_iter::close(lua_State* state)
+{
+    glob_iter* gi = (glob_iter*)luaL_checkudata(state, 1, LUA_GLOBITER);
+    gi->m_globber.reset();
+    return 0;
+}
+
+//------------------------------------------------------------------------------
+int glob_iter::__gc(lua_State* state)
+{
+    glob_iter* gi = (glob_iter*)luaL_checkudata(state, 1, LUA_GLOBITER);
+    gi->~glob_iter();
+    return 0;
+}
+
+//------------------------------------------------------------------------------
+int glob_iter::__tostring(lua_State* state)
+{
+    glob_iter* gi = (glob_iter*)luaL_checkudata(state, 1, LUA_GLOBITER);
+    lua_pushfstring(state, "globiter (%d entries%s)", int(gi->m_count), gi->m_globber ? "" : ", closed");
+    return 1;
+}
+
+//------------------------------------------------------------------------------
+// UNDOCUMENTED; internal use only.  See os.globiter in coroutines.lua.
+static int glob_iter_internal(lua_State* state)
+{
+    const char* mask = checkstring(state, 1);
+    if (!mask)
+        return 0;
+
+    const bool dirs_only = lua_toboolean(state, 2);
+
+    int extrainfo;
+    if (lua_isboolean(state, 3))
+        extrainfo = lua_toboolean(state, 3);
+    else
+        extrainfo = optinteger(state, 3, 0);
+
+    glob_iter::make_new(state, mask, dirs_only, extrainfo);
+    return 1;
+}
+
+//------------------------------------------------------------------------------
+static std::shared_ptr<const exec_list> get_path_exec_list()
+{
+    str<> paths;
+    str<> pathexts;
+    os::get_env("path", paths);
+    os::get_env("pathext", pathexts);
+
+    return exec_index::get(paths.c_str(), pathexts.c_str());
+}
+
+//------------------------------------------------------------------------------
+// Returns false if the entry is excluded by the files.hidden or files.system
+// settings.
+static bool get_exec_match_type(const exec_list& list, unsigned int index, bool hidden, bool system, match_type& type)
+{
+    const exec_list::entry& entry = list.get_entry(index);
+    if ((entry.attr & FILE_ATTRIBUTE_HIDDEN) && !hidden)
+        return false;
+    if ((entry.attr & FILE_ATTRIBUTE_SYSTEM) && !system)
+        return false;
+
+    type = match_type::file;
+#ifdef S_ISLNK
+    if ((entry.attr & FILE_ATTRIBUTE_REPARSE_POINT) &&
+        !(entry.attr & FILE_ATTRIBUTE_OFFLINE) &&
+        entry.reparse_tag == IO_REPARSE_TAG_SYMLINK)
+    {
+        type |= match_type::link;
+        str<288> file(list.get_dir(index));
+        path::append(file, list.get_name(index));
+        wstr<288> wfile(file.c_str());
+        struct _stat64 st;
+        if (_wstat64(wfile.c_str(), &st) < 0)
+            type |= match_type::orphaned;
+    }
+#endif
+    if (entry.attr & FILE_ATTRIBUTE_HIDDEN)
+        type |= match_type::hidden;
+    if (entry.attr & FILE_ATTRIBUTE_READONLY)
+        type |= match_type::readonly;
+    return true;
+}
+
+//------------------------------------------------------------------------------
+/// -name:  os.getpathexecutables
+/// -ver:   1.2.46
+/// -ret:   table
+/// Returns the executable files found in the directories listed in the
+/// <code>%PATH%</code> environment variable, in a table of tables usable with
+/// <a href="#builder:addmatches">builder:addmatches()</a>.  A file is
+/// executable if its extension is listed in the <code>%PATHEXT%</code>
+/// environment variable.  The table is sorted and has no duplicate names; when
+/// the same name is in more than one directory, the first one in
+/// <code>%PATH%</code> is used.
+///
+/// Each sub-table has the following scheme:
+/// -show:  local t = os.getpathexecutables()
+/// -show:  -- t[index].match     [string] The file name.
+/// -show:  -- t[index].type      [string] The match type, e.g. "file" or "file,hidden".
+///
+/// The directory listings are cached and only read again when a directory's
+/// last write time changes, which makes this much faster than calling
+/// <a href="#os.globfiles">os.globfiles()</a> for each directory.
+int get_path_executables(lua_State* state)
+{
+    std::shared_ptr<const exec_list> list = get_path_exec_list();
+
+    lua_createtable(state, list ? list->size() : 0, 0);
+    if (!list)
+        return 1;
+
+    const bool hidden = g_glob_hidden.get();
+    const bool system = g_glob_system.get();
+
+    int i = 1;
+    str<16> type_name;
+    for (unsigned int index = 0; index < list->size(); ++index)
+    {
+        match_type type;
+        if (!get_exec_match_type(*list, index, hidden, system, type))
+            continue;
+
+        match_type_to_string(type, type_name);
+
+        lua_createtable(state, 0, 2);
+
+        lua_pushliteral(state, "match");
+        lua_pushstring(state, list->get_name(index));
+        lua_rawset(state, -3);
+
+        lua_pushliteral(state, "type");
+        lua_pushlstring(state, type_name.c_str(), type_name.length());
+        lua_rawset(state, -3);
+
+        lua_rawseti(state, -2, i++);
+    }
+
+    return 1;
+}
+
+//------------------------------------------------------------------------------
+// UNDOCUMENTED; internal use only.
+// os.addpathexecutables_internal(builder) adds the same matches as
+// os.getpathexecutables() directly to the builder, without building Lua
+// tables for them.  Returns the number of matches added.
+static int add_path_executables_internal(lua_State* state)
+{
+    match_builder_lua* builder_lua = match_builder_lua::test(state, 1);
+    if (!builder_lua)
+        return 0;
+
+    std::shared_ptr<const exec_list> list = get_path_exec_list();
+    if (!list)
+    {
+        lua_pushinteger(state, 0);
+        return 1;
+    }
+
+    const bool hidden = g_glob_hidden.get();
+    const bool system = g_glob_system.get();
+
+    std::vector<match_desc> descs;
+    descs.reserve(list->size());
+    for (unsigned int index = 0; index < list->size(); ++index)
+    {
+        match_type type;
+        if (get_exec_match_type(*list, index, hidden, system, type))
+            descs.push_back({ list->get_name(index), nullptr, nullptr, type, false });
+    }
+
+    // The list keeps the names alive until the builder has copied them.
+    match_builder& builder = builder_lua->get_builder();
+    const unsigned int added = descs.empty() ? 0 : builder.add_matches(descs.data(), (unsigned int)(descs.size()));
+    lua_pushinteger(state, added);
+    return 1;
+}
+
 //------------------------------------------------------------------------------
 /// -name:  os.touch
 /// -ver:   1.2.31
@@ -1070,6 +1335,9 @@ void os_lua_initialise(lua_state& lua)
         { "copy",        &copy },
         { "globdirs",    &glob_dirs },
         { "globfiles",   &glob_files },
+        { "globiter_internal", &glob_iter_internal },
+        { "getpathexecutables", &get_path_executables },
+        { "addpathexecutables_internal", &add_path_executables_internal },
         { "touch",       &touch },
         { "getenv",      &get_env },
         { "setenv",      &set_env },
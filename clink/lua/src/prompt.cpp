@@ -5,6 +5,7 @@
 #include "prompt.h"
 
 #include <core/base.h>
+#include <core/latency.h>
 #include <core/str.h>
 #include <core/str_iter.h>
 #include <core/os.h>
@@ -394,6 +395,8 @@ void prompt_filter::filter(const char* in, str_base& out)
 //------------------------------------------------------------------------------
 void prompt_filter::filter(const char* in, const char* rin, str_base& out, str_base& rout, bool transient)
 {
+    latency_span span(latency_phase::prompt);
+
     lua_State* state = m_lua.get_state();
 
     int top = lua_gettop(state);
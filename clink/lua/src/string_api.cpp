@@ -8,6 +8,8 @@
 #include <core/str_tokeniser.h>
 #include <core/str_compare.h>
 
+#include <vector>
+
 //------------------------------------------------------------------------------
 /// -name:  string.equalsi
 /// -ver:   1.1.20
@@ -110,6 +112,53 @@ static int match_len(lua_State* state)
     return 1;
 }
 
+//------------------------------------------------------------------------------
+/// -name:  string.commonprefix
+/// -ver:   1.2.46
+/// -arg:   list:table
+/// -ret:   string
+/// Returns the longest prefix shared by all the strings in
+/// <span class="arg">list</span>.  Each entry can be a string, or a table with
+/// a <code>match</code> field (like the tables passed to
+/// <a href="#builder:addmatches">builder:addmatches()</a>).  This respects the
+/// <code>match.ignore_case</code> and <code>match.ignore_accents</code> Clink
+/// settings, and the prefix is returned as it appears in the first entry.
+/// -show:  string.commonprefix({ "abx", "aby" })           -- returns "ab"
+/// -show:  string.commonprefix({ "abx", "ABY" })           -- returns "ab" if match.ignore_case is enabled
+/// -show:  string.commonprefix({ "abx", { match="xyz" } }) -- returns ""
+static int common_prefix(lua_State* state)
+{
+    if (!lua_istable(state, 1))
+        return 0;
+
+    const int num = int(lua_rawlen(state, 1));
+
+    std::vector<const char*> strs;
+    strs.reserve(num);
+    for (int i = 1; i <= num; ++i)
+    {
+        lua_rawgeti(state, 1, i);
+
+        if (lua_istable(state, -1))
+        {
+            lua_pushliteral(state, "match");
+            lua_rawget(state, -2);
+            lua_remove(state, -2);
+        }
+
+        // Only actual strings are used, since they stay referenced by the
+        // table after they're popped.
+        if (lua_type(state, -1) == LUA_TSTRING)
+            strs.push_back(lua_tostring(state, -1));
+
+        lua_pop(state, 1);
+    }
+
+    const int len = str_compute_lcd<char>(strs.data(), (unsigned int)(strs.size()));
+    lua_pushlstring(state, len ? strs[0] : "", len);
+    return 1;
+}
+
 //------------------------------------------------------------------------------
 void string_lua_initialise(lua_state& lua)
 {
@@ -117,10 +166,11 @@ void string_lua_initialise(lua_state& lua)
         const char* name;
         int         (*method)(lua_State*);
     } methods[] = {
-        { "equalsi",    &equalsi },
-        { "explode",    &explode },
-        { "hash",       &hash },
-        { "matchlen",   &match_len },
+        { "commonprefix",  &common_prefix },
+        { "equalsi",       &equalsi },
+        { "explode",       &explode },
+        { "hash",          &hash },
+        { "matchlen",      &match_len },
     };
 
     lua_State* state = lua.get_state();
@@ -0,0 +1,248 @@
+// Copyright (c) 2021 Christopher Antos
+// License: http://opensource.org/licenses/MIT
+
+#include "pch.h"
+
+#include "line_editor_tester.h"
+
+#include <core/settings.h>
+#include <lua/lua_match_generator.h>
+#include <lua/lua_word_classifier.h>
+#include <lua/lua_state.h>
+
+//------------------------------------------------------------------------------
+// Runs a test pass through the native argmatcher parser, and then again through
+// the Lua _argreader.  Both passes must produce the same results.
+template <typename RUN>
+static void run_both(lua_state& lua, RUN&& run)
+{
+    for (int native = 1; native >= 0; --native)
+    {
+        // Changing the generation discards any saved classifications.
+        REQUIRE(lua.do_string(native ?
+            "clink._compile_argmatcher = native_compile" :
+            "clink._compile_argmatcher = nil"));
+        REQUIRE(lua.do_string("\
+            clink._argmatcher_generation = clink._argmatchers_changed()\
+            native_parses = 0\
+        "));
+
+        run();
+
+        REQUIRE(lua.do_string(native ?
+            "assert(native_parses > 0, 'native parser not used')" :
+            "assert(native_parses == 0, 'native parser used')"));
+    }
+
+    REQUIRE(lua.do_string("clink._compile_argmatcher = native_compile"));
+}
+
+//------------------------------------------------------------------------------
+TEST_CASE("Lua argmatcher native parser")
+{
+    lua_state lua;
+    lua_match_generator lua_generator(lua); // This loads the required lua scripts.
+    lua_word_classifier lua_classifier(lua);
+
+    settings::find("clink.colorize_input")->set("true");
+
+    line_editor::desc desc(nullptr, nullptr, nullptr, nullptr);
+    line_editor_tester tester(desc, "&|", nullptr);
+    tester.get_editor()->add_generator(lua_generator);
+    tester.get_editor()->set_classifier(lua_classifier);
+
+    // Count how often the native parser handles the words, and record whether
+    // the argmatcher generator allows preloading matches for the line.
+    const char* probe = "\
+        native_compile = clink._compile_argmatcher\
+        native_parses = 0\
+        local parse = clink._parse_argmatcher_words\
+        clink._parse_argmatcher_words = function(...)\
+            local matcher, arg_index = parse(...)\
+            if matcher then\
+                native_parses = native_parses + 1\
+            end\
+            return matcher, arg_index\
+        end\
+        \
+        local g = clink.generator(1)\
+        function g:generate(line_state)\
+            can_preload = clink._can_preload(line_state)\
+            return false\
+        end\
+    ";
+
+    REQUIRE(lua.do_string(probe));
+
+    const char* script = "\
+        r = clink.argmatcher():addarg('five', 'six'):loop()\
+        q = clink.argmatcher():addarg('four' .. r)\
+        clink.argmatcher('argcmd'):addarg('one', 'two', 'three' .. q):nofiles()\
+        \
+        clink.argmatcher('xyz'):addarg(\
+            'abc',\
+            'def',\
+            'qq'..clink.argmatcher():addflags('-z'),\
+            'nf'..clink.argmatcher():nofiles()\
+        ):addflags('-a', '--bee', '-c'):nofiles()\
+        \
+        local sub = clink.argmatcher():addarg('red', 'green'):addflags('-q', '-r'):nofiles()\
+        clink.argmatcher('eq')\
+            :addflags('--foo=', '--bar=' .. sub, '-x:', '-y', '--color=red', '--color=blue')\
+            :addarg('alpha', 'beta' .. sub, function(w) return { 'fn1', 'fn2' } end)\
+            :addarg({ 'gamma', 'delta' })\
+            :addarg('epsilon')\
+            :loop(2)\
+            :nofiles()\
+    ";
+
+    REQUIRE(lua.do_string(script));
+
+    SECTION("Flags")
+    {
+        run_both(lua, [&] () {
+            tester.set_input("xyz --bee -a abc -a mno -c");
+            tester.set_expected_classifications("offafnf");
+            tester.run();
+        });
+    }
+
+    SECTION("Flags linked")
+    {
+        run_both(lua, [&] () {
+            tester.set_input("xyz --bee qq -z");
+            tester.set_expected_classifications("ofaf");
+            tester.run();
+        });
+    }
+
+    SECTION("Flags then args")
+    {
+        run_both(lua, [&] () {
+            tester.set_input("xyz -a ");
+            tester.set_expected_classifications("of");
+            tester.set_expected_matches("abc", "def", "nf", "qq");
+            tester.run();
+        });
+    }
+
+    SECTION("Linked")
+    {
+        run_both(lua, [&] () {
+            tester.set_input("argcmd three four six ");
+            tester.set_expected_classifications("oaaa");
+            tester.set_expected_matches("five", "six");
+            tester.run();
+        });
+    }
+
+    SECTION("Linked miss")
+    {
+        run_both(lua, [&] () {
+            tester.set_input("argcmd three four green four ");
+            tester.set_expected_classifications("oaaoo");
+            tester.set_expected_matches("five", "six");
+            tester.run();
+        });
+    }
+
+    SECTION("Equal linked")
+    {
+        run_both(lua, [&] () {
+            tester.set_input("eq --bar=red");
+            tester.set_expected_classifications("ofa");
+            tester.run();
+        });
+    }
+
+    SECTION("Equal combined")
+    {
+        run_both(lua, [&] () {
+            tester.set_input("eq --color=red alpha");
+            tester.set_expected_classifications("offo");
+            tester.run();
+        });
+    }
+
+    SECTION("Equal space")
+    {
+        // A space after `=` doesn't follow the linked argmatcher.
+        run_both(lua, [&] () {
+            tester.set_input("eq --bar= red");
+            tester.set_expected_classifications("ofo");
+            tester.run();
+        });
+    }
+
+    SECTION("Equal not linked")
+    {
+        run_both(lua, [&] () {
+            tester.set_input("eq --foo=zzz beta ");
+            tester.set_expected_classifications("ofoa");
+            tester.set_expected_matches("red", "green");
+            tester.run();
+        });
+    }
+
+    SECTION("Colon")
+    {
+        run_both(lua, [&] () {
+            tester.set_input("eq -x: alpha");
+            tester.set_expected_classifications("ofa");
+            tester.set_expected_matches("alpha");
+            tester.run();
+        });
+    }
+
+    SECTION("Loop index")
+    {
+        run_both(lua, [&] () {
+            tester.set_input("eq alpha gamma epsilon ");
+            tester.set_expected_classifications("oaaa");
+            tester.set_expected_matches("gamma", "delta");
+            tester.run();
+        });
+    }
+
+    SECTION("Nopreload")
+    {
+        // Args from a function prevent preloading.
+        run_both(lua, [&] () {
+            tester.set_input("eq ");
+            tester.set_expected_matches("alpha", "beta", "fn1", "fn2");
+            tester.run();
+            REQUIRE(lua.do_string("assert(can_preload == false)"));
+        });
+
+        run_both(lua, [&] () {
+            tester.set_input("eq -y alpha delta ");
+            tester.set_expected_matches("epsilon");
+            tester.run();
+            REQUIRE(lua.do_string("assert(can_preload == true)"));
+        });
+    }
+
+    SECTION("Changed after compiling")
+    {
+        REQUIRE(lua.do_string("mut = clink.argmatcher('mut'):addarg('one', 'two'):nofiles()"));
+
+        tester.set_input("mut one three");
+        tester.set_expected_classifications("oan");
+        tester.run();
+
+        // Mutating the argmatcher must recompile it (via argmatchers_changed).
+        REQUIRE(lua.do_string("native_parses = 0 mut:addarg('three')"));
+
+        tester.set_input("mut one three");
+        tester.set_expected_classifications("oaa");
+        tester.run();
+
+        REQUIRE(lua.do_string("assert(native_parses > 0)"));
+
+        REQUIRE(lua.do_string("mut:addflags('-f')"));
+
+        tester.set_input("mut -f one three");
+        tester.set_expected_classifications("ofaa");
+        tester.run();
+    }
+}
@@ -0,0 +1,126 @@
+// Copyright (c) 2021 Christopher Antos
+// License: http://opensource.org/licenses/MIT
+
+#include "pch.h"
+#include "fs_fixture.h"
+
+#include <core/globber.h>
+#include <core/path.h>
+#include <core/str.h>
+#include <lua/lua_state.h>
+
+#include <string>
+
+//------------------------------------------------------------------------------
+static void write_file(const char* name, const char* content, size_t length)
+{
+    FILE* file = fopen(name, "wb");
+    REQUIRE(file != nullptr);
+    REQUIRE(!length || fwrite(content, length, 1, file) == 1);
+    fclose(file);
+}
+
+//------------------------------------------------------------------------------
+static std::string read_file(const char* name)
+{
+    std::string content;
+    if (FILE* file = fopen(name, "rb"))
+    {
+        char buffer[256];
+        while (size_t len = fread(buffer, 1, sizeof(buffer), file))
+            content.append(buffer, len);
+        fclose(file);
+    }
+    return content;
+}
+
+//------------------------------------------------------------------------------
+static bool find_cache_file(const char* cache_dir, str_base& out)
+{
+    str<> pattern;
+    path::join(cache_dir, "*.luac", pattern);
+
+    globber globber(pattern.c_str());
+    globber.directories(false);
+    return globber.next(out);
+}
+
+
+
+//------------------------------------------------------------------------------
+TEST_CASE("Lua bytecode cache")
+{
+    static const char* fs[] = { "script.lua", nullptr };
+    fs_fixture fixture(fs);
+
+    str<> script;
+    str<> cache_dir;
+    path::join(fixture.get_root(), "script.lua", script);
+    path::join(fixture.get_root(), "luacache", cache_dir);
+
+    const char* one = "value = 'one' runs = (runs or 0) + 1";
+    write_file(script.c_str(), one, strlen(one));
+
+    lua_state lua;
+    REQUIRE(lua.do_file(script.c_str(), cache_dir.c_str()));
+    REQUIRE(lua.do_string("assert(value == 'one' and runs == 1)"));
+
+    str<> cache_file;
+    REQUIRE(find_cache_file(cache_dir.c_str(), cache_file));
+    const std::string cached = read_file(cache_file.c_str());
+    REQUIRE(!cached.empty());
+
+    SECTION("Cached")
+    {
+        REQUIRE(lua.do_file(script.c_str(), cache_dir.c_str()));
+        REQUIRE(lua.do_string("assert(value == 'one' and runs == 2)"));
+        REQUIRE(read_file(cache_file.c_str()) == cached);
+    }
+
+    SECTION("Stale source")
+    {
+        // A different size guarantees the stamp changes even if the last
+        // write time doesn't.
+        const char* three = "value = 'three' runs = (runs or 0) + 1";
+        write_file(script.c_str(), three, strlen(three));
+
+        REQUIRE(lua.do_file(script.c_str(), cache_dir.c_str()));
+        REQUIRE(lua.do_string("assert(value == 'three' and runs == 2)"));
+
+        // The cache entry is rebuilt for the new source.
+        const std::string rebuilt = read_file(cache_file.c_str());
+        REQUIRE(!rebuilt.empty());
+        REQUIRE(rebuilt != cached);
+
+        REQUIRE(lua.do_file(script.c_str(), cache_dir.c_str()));
+        REQUIRE(lua.do_string("assert(value == 'three' and runs == 3)"));
+    }
+
+    SECTION("Truncated cache file")
+    {
+        write_file(cache_file.c_str(), cached.c_str(), cached.length() - 8);
+
+        REQUIRE(lua.do_file(script.c_str(), cache_dir.c_str()));
+        REQUIRE(lua.do_string("assert(value == 'one' and runs == 2)"));
+        REQUIRE(read_file(cache_file.c_str()) == cached);
+    }
+
+    SECTION("Garbage cache file")
+    {
+        const std::string garbage(cached.length(), 'x');
+        write_file(cache_file.c_str(), garbage.c_str(), garbage.length());
+
+        REQUIRE(lua.do_file(script.c_str(), cache_dir.c_str()));
+        REQUIRE(lua.do_string("assert(value == 'one' and runs == 2)"));
+        REQUIRE(read_file(cache_file.c_str()) == cached);
+    }
+
+    SECTION("Empty cache file")
+    {
+        write_file(cache_file.c_str(), "", 0);
+
+        REQUIRE(lua.do_file(script.c_str(), cache_dir.c_str()));
+        REQUIRE(lua.do_string("assert(value == 'one' and runs == 2)"));
+        REQUIRE(read_file(cache_file.c_str()) == cached);
+    }
+}
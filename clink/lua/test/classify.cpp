@@ -480,6 +480,96 @@ TEST_CASE("Lua word classification")
         }
     }
 
+    SECTION("Unchanged commands")
+    {
+        const char* script = "\
+            offsets = {}\
+            local c = clink.classifier(1)\
+            c.onlychanged = true\
+            function c:classify(commands)\
+                for _,command in ipairs(commands) do\
+                    table.insert(offsets, command.line_state:getcommandoffset())\
+                end\
+            end\
+            \
+            clink.argmatcher('xyz'):addarg('abc', 'def'):loop()\
+        ";
+
+        REQUIRE(lua.do_string(script));
+
+        tester.set_input("x & xyz abc def abc def abc");
+        tester.set_expected_classifications("ooaaaaa");
+        tester.run();
+
+        // Once the second command exists, typing in it shouldn't reclassify
+        // the first command.
+        const char* check = "\
+            local first = 0\
+            local later = 0\
+            for _,o in ipairs(offsets) do\
+                if o == 0 then first = first + 1 else later = later + 1 end\
+            end\
+            assert(first > 0 and first <= #'x & x')\
+            assert(later > first)\
+        ";
+
+        REQUIRE(lua.do_string(check));
+    }
+
+    SECTION("Every command")
+    {
+        // A classifier that hasn't set onlychanged is always given every
+        // command, and stops the other classifiers skipping any too.
+        const char* script = "\
+            firsts = {}\
+            local c = clink.classifier(1)\
+            function c:classify(commands)\
+                table.insert(firsts, commands[1].line_state:getcommandoffset())\
+            end\
+            \
+            clink.argmatcher('xyz'):addarg('abc', 'def'):loop()\
+        ";
+
+        REQUIRE(lua.do_string(script));
+
+        tester.set_input("x & xyz abc def abc def abc");
+        tester.set_expected_classifications("ooaaaaa");
+        tester.run();
+
+        const char* check = "\
+            assert(#firsts > 0)\
+            for _,o in ipairs(firsts) do\
+                assert(o == 0)\
+            end\
+        ";
+
+        REQUIRE(lua.do_string(check));
+    }
+
+    SECTION("Pasted input")
+    {
+        const char* script = "\
+            calls = 0\
+            local c = clink.classifier(1)\
+            function c:classify(commands)\
+                calls = calls + 1\
+            end\
+            \
+            clink.argmatcher('xyz'):addarg('abc', 'def'):loop()\
+        ";
+
+        REQUIRE(lua.do_string(script));
+
+        // Typed-ahead text is inserted and classified as one batch.
+        tester.set_input("xyz abc def abc", true/*paste*/);
+        tester.set_expected_classifications("oaaa");
+        tester.set_expected_output("xyz abc def abc");
+        tester.run();
+
+        // The classifier runs once for the whole pasted batch, not per key.
+        REQUIRE(lua.do_string("assert(calls == 1, 'classify calls: '..calls)"));
+    }
+
     SECTION("Doskey")
     {
         SECTION("No space")
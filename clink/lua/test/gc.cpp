@@ -0,0 +1,94 @@
+// Copyright (c) 2021 Christopher Antos
+// License: http://opensource.org/licenses/MIT
+
+#include "pch.h"
+
+#include <core/settings.h>
+#include <lua/lua_state.h>
+
+extern "C" {
+#include <lua.h>
+}
+
+//------------------------------------------------------------------------------
+static int get_gc_pause(lua_State* state)
+{
+    const int pause = lua_gc(state, LUA_GCSETPAUSE, 200);
+    lua_gc(state, LUA_GCSETPAUSE, pause);
+    return pause;
+}
+
+//------------------------------------------------------------------------------
+static int get_gc_stepmul(lua_State* state)
+{
+    const int stepmul = lua_gc(state, LUA_GCSETSTEPMUL, 200);
+    lua_gc(state, LUA_GCSETSTEPMUL, stepmul);
+    return stepmul;
+}
+
+//------------------------------------------------------------------------------
+TEST_CASE("Lua idle gc")
+{
+    lua_state lua;
+    lua_State* state = lua.get_state();
+
+    settings::find("lua.idle_gc")->set("true");
+
+    SECTION("Latency scope")
+    {
+        const int pause = get_gc_pause(state);
+        const int stepmul = get_gc_stepmul(state);
+        {
+            gc_latency_scope outer(lua);
+            REQUIRE(lua_gc(state, LUA_GCISRUNNING, 0));
+            REQUIRE(get_gc_pause(state) > pause);
+            REQUIRE(get_gc_stepmul(state) < stepmul);
+            {
+                gc_latency_scope inner(lua);
+                REQUIRE(get_gc_stepmul(state) < stepmul);
+            }
+            REQUIRE(get_gc_stepmul(state) < stepmul);
+            REQUIRE(!lua.is_gc_pending());
+        }
+        REQUIRE(lua_gc(state, LUA_GCISRUNNING, 0));
+        REQUIRE(get_gc_pause(state) == pause);
+        REQUIRE(get_gc_stepmul(state) == stepmul);
+        REQUIRE(lua.get_gc_stats().deferred == 1);
+    }
+
+    SECTION("Stopped by script")
+    {
+        REQUIRE(lua.do_string("collectgarbage('stop')"));
+        const int stepmul = get_gc_stepmul(state);
+        {
+            gc_latency_scope scope(lua);
+            REQUIRE(get_gc_stepmul(state) == stepmul);
+        }
+        REQUIRE(!lua_gc(state, LUA_GCISRUNNING, 0));
+        REQUIRE(lua.get_gc_stats().deferred == 0);
+    }
+
+    SECTION("Idle steps")
+    {
+        REQUIRE(lua.do_string("local t = {} for i = 1, 20000 do t[i] = tostring(i) end"));
+        REQUIRE(lua.is_gc_pending());
+
+        for (int i = 0; i < 100000 && lua.is_gc_pending(); ++i)
+            lua.gc_step();
+
+        REQUIRE(!lua.is_gc_pending());
+        REQUIRE(lua.get_gc_stats().cycles > 0);
+        REQUIRE(lua.get_gc_stats().steps >= lua.get_gc_stats().cycles);
+    }
+
+    SECTION("Disabled")
+    {
+        settings::find("lua.idle_gc")->set("false");
+        {
+            gc_latency_scope scope(lua);
+            REQUIRE(lua_gc(state, LUA_GCISRUNNING, 0));
+        }
+        REQUIRE(!lua.is_gc_pending());
+        settings::find("lua.idle_gc")->set();
+    }
+}
@@ -0,0 +1,142 @@
+// Copyright (c) 2021 Christopher Antos
+// License: http://opensource.org/licenses/MIT
+
+#include "pch.h"
+#include "fs_fixture.h"
+
+#include <lua/lua_state.h>
+
+//------------------------------------------------------------------------------
+TEST_CASE("Lua os.globiter")
+{
+    static const char* fs[] = {
+        "file1",
+        "file2",
+        "file3",
+        "file4",
+        "file5",
+        "dir1/only",
+        "dir2/only",
+        nullptr,
+    };
+    fs_fixture fixture(fs);
+
+    lua_state lua;
+
+    const char* script = "\
+        function collect(iter)\
+            local t = {}\
+            for entry in iter do\
+                table.insert(t, entry)\
+            end\
+            return t\
+        end\
+        \
+        function same(a, b)\
+            if #a ~= #b then\
+                return false\
+            end\
+            for i = 1, #a do\
+                if type(a[i]) == 'table' then\
+                    if a[i].name ~= b[i].name or a[i].type ~= b[i].type then\
+                        return false\
+                    end\
+                elseif a[i] ~= b[i] then\
+                    return false\
+                end\
+            end\
+            return true\
+        end\
+    ";
+
+    REQUIRE(lua.do_string(script));
+
+    SECTION("Same as glob")
+    {
+        REQUIRE(lua.do_string("\
+            local files = os.globfiles('*')\
+            assert(#files == 7)\
+            assert(same(collect(os.globiter('*')), files))\
+            assert(same(collect(os.globiter('*', { extrainfo=true })), os.globfiles('*', true)))\
+            assert(same(collect(os.globiter('*', { extrainfo=2 })), os.globfiles('*', 2)))\
+        "));
+
+        REQUIRE(lua.do_string("\
+            local dirs = os.globdirs('*')\
+            assert(#dirs == 2)\
+            assert(same(collect(os.globiter('*', { dirsonly=true })), dirs))\
+            assert(same(collect(os.globiter('*', { dirsonly=true, extrainfo=true })), os.globdirs('*', true)))\
+        "));
+
+        REQUIRE(lua.do_string("assert(#collect(os.globiter('nothing*')) == 0)"));
+    }
+
+    SECTION("Close")
+    {
+        REQUIRE(lua.do_string("\
+            local iter = os.globiter('*')\
+            assert(iter:next())\
+            assert(iter:next())\
+            iter:close()\
+            assert(iter:next() == nil)\
+            assert(iter() == nil)\
+            iter:close()\
+        "));
+
+        // The native iterator releases its globber when closed.
+        REQUIRE(lua.do_string("\
+            local iter = os.globiter_internal('*')\
+            assert(iter:next())\
+            iter:close()\
+            assert(iter:next() == nil)\
+            assert(tostring(iter):find('closed'))\
+        "));
+
+        // Running off the end closes it too.
+        REQUIRE(lua.do_string("\
+            local iter = os.globiter('*')\
+            assert(#collect(iter) == 7)\
+            assert(iter:next() == nil)\
+        "));
+    }
+
+    SECTION("Yield every")
+    {
+        REQUIRE(lua.do_string("\
+            _count = 0\
+            _done = false\
+            clink.addcoroutine(coroutine.create(function ()\
+                for entry in os.globiter('file*', { yieldevery=2 }) do\
+                    _count = _count + 1\
+                end\
+                _done = true\
+            end))\
+        "));
+
+        // Each resume gets at most two entries before the iterator yields.
+        REQUIRE(lua.do_string("\
+            local resumes = 0\
+            local last = 0\
+            while not _done do\
+                clink._resume_coroutines()\
+                resumes = resumes + 1\
+                assert(_count - last <= 2, 'got '..(_count - last)..' entries in one resume')\
+                last = _count\
+                assert(resumes < 10)\
+            end\
+            assert(_count == 5)\
+            assert(resumes >= 3)\
+        "));
+
+        // Coroutines not registered with clink.addcoroutine() aren't yielded,
+        // and neither is the main thread.
+        REQUIRE(lua.do_string("\
+            local c = coroutine.create(function ()\
+                return #collect(os.globiter('file*', { yieldevery=1 }))\
+            end)\
+            local ok, n = coroutine.resume(c)\
+            assert(ok and n == 5 and coroutine.status(c) == 'dead')\
+            assert(#collect(os.globiter('file*', { yieldevery=1 })) == 5)\
+        "));
+    }
+}
@@ -0,0 +1,128 @@
+// Copyright (c) 2021 Christopher Antos
+// License: http://opensource.org/licenses/MIT
+
+#include "pch.h"
+
+#include "fs_fixture.h"
+#include "line_editor_tester.h"
+
+#include <core/globber.h>
+#include <core/path.h>
+#include <core/settings.h>
+#include <lua/lua_match_generator.h>
+#include <lua/lua_word_classifier.h>
+#include <lua/lua_state.h>
+
+//------------------------------------------------------------------------------
+static void write_script(const char* name, const char* content)
+{
+    FILE* file = fopen(name, "wb");
+    REQUIRE(file != nullptr);
+    fputs(content, file);
+    fclose(file);
+}
+
+//------------------------------------------------------------------------------
+static bool has_cache_file(const char* cache_dir)
+{
+    str<> pattern;
+    path::join(cache_dir, "*.luac", pattern);
+
+    globber globber(pattern.c_str());
+    globber.directories(false);
+    str<> file;
+    return globber.next(file);
+}
+
+
+
+//------------------------------------------------------------------------------
+TEST_CASE("Lua lazy completion scripts")
+{
+    static const char* fs[] = {
+        "completions/lazycmd.lua",
+        "completions/other.lua",
+        nullptr,
+    };
+    fs_fixture fixture(fs);
+
+    str<> dir;
+    str<> cache_dir;
+    str<> script;
+    path::join(fixture.get_root(), "completions", dir);
+    path::join(fixture.get_root(), "luacache", cache_dir);
+
+    path::join(dir.c_str(), "lazycmd.lua", script);
+    write_script(script.c_str(), "\
+        lazy_loads = (lazy_loads or 0) + 1\n\
+        clink.argmatcher('lazycmd'):addarg('alpha', 'beta'):nofiles()\n\
+    ");
+
+    path::join(dir.c_str(), "other.lua", script);
+    write_script(script.c_str(), "other_loaded = true\n");
+
+    lua_state lua;
+    lua_match_generator lua_generator(lua); // This loads the required lua scripts.
+    lua_word_classifier lua_classifier(lua);
+
+    settings::find("clink.colorize_input")->set("true");
+
+    str<> add_dir;
+    add_dir.format("clink._add_completions_dir([[%s]], [[%s]])", dir.c_str(), cache_dir.c_str());
+    REQUIRE(lua.do_string(add_dir.c_str()));
+
+    line_editor::desc desc(nullptr, nullptr, nullptr, nullptr);
+    line_editor_tester tester(desc, "&|", nullptr);
+
+    SECTION("Generate")
+    {
+        tester.get_editor()->add_generator(lua_generator);
+
+        tester.set_input("lazycmd ");
+        tester.set_expected_matches("alpha", "beta");
+        tester.run();
+
+        REQUIRE(lua.do_string("assert(lazy_loads == 1)"));
+        REQUIRE(lua.do_string("assert(not other_loaded)"));
+        REQUIRE(has_cache_file(cache_dir.c_str()));
+
+        // The script is loaded only once.
+        tester.set_input("lazycmd al");
+        tester.set_expected_matches("alpha");
+        tester.run();
+
+        REQUIRE(lua.do_string("assert(lazy_loads == 1)"));
+    }
+
+    SECTION("Classify")
+    {
+        tester.get_editor()->set_classifier(lua_classifier);
+
+        tester.set_input("lazycmd alpha gamma");
+        tester.set_expected_classifications("oan");
+        tester.run();
+
+        REQUIRE(lua.do_string("assert(lazy_loads == 1)"));
+        REQUIRE(lua.do_string("assert(not other_loaded)"));
+        REQUIRE(has_cache_file(cache_dir.c_str()));
+
+        tester.set_input("lazycmd beta");
+        tester.set_expected_classifications("oa");
+        tester.run();
+
+        REQUIRE(lua.do_string("assert(lazy_loads == 1)"));
+    }
+
+    SECTION("No script")
+    {
+        tester.get_editor()->add_generator(lua_generator);
+
+        tester.set_input("nocmd ");
+        tester.set_expected_matches();
+        tester.run();
+
+        REQUIRE(lua.do_string("assert(not lazy_loads and not other_loaded)"));
+    }
+
+    settings::find("clink.colorize_input")->set();
+}
@@ -0,0 +1,153 @@
+// Copyright (c) 2021 Christopher Antos
+// License: http://opensource.org/licenses/MIT
+
+#include "pch.h"
+#include "line_state_lua.h"
+
+#include <lib/line_state.h>
+#include <lua/lua_state.h>
+
+#include <memory>
+#include <vector>
+
+//------------------------------------------------------------------------------
+static word make_word(const char* line, const char* text, unsigned char delim)
+{
+    const char* start = strstr(line, text);
+    REQUIRE(start != nullptr);
+
+    word w = {};
+    w.offset = unsigned(start - line);
+    w.length = unsigned(strlen(text));
+    w.delim = delim;
+    return w;
+}
+
+
+
+//------------------------------------------------------------------------------
+TEST_CASE("Lua line_state word views")
+{
+    lua_state lua;
+    lua_State* state = lua.get_state();
+
+    const char* text = "dkalias \"quoted arg\" >out some/long/path/that/is/longer/than/forty/characters.txt";
+
+    std::vector<word> words;
+    words.push_back(make_word(text, "dkalias", ' '));
+    words.push_back(make_word(text, "quoted arg", ' '));
+    words.push_back(make_word(text, "out", ' '));
+    words.push_back(make_word(text, "some/", 0));
+    words.back().length = unsigned(strlen(text) - words.back().offset);
+    words[0].command_word = true;
+    words[0].is_alias = true;
+    words[1].quoted = true;
+    words[2].is_redir_arg = true;
+
+    const char* script = "\
+        function check_views()\
+            local views = ls:getwordviews()\
+            assert(#views == ls:getwordcount())\
+            for i = 1, ls:getwordcount() do\
+                local info = ls:getwordinfo(i)\
+                local view = ls:getwordview(i)\
+                assert(view == views[i], 'view '..i..' not reused')\
+                for _, k in ipairs({ 'offset', 'length', 'quoted', 'delim', 'alias', 'redir' }) do\
+                    assert(view[k] == info[k], k..' differs for word '..i)\
+                end\
+            end\
+            return true\
+        end\
+    ";
+
+    REQUIRE(lua.do_string(script));
+
+    auto line = std::make_unique<line_state>(text, unsigned(strlen(text)), 0, words);
+    auto line_lua = std::make_unique<line_state_lua>(*line);
+    line_lua->push(state);
+    lua_setglobal(state, "ls");
+
+    SECTION("Fields")
+    {
+        REQUIRE(lua.do_string("assert(check_views())"));
+        REQUIRE(lua.do_string("assert(ls:getwordview(1).alias == true and ls:getwordview(1).redir == nil)"));
+        REQUIRE(lua.do_string("assert(ls:getwordview(2).quoted == true and ls:getwordview(2).length == 10)"));
+        REQUIRE(lua.do_string("assert(ls:getwordview(3).redir == true and ls:getwordview(3).alias == nil)"));
+        REQUIRE(lua.do_string("assert(ls:getwordview(5) == nil)"));
+    }
+
+    SECTION("Read-only")
+    {
+        REQUIRE(lua.do_string("\
+            local view = ls:getwordview(2)\
+            assert(not pcall(function () view.offset = 1 end))\
+            assert(not pcall(function () view.other = 1 end))\
+            assert(view.offset == ls:getwordinfo(2).offset)\
+            assert(view.other == nil)\
+        "));
+    }
+
+    SECTION("Outlives line_state")
+    {
+        REQUIRE(lua.do_string("saved = ls:getwordview(2) saved_views = ls:getwordviews()"));
+
+        line_lua.reset();
+        line.reset();
+
+        REQUIRE(lua.do_string("\
+            assert(ls:getword(1) == nil)\
+            assert(saved.offset == 10 and saved.length == 10 and saved.quoted == true)\
+            assert(saved_views[1].alias == true and saved_views[3].redir == true)\
+        "));
+    }
+
+    SECTION("Moved")
+    {
+        REQUIRE(lua.do_string("saved = ls:getwordview(2)"));
+
+        // The moved-to object takes over the cache, so views are still reused
+        // and only it unrefs the cache.
+        {
+            line_state_lua moved(std::move(*line_lua));
+            line_lua.reset();
+
+            moved.push(state);
+            lua_setglobal(state, "ls2");
+            REQUIRE(lua.do_string("assert(ls2:getwordview(2) == saved)"));
+        }
+
+        REQUIRE(lua.do_string("\
+            assert(ls2:getword(1) == nil)\
+            assert(saved.offset == 10 and saved.quoted == true)\
+            collectgarbage()\
+        "));
+    }
+
+    SECTION("Cached strings")
+    {
+        REQUIRE(lua.do_string("\
+            local words = ls:getwords()\
+            assert(#words == 4)\
+            for i = 1, #words do\
+                assert(words[i] == ls:getword(i))\
+            end\
+            assert(ls:getendword() == words[4])\
+            assert(ls:getword(5) == '')\
+        "));
+
+        // The end word is too long to be interned by Lua, so repeating
+        // getword() would allocate a new string each time if it weren't
+        // cached.
+        REQUIRE(lua.do_string("\
+            collectgarbage('stop')\
+            local before = collectgarbage('count')\
+            for i = 1, 1000 do\
+                local w = ls:getword(4)\
+                local l = ls:getline()\
+            end\
+            local grew = collectgarbage('count') - before\
+            collectgarbage('restart')\
+            assert(grew < 16, 'grew by '..grew..' KB')\
+        "));
+    }
+}
@@ -0,0 +1,170 @@
+// Copyright (c) 2021 Christopher Antos
+// License: http://opensource.org/licenses/MIT
+
+#include "pch.h"
+#include "coroutine_scheduler.h"
+
+#include <core/settings.h>
+#include <lua/lua_input_idle.h>
+#include <lua/lua_state.h>
+
+#include <vector>
+
+//------------------------------------------------------------------------------
+extern void add_io_completion();
+
+//------------------------------------------------------------------------------
+// Runs one pass like clink._resume_coroutines() does, and returns the ids in
+// the order they were resumed.
+static std::vector<unsigned int> run_pass(coroutine_scheduler& s, double now)
+{
+    std::vector<unsigned int> ran;
+    s.begin_pass(now);
+    while (unsigned int id = s.next_due(now))
+    {
+        ran.push_back(id);
+        s.resumed(id, now);
+    }
+    return ran;
+}
+
+//------------------------------------------------------------------------------
+TEST_CASE("Coroutine scheduler")
+{
+    coroutine_scheduler s;
+
+    SECTION("Due-time ordering")
+    {
+        const unsigned int a = s.add(3);
+        const unsigned int b = s.add(1);
+        const unsigned int c = s.add(2.5);
+
+        // New coroutines are due immediately.
+        REQUIRE(s.has_due(0));
+        REQUIRE(run_pass(s, 0).size() == 3);
+
+        REQUIRE(s.get_wait_duration(0) == 1);
+        REQUIRE(!s.has_due(0.5));
+        REQUIRE(run_pass(s, 0.5).empty());
+
+        REQUIRE((run_pass(s, 1) == std::vector<unsigned int>{ b }));
+
+        // b is next due at 2 and c at 2.5, so b runs first.
+        REQUIRE((run_pass(s, 2.75) == std::vector<unsigned int>{ b, c }));
+        REQUIRE((run_pass(s, 3) == std::vector<unsigned int>{ a }));
+    }
+
+    SECTION("Re-queue after yield")
+    {
+        const unsigned int a = s.add(0);
+        const unsigned int b = s.add(2);
+        REQUIRE(run_pass(s, 0).size() == 2);
+
+        // A coroutine that yields is rescheduled, but it can't run a second
+        // time in the same pass.
+        s.begin_pass(1);
+        REQUIRE(s.next_due(1) == a);
+        s.resumed(a, 1);
+        REQUIRE(s.next_due(1) == 0);
+
+        // It's collected again by the next pass.
+        REQUIRE(s.has_due(1));
+        REQUIRE(s.get_wait_duration(1) == 0);
+        REQUIRE((run_pass(s, 1) == std::vector<unsigned int>{ a }));
+
+        REQUIRE((run_pass(s, 2) == std::vector<unsigned int>{ a, b }));
+    }
+
+    SECTION("Remove while in heap")
+    {
+        const unsigned int a = s.add(1);
+        const unsigned int b = s.add(2);
+        const unsigned int c = s.add(3);
+        REQUIRE(run_pass(s, 0).size() == 3);
+
+        s.remove(b);
+        REQUIRE(s.get_wait_duration(0) == 1);
+
+        s.remove(a);
+        REQUIRE(s.get_wait_duration(0) == 3);
+        REQUIRE(run_pass(s, 2.5).empty());
+        REQUIRE((run_pass(s, 3) == std::vector<unsigned int>{ c }));
+
+        // Removing a coroutine after it's been collected for a pass skips it.
+        s.begin_pass(4);
+        s.remove(c);
+        REQUIRE(s.next_due(4) == 0);
+        REQUIRE(!s.has_coroutines());
+        REQUIRE(s.get_wait_duration(4) < 0);
+    }
+
+    SECTION("Waiting")
+    {
+        const unsigned int a = s.add(0);
+        REQUIRE(run_pass(s, 0).size() == 1);
+
+        // Waiting coroutines have no due time.
+        s.set_waiting(a, true);
+        REQUIRE(s.has_coroutines());
+        REQUIRE(!s.has_due(10));
+        REQUIRE(s.get_wait_duration(10) < 0);
+        REQUIRE(run_pass(s, 10).empty());
+
+        // Ending the wait makes it ready for the next pass.
+        s.set_waiting(a, false);
+        REQUIRE(s.has_due(10));
+        REQUIRE(s.get_wait_duration(10) == 0);
+        REQUIRE((run_pass(s, 10) == std::vector<unsigned int>{ a }));
+    }
+}
+
+//------------------------------------------------------------------------------
+TEST_CASE("Coroutine io completion wakeup")
+{
+    lua_state lua;
+    lua_input_idle idle(lua);
+
+    settings::find("prompt.async")->set("true");
+    settings::find("lua.idle_gc")->set("false");
+
+    const char* script = "\
+        function io.popenyield_internal(command, mode)\
+            _yieldguard = { _ready=false }\
+            function _yieldguard:ready()\
+                return self._ready\
+            end\
+            return 'fake_file', _yieldguard\
+        end\
+        \
+        _done = false\
+        clink.addcoroutine(coroutine.create(function ()\
+            io.popenyield('cmd')\
+            _done = true\
+        end))\
+    ";
+
+    REQUIRE(lua.do_string(script));
+
+    // The first idle always enters Lua; the coroutine starts its command.
+    idle.reset();
+    REQUIRE(idle.is_enabled());
+    idle.on_idle();
+    REQUIRE(lua.do_string("assert(_yieldguard and not _done)"));
+
+    // A coroutine waiting for its command has no timeout.
+    REQUIRE(idle.is_enabled());
+    REQUIRE(idle.get_timeout() == INFINITE);
+
+    // The command finishing isn't noticed until the completion count changes.
+    REQUIRE(lua.do_string("_yieldguard._ready = true"));
+    idle.on_idle();
+    REQUIRE(lua.do_string("assert(not _done)"));
+
+    add_io_completion();
+    REQUIRE(idle.is_enabled());
+    idle.on_idle();
+    REQUIRE(lua.do_string("assert(_done)"));
+
+    settings::find("lua.idle_gc")->set();
+    settings::find("prompt.async")->set();
+}
@@ -22,5 +22,7 @@ public:
     virtual void    end() = 0;
     virtual void    select(input_idle* callback=nullptr) = 0;
     virtual int     read() = 0;
+    virtual int     peek() = 0; // Never blocks; input_none if nothing is ready.
+    virtual void*   get_waitevent() const = 0; // Signaled when input may be ready, or nullptr.
     virtual key_tester* set_key_tester(key_tester* keys) = 0;
 };
@@ -506,6 +506,20 @@ static void set_cursor_visibility(bool state)
 
 
 
+//------------------------------------------------------------------------------
+static int to_input(unsigned char c)
+{
+    switch (c)
+    {
+    case input_none_byte:       return terminal_in::input_none;
+    case input_timeout_byte:    return terminal_in::input_timeout;
+    case input_abort_byte:      return terminal_in::input_abort;
+    default:                    return c;
+    }
+}
+
+
+
 //------------------------------------------------------------------------------
 void win_terminal_in::begin()
 {
@@ -545,14 +559,23 @@ int win_terminal_in::read()
     if (!m_buffer_count)
         return terminal_in::input_none;
 
-    unsigned char c = pop();
-    switch (c)
-    {
-    case input_none_byte:       return terminal_in::input_none;
-    case input_timeout_byte:    return terminal_in::input_timeout;
-    case input_abort_byte:      return terminal_in::input_abort;
-    default:                    return c;
-    }
+    return to_input(pop());
+}
+
+//------------------------------------------------------------------------------
+int win_terminal_in::peek()
+{
+    if (!m_buffer_count)
+        read_pending_console();
+
+    unsigned int dimensions = get_dimensions();
+    if (dimensions != m_dimensions)
+        return terminal_in::input_terminal_resize;
+
+    if (!m_buffer_count)
+        return terminal_in::input_none;
+
+    return to_input(m_buffer[m_buffer_head]);
 }
 
 //------------------------------------------------------------------------------
@@ -626,89 +649,123 @@ void win_terminal_in::read_console(input_idle* callback)
             return;
         }
 
-        switch (record.EventType)
+        if (!process_record(record, buffer_count, csbi))
+            return;
+    }
+}
+
+//------------------------------------------------------------------------------
+// Processes records that are already waiting in the console input queue until
+// some input has been buffered.  Only records that have been peeked are read,
+// so this never blocks.
+void win_terminal_in::read_pending_console()
+{
+    CONSOLE_SCREEN_BUFFER_INFO csbi;
+    GetConsoleScreenBufferInfo(GetStdHandle(STD_OUTPUT_HANDLE), &csbi);
+
+    const unsigned int buffer_count = m_buffer_count;
+    while (buffer_count == m_buffer_count)
+    {
+        DWORD count;
+        INPUT_RECORD record;
+        if (!PeekConsoleInputW(m_stdin, &record, 1, &count) || !count)
+            break;
+        if (!ReadConsoleInputW(m_stdin, &record, 1, &count) || !count)
+            break;
+        if (!process_record(record, buffer_count, csbi))
+            break;
+    }
+}
+
+//------------------------------------------------------------------------------
+// Processes one input record.  Returns false if the console width changed, so
+// the caller can return and give editor modules a chance to respond.
+bool win_terminal_in::process_record(INPUT_RECORD& record, unsigned int buffer_count, CONSOLE_SCREEN_BUFFER_INFO& csbi)
+{
+    switch (record.EventType)
+    {
+    case KEY_EVENT:
         {
-        case KEY_EVENT:
-            {
-                auto& key_event = record.Event.KeyEvent;
+            auto& key_event = record.Event.KeyEvent;
 
-                // Some times conhost can send through ALT codes, with the
-                // resulting Unicode code point in the Alt key-up event.
-                if (!key_event.bKeyDown
-                    && key_event.wVirtualKeyCode == VK_MENU
-                    && key_event.uChar.UnicodeChar)
-                {
-                    key_event.bKeyDown = TRUE;
-                    key_event.dwControlKeyState = 0;
-                }
+            // Some times conhost can send through ALT codes, with the
+            // resulting Unicode code point in the Alt key-up event.
+            if (!key_event.bKeyDown
+                && key_event.wVirtualKeyCode == VK_MENU
+                && key_event.uChar.UnicodeChar)
+            {
+                key_event.bKeyDown = TRUE;
+                key_event.dwControlKeyState = 0;
+            }
 
-                if (key_event.bKeyDown)
+            if (key_event.bKeyDown)
+            {
+                process_input(key_event);
+
+                // If the processed input chord isn't bound, discard it.
+                // Otherwise unbound keys can have the tail part of their
+                // sequence show up as though it were typed input.  The
+                // approach here assumes no more than one key sequence per
+                // input record.
+                if (m_keys)
                 {
-                    process_input(key_event);
-
-                    // If the processed input chord isn't bound, discard it.
-                    // Otherwise unbound keys can have the tail part of their
-                    // sequence show up as though it were typed input.  The
-                    // approach here assumes no more than one key sequence per
-                    // input record.
-                    if (m_keys)
+                    // If there are unprocessed queued keys, then we don't
+                    // know what keymap will be active when this new input
+                    // gets processed, so we can't accurately tell whether
+                    // the key sequence is bound to anything.
+                    assert(buffer_count == 0);
+
+                    const int len = m_buffer_count - buffer_count;
+                    if (len > 0)
                     {
-                        // If there are unprocessed queued keys, then we don't
-                        // know what keymap will be active when this new input
-                        // gets processed, so we can't accurately tell whether
-                        // the key sequence is bound to anything.
-                        assert(buffer_count == 0);
-
-                        const int len = m_buffer_count - buffer_count;
-                        if (len > 0)
+                        // m_buffer is circular, so copy the key sequence to
+                        // a separate sequential buffer.
+                        char chord[sizeof_array(m_buffer) + 1];
+                        static const unsigned int mask = sizeof_array(m_buffer) - 1;
+                        for (int i = 0; i < len; ++i)
+                            chord[i] = m_buffer[(m_buffer_head + i) & mask];
+
+                        // Readline has a bug in rl_function_of_keyseq_len
+                        // that looks for nul termination even though it's
+                        // supposed to use a length instead.
+                        chord[len] = '\0';
+
+                        str<32> new_chord;
+                        if (m_keys->translate(chord, len, new_chord))
+                        {
+                            m_buffer_count = buffer_count;
+                            for (unsigned int i = 0; i < new_chord.length(); ++i)
+                                push((unsigned int)new_chord.c_str()[i]);
+                        }
+                        else if (!m_keys->is_bound(chord, len))
                         {
-                            // m_buffer is circular, so copy the key sequence to
-                            // a separate sequential buffer.
-                            char chord[sizeof_array(m_buffer) + 1];
-                            static const unsigned int mask = sizeof_array(m_buffer) - 1;
-                            for (int i = 0; i < len; ++i)
-                                chord[i] = m_buffer[(m_buffer_head + i) & mask];
-
-                            // Readline has a bug in rl_function_of_keyseq_len
-                            // that looks for nul termination even though it's
-                            // supposed to use a length instead.
-                            chord[len] = '\0';
-
-                            str<32> new_chord;
-                            if (m_keys->translate(chord, len, new_chord))
-                            {
-                                m_buffer_count = buffer_count;
-                                for (unsigned int i = 0; i < new_chord.length(); ++i)
-                                    push((unsigned int)new_chord.c_str()[i]);
-                            }
-                            else if (!m_keys->is_bound(chord, len))
-                            {
-                                m_buffer_count = buffer_count;
-                            }
-
-                            m_keys->set_keyseq_len(m_buffer_count);
+                            m_buffer_count = buffer_count;
                         }
+
+                        m_keys->set_keyseq_len(m_buffer_count);
                     }
                 }
             }
-            break;
+        }
+        break;
 
-        case WINDOW_BUFFER_SIZE_EVENT:
-            // Windows can move the cursor onto a new line as a result of line
-            // wrapping adjustments.  If the width changes then return to give
-            // editor modules a chance to respond to the width change.
-            reset_wcwidths();
+    case WINDOW_BUFFER_SIZE_EVENT:
+        // Windows can move the cursor onto a new line as a result of line
+        // wrapping adjustments.  If the width changes then return to give
+        // editor modules a chance to respond to the width change.
+        reset_wcwidths();
 
-            {
-                CONSOLE_SCREEN_BUFFER_INFO csbiNew;
-                GetConsoleScreenBufferInfo(stdout_handle, &csbiNew);
-                if (csbi.dwSize.X != csbiNew.dwSize.X)
-                    return;
-                csbi = csbiNew; // Update for next time.
-            }
-            break;
+        {
+            CONSOLE_SCREEN_BUFFER_INFO csbiNew;
+            GetConsoleScreenBufferInfo(GetStdHandle(STD_OUTPUT_HANDLE), &csbiNew);
+            if (csbi.dwSize.X != csbiNew.dwSize.X)
+                return false;
+            csbi = csbiNew; // Update for next time.
         }
+        break;
     }
+
+    return true;
 }
 
 //------------------------------------------------------------------------------
@@ -17,10 +17,14 @@ public:
     virtual void    end() override;
     virtual void    select(input_idle* callback=nullptr) override;
     virtual int     read() override;
+    virtual int     peek() override;
+    virtual void*   get_waitevent() const override { return m_stdin; }
     virtual key_tester* set_key_tester(key_tester* keys) override;
 
 private:
     void            read_console(input_idle* callback=nullptr);
+    void            read_pending_console();
+    bool            process_record(INPUT_RECORD& record, unsigned int buffer_count, CONSOLE_SCREEN_BUFFER_INFO& csbi);
     void            process_input(const KEY_EVENT_RECORD& key_event);
     void            push(unsigned int value);
     void            push(const char* seq);
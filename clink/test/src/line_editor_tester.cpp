@@ -136,9 +136,10 @@ line_editor* line_editor_tester::get_editor() const
 }
 
 //------------------------------------------------------------------------------
-void line_editor_tester::set_input(const char* input)
+void line_editor_tester::set_input(const char* input, bool paste)
 {
     m_input = input;
+    m_paste = paste;
 }
 
 //------------------------------------------------------------------------------
@@ -154,7 +155,7 @@ void line_editor_tester::run()
     REQUIRE(has_expectations);
 
     REQUIRE(m_input != nullptr);
-    m_terminal_in.set_input(m_input);
+    m_terminal_in.set_input(m_input, m_paste);
 
     // If we're expecting some matches then add a module to catch the
     // matches object.
@@ -261,6 +262,7 @@ void line_editor_tester::run()
     }
 
     m_input = nullptr;
+    m_paste = false;
     m_expected_output = nullptr;
     m_expected_matches.clear();
     m_expected_classifications.clear();
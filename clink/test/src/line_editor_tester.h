@@ -7,6 +7,7 @@
 #include <lib/line_editor.h>
 #include <lib/line_buffer.h>
 #include <lib/terminal_helpers.h>
+#include <terminal/input_idle.h>
 #include <terminal/terminal_in.h>
 #include <terminal/terminal_out.h>
 
@@ -21,16 +22,19 @@ class test_terminal_in
 {
 public:
     bool                    has_input() const { return (m_read == nullptr) ? false : (*m_read != '\0'); }
-    void                    set_input(const char* input) { m_input = m_read = input; }
+    void                    set_input(const char* input, bool paste=false) { m_input = m_read = input; m_paste = paste; }
     virtual void            begin() override {}
     virtual void            end() override {}
-    virtual void            select(input_idle*) override {}
+    virtual void            select(input_idle* idle) override { if (idle && idle->is_enabled()) idle->on_idle(); }
     virtual int             read() override { return *(unsigned char*)m_read++; }
+    virtual int             peek() override { return (m_paste && has_input()) ? *(unsigned char*)m_read : input_none; }
+    virtual void*           get_waitevent() const override { return nullptr; }
     virtual key_tester*     set_key_tester(key_tester*) override { return nullptr; }
 
 private:
     const char*             m_input = nullptr;
     const char*             m_read = nullptr;
+    bool                    m_paste = false;    // Input is typed ahead, as when pasting.
 };
 
 //------------------------------------------------------------------------------
@@ -63,7 +67,7 @@ public:
                                 line_editor_tester(const line_editor::desc& desc, const char* command_delims, const char* word_delims);
                                 ~line_editor_tester();
     line_editor*                get_editor() const;
-    void                        set_input(const char* input);
+    void                        set_input(const char* input, bool paste=false);
     template <class ...T> void  set_expected_matches(T... t); // T must be const char*
     void                        set_expected_classifications(const char* classifications);
     void                        set_expected_output(const char* expected);
@@ -86,6 +90,7 @@ private:
     const char*                 m_input = nullptr;
     const char*                 m_expected_output = nullptr;
     line_editor*                m_editor = nullptr;
+    bool                        m_paste = false;
     bool                        m_has_matches = false;
     bool                        m_has_classifications = false;
 };
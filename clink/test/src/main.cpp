@@ -25,6 +25,12 @@ bool host_has_deprecated_argmatcher(const char* command)
     return false;
 }
 
+//------------------------------------------------------------------------------
+unsigned int host_get_argmatcher_generation()
+{
+    return 0;
+}
+
 //------------------------------------------------------------------------------
 void start_logger()
 {
@@ -440,6 +440,7 @@ clink_exe("clink_test")
     includedirs("clink/lib/include/lib")
     includedirs("clink/lib/src")
     includedirs("clink/lua/include")
+    includedirs("clink/lua/src")
     includedirs("clink/terminal/include")
     includedirs("lua/src")
     includedirs("readline")
@@ -118,6 +118,12 @@ rl_vcppfunc_t *rl_completion_display_matches_func = (rl_vcppfunc_t *)NULL;
    compares the lcd.  It must return the length of the common prefix
    between the two string arguments. */
 rl_compare_lcd_func_t *rl_compare_lcd_func = (rl_compare_lcd_func_t *)NULL;
+/* If non-zero, then this is the address of a function to call that computes
+   the lcd of a whole match list.  It receives the list, the number of matches,
+   and the number of leading chars to skip in each match.  It must return the
+   length of the common prefix, excluding the skipped chars.  This takes
+   priority over rl_compare_lcd_func. */
+rl_compute_lcd_func_t *rl_compute_lcd_func = (rl_compute_lcd_func_t *)NULL;
 /* If non-zero, then this is the address of a function to call that
    postprocesses the lcd. */
 rl_postprocess_lcd_func_t *rl_postprocess_lcd_func = (rl_postprocess_lcd_func_t *)NULL;
@@ -1961,8 +1967,19 @@ compute_lcd_of_matches (char **match_list, int matches, const char *text)
       if (any_need_quoting)
 	test_for_quoting = 0;
     }
-/* end_clink_change */
 
+  if (rl_compute_lcd_func)
+    {
+      low = past_flag + rl_compute_lcd_func (match_list + 1, matches, past_flag);
+      for (i = 2; test_for_quoting && i <= matches; i++)
+	{
+	  any_need_quoting = _rl_strpbrk (match_list[i]+past_flag, rl_filename_quote_characters) != 0;
+	  if (any_need_quoting)
+	    test_for_quoting = 0;
+	}
+    }
+  else
+/* end_clink_change */
   for (i = 1, low = 100000; i < matches; i++)
     {
 #if defined (HANDLE_MULTIBYTE)
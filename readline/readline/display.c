@@ -187,6 +187,9 @@ rl_voidfunc_t *rl_redisplay_function = rl_redisplay;
 /* Application-specific function to be called before displaying the
    input line. */
 rl_voidfunc_t *rl_before_display_function = (rl_voidfunc_t *)NULL;
+/* Application-specific function to be called with 1 before and 0 after
+   rl_redisplay() does its work, e.g. to measure how long it takes. */
+rl_vintfunc_t *rl_redisplay_timing_hook = (rl_vintfunc_t *)NULL;
 /* end_clink_change */
 
 /* begin_clink_change */
@@ -918,9 +921,28 @@ _rl_optimize_redisplay (void)
     _rl_quick_redisplay = 1;
 }  
 
-/* Basic redisplay algorithm.  See comments inline. */
+/* begin_clink_change */
+static void redisplay_internal (void);
+
 void
 rl_redisplay (void)
+{
+  if (rl_redisplay_timing_hook)
+    {
+      (*rl_redisplay_timing_hook) (1);
+      redisplay_internal ();
+      (*rl_redisplay_timing_hook) (0);
+    }
+  else
+    redisplay_internal ();
+}
+/* end_clink_change */
+
+/* Basic redisplay algorithm.  See comments inline. */
+/* begin_clink_change */
+static void
+redisplay_internal (void)
+/* end_clink_change */
 {
   int in, out, c, linenum, cursor_linenum;
   int inv_botlin, lb_botlin, lb_linenum, o_cpos;
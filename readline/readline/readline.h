@@ -686,6 +686,8 @@ extern rl_voidfunc_t *rl_adjust_completion_defaults;
 extern rl_adjcmpwrd_func_t *rl_adjust_completion_word;
 /* Function to call for comparing lcd. */
 extern rl_compare_lcd_func_t *rl_compare_lcd_func;
+/* Function to call for computing the lcd of a whole match list. */
+extern rl_compute_lcd_func_t *rl_compute_lcd_func;
 /* Function to call for post-processing of lcd. */
 extern rl_postprocess_lcd_func_t *rl_postprocess_lcd_func;
 /* Completion functions can set this to signal that the first char of each
@@ -727,6 +729,8 @@ extern rl_voidfunc_t *rl_redisplay_function;
 /* begin_clink_change */
 /* The address of a function to call before displaying the input line. */
 extern rl_voidfunc_t *rl_before_display_function;
+/* The address of a function to call with 1 before and 0 after redisplay. */
+extern rl_vintfunc_t *rl_redisplay_timing_hook;
 /* end_clink_change */
 
 /* begin_clink_change */
@@ -78,6 +78,8 @@ typedef void rl_qsort_match_list_func_t PARAMS((char**, int len));
 typedef char rl_adjcmpwrd_func_t PARAMS((char qc, int *fp, int *dp));
 /* Type for comparing lcd hook function */
 typedef int rl_compare_lcd_func_t PARAMS((const char *, const char *));
+/* Type for computing lcd of a match list hook function */
+typedef int rl_compute_lcd_func_t PARAMS((char **, int, int));
 /* Type for postprocessing the lcd hook function */
 typedef void rl_postprocess_lcd_func_t PARAMS((char *, const char *));
 /* Type for function to get face for char in input buffer */